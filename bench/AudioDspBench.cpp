@@ -0,0 +1,186 @@
+// Micro-benchmarks for the AudioDsp kernels. Each kernel runs once per
+// instruction set the CPU supports; items_per_second is samples/s.
+//
+//   cmake -DBUILD_BENCHMARKS=ON ... && ./AudioDspBench
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "audio/AudioDsp.h"
+#include "common/Config.h"
+
+namespace {
+
+constexpr int kFrameSamples = Config::AUDIO_FRAME_SAMPLES;
+
+std::vector<qint16> randomSamples(int count, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(-12000, 12000);
+    std::vector<qint16> samples(static_cast<size_t>(count));
+    for (qint16 &s : samples) {
+        s = qint16(dist(rng));
+    }
+    return samples;
+}
+
+bool selectIsa(benchmark::State &state)
+{
+    const auto isa = static_cast<AudioDsp::Isa>(state.range(0));
+    if (!AudioDsp::setIsa(isa)) {
+        state.SkipWithError("instruction set not supported on this CPU");
+        return false;
+    }
+    state.SetLabel(AudioDsp::isaName(isa));
+    return true;
+}
+
+void BM_AddSaturate(benchmark::State &state)
+{
+    if (!selectIsa(state)) {
+        return;
+    }
+    std::vector<qint16> dst = randomSamples(kFrameSamples, 1);
+    const std::vector<qint16> src = randomSamples(kFrameSamples, 2);
+    for (auto _ : state) {
+        AudioDsp::addSaturate(dst.data(), src.data(), kFrameSamples);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameSamples);
+}
+
+void BM_Accumulate(benchmark::State &state)
+{
+    if (!selectIsa(state)) {
+        return;
+    }
+    std::vector<qint32> acc(static_cast<size_t>(kFrameSamples), 0);
+    const std::vector<qint16> src = randomSamples(kFrameSamples, 3);
+    for (auto _ : state) {
+        AudioDsp::accumulate(acc.data(), src.data(), kFrameSamples);
+        benchmark::DoNotOptimize(acc.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameSamples);
+}
+
+void BM_PackSaturate(benchmark::State &state)
+{
+    if (!selectIsa(state)) {
+        return;
+    }
+    std::vector<qint32> acc(static_cast<size_t>(kFrameSamples), 0);
+    const std::vector<qint16> own = randomSamples(kFrameSamples, 4);
+    for (int i = 0; i < 5; ++i) {
+        const std::vector<qint16> src = randomSamples(kFrameSamples, 10 + unsigned(i));
+        AudioDsp::accumulate(acc.data(), src.data(), kFrameSamples);
+    }
+    std::vector<qint16> out(static_cast<size_t>(kFrameSamples));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(AudioDsp::packSaturate(acc.data(), own.data(), out.data(), kFrameSamples));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameSamples);
+}
+
+void BM_GainRamp(benchmark::State &state)
+{
+    if (!selectIsa(state)) {
+        return;
+    }
+    const std::vector<qint16> in = randomSamples(kFrameSamples, 5);
+    std::vector<qint16> out(static_cast<size_t>(kFrameSamples));
+    for (auto _ : state) {
+        AudioDsp::applyGainRamp(in.data(), out.data(), kFrameSamples, 1.0f, 0.0f);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameSamples);
+}
+
+void BM_MeasureLevel(benchmark::State &state)
+{
+    if (!selectIsa(state)) {
+        return;
+    }
+    const std::vector<qint16> in = randomSamples(kFrameSamples, 6);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(AudioDsp::measureLevel(in.data(), kFrameSamples));
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameSamples);
+}
+
+void BM_DotProduct(benchmark::State &state)
+{
+    if (!selectIsa(state)) {
+        return;
+    }
+    // One output sample of the 48 -> 16 kHz resampler.
+    const std::vector<qint16> in = randomSamples(144, 7);
+    const std::vector<qint16> taps = randomSamples(144, 8);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(AudioDsp::dotProduct(in.data(), taps.data(), 144));
+    }
+    state.SetItemsProcessed(state.iterations() * 144);
+}
+
+// One mixer tick: level + accumulate for every stream, then one
+// mix-minus output per participant. range(1) is the participant count.
+void BM_MixMinusTick(benchmark::State &state)
+{
+    if (!selectIsa(state)) {
+        return;
+    }
+    const int streams = int(state.range(1));
+    std::vector<std::vector<qint16>> inputs;
+    for (int i = 0; i < streams; ++i) {
+        inputs.push_back(randomSamples(kFrameSamples, 100 + unsigned(i)));
+    }
+    std::vector<qint32> acc(static_cast<size_t>(kFrameSamples));
+    std::vector<qint16> out(static_cast<size_t>(kFrameSamples));
+
+    for (auto _ : state) {
+        std::fill(acc.begin(), acc.end(), 0);
+        for (const auto &input : inputs) {
+            benchmark::DoNotOptimize(AudioDsp::measureLevel(input.data(), kFrameSamples));
+            AudioDsp::accumulate(acc.data(), input.data(), kFrameSamples);
+        }
+        for (const auto &input : inputs) {
+            benchmark::DoNotOptimize(AudioDsp::packSaturate(acc.data(), input.data(), out.data(), kFrameSamples));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * streams * kFrameSamples);
+}
+
+void isaArgs(benchmark::internal::Benchmark *bench)
+{
+    for (AudioDsp::Isa isa : {AudioDsp::Isa::Scalar, AudioDsp::Isa::Sse2, AudioDsp::Isa::Avx2}) {
+        bench->Arg(int(isa));
+    }
+}
+
+void mixArgs(benchmark::internal::Benchmark *bench)
+{
+    for (AudioDsp::Isa isa : {AudioDsp::Isa::Scalar, AudioDsp::Isa::Sse2, AudioDsp::Isa::Avx2}) {
+        for (int streams : {4, 20, 50}) {
+            bench->Args({int(isa), streams});
+        }
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_AddSaturate)->Apply(isaArgs);
+BENCHMARK(BM_Accumulate)->Apply(isaArgs);
+BENCHMARK(BM_PackSaturate)->Apply(isaArgs);
+BENCHMARK(BM_GainRamp)->Apply(isaArgs);
+BENCHMARK(BM_MeasureLevel)->Apply(isaArgs);
+BENCHMARK(BM_DotProduct)->Apply(isaArgs);
+BENCHMARK(BM_MixMinusTick)->Apply(mixArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,150 @@
+// CPU cost per sample-rate mode. For each stream rate (16, 24 and
+// 48 kHz) this measures the device-side resampling every peer pays and
+// the host's per-tick mixing work, which scales with the frame size.
+// Times are per 20 ms frame; items_per_second is frames/s.
+//
+//   cmake -DBUILD_BENCHMARKS=ON ... && ./AudioRateBench
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "audio/AudioDsp.h"
+#include "audio/Resampler.h"
+#include "common/Config.h"
+
+namespace {
+
+constexpr int kDeviceFrame = Config::AUDIO_DEVICE_FRAME_SAMPLES;
+
+int frameSamplesAt(int rate)
+{
+    return rate / 1000 * Config::AUDIO_FRAME_MS;
+}
+
+std::vector<qint16> speechLike(int count, int rate, unsigned seed)
+{
+    // A few harmonics of a 150 Hz voice plus noise.
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> noise(-500, 500);
+    std::vector<qint16> samples(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        double value = 0.0;
+        for (int h = 1; h <= 8; ++h) {
+            value += 3000.0 / h * std::sin(2.0 * 3.14159265358979 * 150.0 * h * i / rate);
+        }
+        samples[size_t(i)] = qint16(value + noise(rng));
+    }
+    return samples;
+}
+
+void setMode(benchmark::State &state, int rate)
+{
+    state.SetLabel(std::to_string(rate / 1000) + " kHz");
+}
+
+// Capture side: one device frame converted down to the stream rate.
+void BM_CaptureResample(benchmark::State &state)
+{
+    const int rate = int(state.range(0));
+    setMode(state, rate);
+    const std::vector<qint16> in = speechLike(kDeviceFrame, Config::AUDIO_DEVICE_SAMPLE_RATE, 1);
+    std::vector<qint16> out(static_cast<size_t>(kDeviceFrame + 1));
+    if (rate == Config::AUDIO_DEVICE_SAMPLE_RATE) {
+        // No conversion: the frame is passed through.
+        for (auto _ : state) {
+            std::copy(in.begin(), in.end(), out.begin());
+            benchmark::ClobberMemory();
+        }
+    } else {
+        Resampler resampler(Config::AUDIO_DEVICE_SAMPLE_RATE, rate, kDeviceFrame);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(resampler.process(in.data(), kDeviceFrame, out.data(), int(out.size())));
+            benchmark::ClobberMemory();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Playback side: one stream frame converted up to the device rate.
+void BM_PlaybackResample(benchmark::State &state)
+{
+    const int rate = int(state.range(0));
+    setMode(state, rate);
+    const int frame = frameSamplesAt(rate);
+    const std::vector<qint16> in = speechLike(frame, rate, 2);
+    std::vector<qint16> out(static_cast<size_t>(kDeviceFrame));
+    if (rate == Config::AUDIO_DEVICE_SAMPLE_RATE) {
+        for (auto _ : state) {
+            std::copy(in.begin(), in.end(), out.begin());
+            benchmark::ClobberMemory();
+        }
+    } else {
+        Resampler resampler(rate, Config::AUDIO_DEVICE_SAMPLE_RATE, frame);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(resampler.process(in.data(), frame, out.data(), kDeviceFrame));
+            benchmark::ClobberMemory();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Host mixer tick at the stream rate: level + accumulate for the mixed
+// speakers and one mix-minus output per participant. range(1) is the
+// participant count.
+void BM_MixTick(benchmark::State &state)
+{
+    const int rate = int(state.range(0));
+    const int participants = int(state.range(1));
+    setMode(state, rate);
+    const int frame = frameSamplesAt(rate);
+    std::vector<std::vector<qint16>> inputs;
+    for (int i = 0; i < Config::AUDIO_MIX_MAX_SPEAKERS; ++i) {
+        inputs.push_back(speechLike(frame, rate, 10 + unsigned(i)));
+    }
+    std::vector<qint32> acc(static_cast<size_t>(frame));
+    std::vector<qint16> out(static_cast<size_t>(frame));
+
+    for (auto _ : state) {
+        std::fill(acc.begin(), acc.end(), 0);
+        for (const auto &input : inputs) {
+            benchmark::DoNotOptimize(AudioDsp::measureLevel(input.data(), frame));
+            AudioDsp::accumulate(acc.data(), input.data(), frame);
+        }
+        for (int i = 0; i < participants; ++i) {
+            const qint16 *own = i < int(inputs.size()) ? inputs[size_t(i)].data() : nullptr;
+            benchmark::DoNotOptimize(AudioDsp::packSaturate(acc.data(), own, out.data(), frame));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+    // Raw PCM on the wire for one outgoing mix, for comparison.
+    state.counters["bytesPerFrame"] = double(frame * int(sizeof(qint16)));
+}
+
+void modeArgs(benchmark::internal::Benchmark *bench)
+{
+    for (int rate : {16000, 24000, 48000}) {
+        bench->Arg(rate);
+    }
+}
+
+void mixArgs(benchmark::internal::Benchmark *bench)
+{
+    for (int rate : {16000, 24000, 48000}) {
+        for (int participants : {4, 20, 50}) {
+            bench->Args({rate, participants});
+        }
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_CaptureResample)->Apply(modeArgs);
+BENCHMARK(BM_PlaybackResample)->Apply(modeArgs);
+BENCHMARK(BM_MixTick)->Apply(mixArgs);
+
+BENCHMARK_MAIN();
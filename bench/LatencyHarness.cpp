@@ -0,0 +1,444 @@
+// Mouth-to-ear latency harness for the guest audio path. Runs a sending
+// and a receiving AudioTransport in one process over loopback UDP, each
+// on its own AudioEngine with headless devices: a click-train generator
+// stands in for the microphone and a click detector for the speaker.
+// Packets from the sender pass through an impairment relay that adds
+// delay, jitter and loss; the receiver's loss reports go back directly,
+// so redundancy adapts as it would on a real network.
+//
+//   LatencyHarness [options]
+//
+//   --seconds N        measured run time (default 30)
+//   --warmup N         seconds ignored at the start while the jitter
+//                      buffer settles (default 3)
+//   --delay MS         fixed one-way delay added by the relay (default 0)
+//   --jitter MS        extra delay, uniform in 0..MS per packet; packets
+//                      may be reordered (default 0)
+//   --loss P           packet loss probability, 0..1 (default 0)
+//   --burst LEN        mean loss burst length in packets; losses start
+//                      with probability P/LEN (default 1: independent)
+//   --codec pcm|opus   codec negotiated on both ends (default opus when
+//                      built in, else pcm)
+//   --interval MS      click spacing; must exceed the latency (default 500)
+//   --port N           first of three consecutive UDP ports (default 47000)
+//
+// Latency runs from the click's first sample entering the capture device
+// to it leaving the playback device, so it includes capture framing, the
+// send thread, the network, reordering, the jitter buffer and playout;
+// the audio hardware's own buffers are not part of it. CPU per frame is
+// process CPU time (both ends and the relay) over the frames played.
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QIODevice>
+#include <QTimer>
+#include <QUdpSocket>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "audio/AudioCodec.h"
+#include "audio/AudioEngine.h"
+#include "audio/AudioTransport.h"
+#include "common/Config.h"
+
+namespace {
+
+constexpr int kRate = Config::AUDIO_DEVICE_SAMPLE_RATE;
+constexpr double kPi = 3.14159265358979323846;
+// A 30 ms 1 kHz burst over a faint noise floor: loud enough for the VAD
+// to open on its first frame, long enough to survive a concealed frame.
+constexpr int kClickSamples = kRate * 30 / 1000;
+constexpr double kClickAmplitude = 16000.0;
+constexpr int kNoiseAmplitude = 60;
+constexpr int kDetectThreshold = 4000;
+
+struct Options
+{
+    int seconds = 30;
+    int warmup = 3;
+    int delayMs = 0;
+    int jitterMs = 0;
+    double loss = 0.0;
+    double burst = 1.0;
+#ifdef USE_OPUS
+    AudioCodec::Type codec = AudioCodec::Type::Opus;
+#else
+    AudioCodec::Type codec = AudioCodec::Type::Pcm16;
+#endif
+    int intervalMs = 500;
+    quint16 port = 47000;
+};
+
+// Microphone stand-in. Hands out samples no faster than real time on the
+// shared clock, so the capture side sees the same pacing as a device;
+// click k starts at origin + k * interval.
+class ClickTrainDevice : public QIODevice
+{
+public:
+    ClickTrainDevice(const QElapsedTimer &clockValue, int intervalMs)
+        : clock(clockValue)
+        , intervalSamples(qint64(intervalMs) * kRate / 1000)
+        , produced(0)
+        , originNs(0)
+        , rng(99)
+    {
+    }
+
+    bool isSequential() const override { return true; }
+
+    // Called right before capture starts.
+    void startClock() { originNs = clock.nsecsElapsed(); }
+    qint64 origin() const { return originNs; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        const qint64 due = (clock.nsecsElapsed() - originNs) * kRate / 1000000000;
+        const qint64 count = qMin(due - produced, maxSize / qint64(sizeof(qint16)));
+        if (count <= 0) {
+            return 0;
+        }
+        std::uniform_int_distribution<int> noise(-kNoiseAmplitude, kNoiseAmplitude);
+        qint16 *out = reinterpret_cast<qint16 *>(data);
+        for (qint64 i = 0; i < count; ++i) {
+            const qint64 offset = (produced + i) % intervalSamples;
+            double value = noise(rng);
+            if (produced + i >= intervalSamples && offset < kClickSamples) {
+                value += kClickAmplitude * std::sin(2.0 * kPi * 1000.0 * double(offset) / kRate);
+            }
+            out[i] = qint16(value);
+        }
+        produced += count;
+        return count * qint64(sizeof(qint16));
+    }
+
+    qint64 writeData(const char *data, qint64 maxSize) override
+    {
+        Q_UNUSED(data);
+        Q_UNUSED(maxSize);
+        return -1;
+    }
+
+private:
+    const QElapsedTimer &clock;
+    const qint64 intervalSamples;
+    qint64 produced;
+    qint64 originNs;
+    std::mt19937 rng;
+};
+
+// Speaker stand-in. Timestamps each played sample on the shared clock
+// and records when a click's onset comes out.
+class ClickDetector : public QIODevice
+{
+public:
+    ClickDetector(const QElapsedTimer &clockValue, int intervalMs)
+        : clock(clockValue)
+        , holdoffNs(qint64(intervalMs) * 1000000 / 2)
+        , lastOnsetNs(-1)
+        , played(0)
+    {
+    }
+
+    bool isSequential() const override { return true; }
+
+    const std::vector<qint64> &onsets() const { return onsetNs; }
+    qint64 playedSamples() const { return played; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        Q_UNUSED(data);
+        Q_UNUSED(maxSize);
+        return -1;
+    }
+
+    qint64 writeData(const char *data, qint64 maxSize) override
+    {
+        // The frame starts playing now.
+        const qint64 nowNs = clock.nsecsElapsed();
+        const qint16 *samples = reinterpret_cast<const qint16 *>(data);
+        const qint64 count = maxSize / qint64(sizeof(qint16));
+        for (qint64 i = 0; i < count; ++i) {
+            if (std::abs(int(samples[i])) < kDetectThreshold) {
+                continue;
+            }
+            const qint64 t = nowNs + i * 1000000000 / kRate;
+            if (lastOnsetNs < 0 || t - lastOnsetNs > holdoffNs) {
+                onsetNs.push_back(t);
+                lastOnsetNs = t;
+            }
+        }
+        played += count;
+        return maxSize;
+    }
+
+private:
+    const QElapsedTimer &clock;
+    const qint64 holdoffNs;
+    qint64 lastOnsetNs;
+    qint64 played;
+    std::vector<qint64> onsetNs;
+};
+
+// Forwards datagrams from the sender to the receiver with a two-state
+// (Gilbert) loss model and per-packet delay. Runs on the main thread.
+class ImpairmentRelay
+{
+public:
+    ImpairmentRelay(const Options &optionsValue, const QElapsedTimer &clockValue)
+        : options(optionsValue)
+        , clock(clockValue)
+        , rng(1234)
+        , inBurst(false)
+        , forwarded(0)
+        , dropped(0)
+    {
+        QObject::connect(&socket, &QUdpSocket::readyRead, &socket, [this]() { receive(); });
+        timer.setTimerType(Qt::PreciseTimer);
+        timer.setInterval(1);
+        QObject::connect(&timer, &QTimer::timeout, &timer, [this]() { flush(); });
+    }
+
+    bool start(quint16 listenPort, quint16 targetPortValue)
+    {
+        targetPort = targetPortValue;
+        if (!socket.bind(QHostAddress::LocalHost, listenPort)) {
+            return false;
+        }
+        timer.start();
+        return true;
+    }
+
+    quint64 forwardedPackets() const { return forwarded; }
+    quint64 droppedPackets() const { return dropped; }
+
+private:
+    void receive()
+    {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        while (socket.hasPendingDatagrams()) {
+            QByteArray datagram(int(socket.pendingDatagramSize()), Qt::Uninitialized);
+            if (socket.readDatagram(datagram.data(), datagram.size()) < 0) {
+                continue;
+            }
+            inBurst = inBurst ? uniform(rng) >= 1.0 / options.burst
+                              : uniform(rng) < options.loss / options.burst;
+            if (inBurst) {
+                ++dropped;
+                continue;
+            }
+            const qint64 extraNs = qint64(uniform(rng) * options.jitterMs * 1000000.0);
+            pending.emplace(clock.nsecsElapsed() + qint64(options.delayMs) * 1000000 + extraNs, datagram);
+        }
+        flush();
+    }
+
+    void flush()
+    {
+        const qint64 now = clock.nsecsElapsed();
+        while (!pending.empty() && pending.begin()->first <= now) {
+            socket.writeDatagram(pending.begin()->second, QHostAddress::LocalHost, targetPort);
+            pending.erase(pending.begin());
+            ++forwarded;
+        }
+    }
+
+    const Options &options;
+    const QElapsedTimer &clock;
+    QUdpSocket socket;
+    QTimer timer;
+    quint16 targetPort = 0;
+    std::mt19937 rng;
+    bool inBurst;
+    std::multimap<qint64, QByteArray> pending;
+    quint64 forwarded;
+    quint64 dropped;
+};
+
+double percentile(const std::vector<double> &sorted, int p)
+{
+    return sorted[std::min(sorted.size() - 1, sorted.size() * size_t(p) / 100)];
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char *value = argv[++i];
+        if (arg == "--seconds") {
+            options.seconds = atoi(value);
+        } else if (arg == "--warmup") {
+            options.warmup = atoi(value);
+        } else if (arg == "--delay") {
+            options.delayMs = atoi(value);
+        } else if (arg == "--jitter") {
+            options.jitterMs = atoi(value);
+        } else if (arg == "--loss") {
+            options.loss = atof(value);
+        } else if (arg == "--burst") {
+            options.burst = atof(value);
+        } else if (arg == "--codec") {
+            if (strcmp(value, "pcm") == 0) {
+                options.codec = AudioCodec::Type::Pcm16;
+            } else if (strcmp(value, "opus") == 0) {
+                options.codec = AudioCodec::Type::Opus;
+            } else {
+                return false;
+            }
+        } else if (arg == "--interval") {
+            options.intervalMs = atoi(value);
+        } else if (arg == "--port") {
+            options.port = quint16(atoi(value));
+        } else {
+            return false;
+        }
+    }
+    return options.seconds > 0 && options.warmup >= 0 && options.delayMs >= 0 && options.jitterMs >= 0
+           && options.loss >= 0.0 && options.loss < 1.0 && options.burst >= 1.0 && options.intervalMs > 100;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "LatencyHarness: bad arguments; see the comment at the top of LatencyHarness.cpp\n");
+        return 1;
+    }
+#ifndef USE_OPUS
+    if (options.codec == AudioCodec::Type::Opus) {
+        fprintf(stderr, "LatencyHarness: built without Opus, using PCM\n");
+        options.codec = AudioCodec::Type::Pcm16;
+    }
+#endif
+    const int bitrate = options.codec == AudioCodec::Type::Opus ? Config::AUDIO_CODEC_BITRATE : 0;
+    const quint16 senderPort = options.port;
+    const quint16 receiverPort = quint16(options.port + 1);
+    const quint16 relayPort = quint16(options.port + 2);
+
+    QElapsedTimer clock;
+    clock.start();
+
+    ImpairmentRelay relay(options, clock);
+    if (!relay.start(relayPort, receiverPort)) {
+        fprintf(stderr, "LatencyHarness: cannot bind relay port %u\n", relayPort);
+        return 1;
+    }
+
+    ClickTrainDevice clicks(clock, options.intervalMs);
+    clicks.open(QIODevice::ReadOnly);
+    ClickDetector detector(clock, options.intervalMs);
+    detector.open(QIODevice::WriteOnly);
+
+    AudioEngine senderEngine;
+    AudioEngine receiverEngine;
+    AudioTransport sender(&senderEngine);
+    AudioTransport receiver(&receiverEngine);
+    sender.setCodec(options.codec, bitrate);
+    receiver.setCodec(options.codec, bitrate);
+
+    // The receiver only plays; its loss reports go straight back to the
+    // sender's port.
+    if (!receiver.startTransport(receiverPort, QStringLiteral("127.0.0.1"), senderPort)
+        || !sender.startTransport(senderPort, QStringLiteral("127.0.0.1"), relayPort)) {
+        fprintf(stderr, "LatencyHarness: cannot bind ports %u-%u\n", senderPort, receiverPort);
+        return 1;
+    }
+    receiverEngine.startPlayback(&detector);
+    clicks.startClock();
+    senderEngine.startCapture(&clicks);
+
+    std::clock_t cpuStart = 0;
+    qint64 playedAtWarmup = 0;
+    AudioTransport::Stats statsAtWarmup;
+    QTimer::singleShot(options.warmup * 1000, &app, [&]() {
+        cpuStart = std::clock();
+        playedAtWarmup = detector.playedSamples();
+        statsAtWarmup = receiver.stats();
+    });
+    QTimer::singleShot((options.warmup + options.seconds) * 1000, &app, &QCoreApplication::quit);
+    app.exec();
+
+    const std::clock_t cpuEnd = std::clock();
+    senderEngine.stopCapture();
+    receiverEngine.stopPlayback();
+    const AudioTransport::Stats stats = receiver.stats();
+    const AudioTransport::Stats senderStats = sender.stats();
+    sender.stopTransport();
+    receiver.stopTransport();
+
+    // Click k left the "mouth" at origin + k * interval; each onset is
+    // matched to the latest click before it.
+    const qint64 intervalNs = qint64(options.intervalMs) * 1000000;
+    const qint64 warmupEndNs = clicks.origin() + qint64(options.warmup) * 1000000000;
+    std::vector<double> latencies;
+    for (qint64 onset : detector.onsets()) {
+        const qint64 sinceOrigin = onset - clicks.origin();
+        if (onset < warmupEndNs || sinceOrigin < intervalNs) {
+            continue;
+        }
+        latencies.push_back(double(sinceOrigin % intervalNs) / 1e6);
+    }
+    const qint64 expectedClicks = qint64(options.seconds) * 1000 / options.intervalMs;
+    const qint64 frames =
+        qMax<qint64>(1, (detector.playedSamples() - playedAtWarmup) / Config::AUDIO_DEVICE_FRAME_SAMPLES);
+    const quint64 plcFrames = stats.plcFrames - statsAtWarmup.plcFrames;
+    const double cpuUsPerFrame = double(cpuEnd - cpuStart) * 1e6 / CLOCKS_PER_SEC / double(frames);
+
+    printf("LatencyHarness: %s at %d Hz, delay %d ms, jitter 0..%d ms, loss %.1f%% (burst %.1f), %d s\n",
+           options.codec == AudioCodec::Type::Opus ? "opus" : "pcm",
+           Config::AUDIO_SAMPLE_RATE,
+           options.delayMs,
+           options.jitterMs,
+           options.loss * 100.0,
+           options.burst,
+           options.seconds);
+    printf("  relay          forwarded %llu, dropped %llu\n",
+           static_cast<unsigned long long>(relay.forwardedPackets()),
+           static_cast<unsigned long long>(relay.droppedPackets()));
+    if (latencies.empty()) {
+        printf("  latency        no clicks detected\n");
+    } else {
+        std::sort(latencies.begin(), latencies.end());
+        printf("  latency        p50 %6.1f ms  p95 %6.1f ms  p99 %6.1f ms  min %6.1f  max %6.1f  "
+               "(%zu/%lld clicks)\n",
+               percentile(latencies, 50),
+               percentile(latencies, 95),
+               percentile(latencies, 99),
+               latencies.front(),
+               latencies.back(),
+               latencies.size(),
+               static_cast<long long>(expectedClicks));
+    }
+    printf("  playout        PLC %llu frames (%.2f%%), loss events %llu, recovered %llu, redundancy %d\n",
+           static_cast<unsigned long long>(plcFrames),
+           100.0 * double(plcFrames) / double(frames),
+           static_cast<unsigned long long>(stats.lossEvents - statsAtWarmup.lossEvents),
+           static_cast<unsigned long long>(stats.recovered - statsAtWarmup.recovered),
+           senderStats.redundancyDepth);
+    printf("  jitter buffer  target %d, depth %d, underruns %llu, accelerate %llu, expand %llu, trimmed %llu\n",
+           stats.targetFrames,
+           stats.jitterDepth,
+           static_cast<unsigned long long>(stats.underruns),
+           static_cast<unsigned long long>(stats.accelerate),
+           static_cast<unsigned long long>(stats.expand),
+           static_cast<unsigned long long>(stats.trimmed));
+    printf("  cpu            %.1f us per frame\n", cpuUsPerFrame);
+    return 0;
+}
@@ -0,0 +1,214 @@
+// Offline harness for PacketLossConcealer. Runs a PCM file through
+// simulated loss patterns and reports the CPU cost per concealed frame and
+// the SNR of the concealed frames against the original audio.
+//
+//   PlcHarness [-o prefix] [input.pcm] [pattern ...]
+//
+// input.pcm is raw 48 kHz mono s16le; without it a synthetic voiced test
+// signal is used. Patterns:
+//   random:P          each frame lost with probability P (0..1)
+//   burst:P:LEN       Gilbert model: bursts start with probability P and
+//                     last LEN frames on average
+//   periodic:N:M      N consecutive frames lost every M frames
+// With -o, the concealed stream of each pattern is written to
+// <prefix>_<pattern>.pcm (':' replaced by '_') for listening.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "audio/PacketLossConcealer.h"
+#include "common/Config.h"
+
+namespace {
+
+constexpr int kFrame = Config::AUDIO_FRAME_SAMPLES;
+constexpr double kPi = 3.14159265358979323846;
+
+struct LossPattern
+{
+    std::string name;
+    std::vector<bool> lost;
+};
+
+std::vector<qint16> loadPcm(const char *path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return {};
+    }
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::vector<qint16> samples(bytes.size() / sizeof(qint16));
+    memcpy(samples.data(), bytes.data(), samples.size() * sizeof(qint16));
+    return samples;
+}
+
+// Ten seconds of harmonic "speech": gliding pitch, a slow syllable
+// envelope and short pauses.
+std::vector<qint16> syntheticSpeech()
+{
+    const int total = Config::AUDIO_SAMPLE_RATE * 10;
+    std::vector<qint16> samples(static_cast<size_t>(total));
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0.0, 150.0);
+    double phase = 0.0;
+    for (int i = 0; i < total; ++i) {
+        const double t = double(i) / Config::AUDIO_SAMPLE_RATE;
+        const double f0 = 140.0 + 40.0 * std::sin(2.0 * kPi * 0.7 * t);
+        phase += 2.0 * kPi * f0 / Config::AUDIO_SAMPLE_RATE;
+        double voiced = 0.0;
+        for (int h = 1; h <= 8; ++h) {
+            voiced += std::sin(h * phase) / h;
+        }
+        const double syllable = std::max(0.0, std::sin(2.0 * kPi * 2.5 * t));
+        samples[static_cast<size_t>(i)] = qint16(std::clamp(6000.0 * syllable * voiced + noise(rng), -32768.0, 32767.0));
+    }
+    return samples;
+}
+
+bool parsePattern(const std::string &spec, int frames, std::mt19937 &rng, LossPattern &out)
+{
+    out.name = spec;
+    out.lost.assign(static_cast<size_t>(frames), false);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    double a = 0.0;
+    double b = 0.0;
+    if (sscanf(spec.c_str(), "random:%lf", &a) == 1) {
+        for (int i = 0; i < frames; ++i) {
+            out.lost[static_cast<size_t>(i)] = uniform(rng) < a;
+        }
+        return true;
+    }
+    if (sscanf(spec.c_str(), "burst:%lf:%lf", &a, &b) == 2 && b >= 1.0) {
+        bool inBurst = false;
+        for (int i = 0; i < frames; ++i) {
+            inBurst = inBurst ? uniform(rng) >= 1.0 / b : uniform(rng) < a;
+            out.lost[static_cast<size_t>(i)] = inBurst;
+        }
+        return true;
+    }
+    if (sscanf(spec.c_str(), "periodic:%lf:%lf", &a, &b) == 2 && b > a) {
+        for (int i = 0; i < frames; ++i) {
+            out.lost[static_cast<size_t>(i)] = (i % int(b)) < int(a);
+        }
+        return true;
+    }
+    return false;
+}
+
+void runPattern(const std::vector<qint16> &input, const LossPattern &pattern, const std::string &outputPrefix)
+{
+    const int frames = int(input.size() / kFrame);
+    std::vector<qint16> output(static_cast<size_t>(frames) * kFrame);
+    std::vector<double> costs;
+    double signalEnergy = 0.0;
+    double errorEnergy = 0.0;
+
+    PacketLossConcealer plc;
+    for (int f = 0; f < frames; ++f) {
+        const qint16 *original = input.data() + static_cast<size_t>(f) * kFrame;
+        qint16 *out = output.data() + static_cast<size_t>(f) * kFrame;
+
+        if (!pattern.lost[static_cast<size_t>(f)]) {
+            memcpy(out, original, kFrame * sizeof(qint16));
+            plc.processReceived(out, kFrame);
+            continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        plc.conceal(out, kFrame);
+        const auto end = std::chrono::steady_clock::now();
+        costs.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+
+        for (int i = 0; i < kFrame; ++i) {
+            const double err = double(out[i]) - original[i];
+            signalEnergy += double(original[i]) * original[i];
+            errorEnergy += err * err;
+        }
+    }
+
+    if (costs.empty()) {
+        printf("%-22s no frames lost\n", pattern.name.c_str());
+        return;
+    }
+
+    std::sort(costs.begin(), costs.end());
+    double mean = 0.0;
+    for (double c : costs) {
+        mean += c;
+    }
+    mean /= double(costs.size());
+    const double p99 = costs[std::min(costs.size() - 1, costs.size() * 99 / 100)];
+    const double snr = errorEnergy > 0.0 ? 10.0 * std::log10(signalEnergy / errorEnergy) : 99.0;
+
+    printf("%-22s lost %5zu/%5d frames (%5.1f%%)  cost/frame mean %6.2f us  p99 %6.2f us  max %6.2f us  "
+           "concealed SNR %6.2f dB\n",
+           pattern.name.c_str(),
+           costs.size(),
+           frames,
+           100.0 * double(costs.size()) / frames,
+           mean,
+           p99,
+           costs.back(),
+           snr);
+
+    if (!outputPrefix.empty()) {
+        std::string name = pattern.name;
+        std::replace(name.begin(), name.end(), ':', '_');
+        std::ofstream out(outputPrefix + "_" + name + ".pcm", std::ios::binary);
+        out.write(reinterpret_cast<const char *>(output.data()), std::streamsize(output.size() * sizeof(qint16)));
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string outputPrefix;
+    std::string inputPath;
+    std::vector<std::string> specs;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            outputPrefix = argv[++i];
+        } else if (arg.find(':') != std::string::npos) {
+            specs.push_back(arg);
+        } else {
+            inputPath = arg;
+        }
+    }
+
+    std::vector<qint16> input = inputPath.empty() ? syntheticSpeech() : loadPcm(inputPath.c_str());
+    if (input.size() < static_cast<size_t>(kFrame)) {
+        fprintf(stderr, "PlcHarness: no usable audio in %s\n", inputPath.c_str());
+        return 1;
+    }
+    if (specs.empty()) {
+        specs = {"random:0.05", "random:0.15", "burst:0.02:3", "burst:0.01:6", "periodic:1:10", "periodic:3:25"};
+    }
+
+    printf("PlcHarness: %s, %.1f s\n",
+           inputPath.empty() ? "synthetic speech" : inputPath.c_str(),
+           double(input.size()) / Config::AUDIO_SAMPLE_RATE);
+
+    std::mt19937 rng(1234);
+    const int frames = int(input.size() / kFrame);
+    for (const std::string &spec : specs) {
+        LossPattern pattern;
+        if (!parsePattern(spec, frames, rng, pattern)) {
+            fprintf(stderr, "PlcHarness: bad loss pattern '%s'\n", spec.c_str());
+            return 1;
+        }
+        runPattern(input, pattern, outputPrefix);
+    }
+    return 0;
+}
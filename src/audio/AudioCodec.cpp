@@ -0,0 +1,261 @@
+#include "AudioCodec.h"
+
+#include <cstring>
+
+#include "common/Config.h"
+#include "common/Logger.h"
+
+#ifdef USE_OPUS
+#include <opus.h>
+#endif
+
+namespace {
+
+class Pcm16Codec : public AudioCodec
+{
+public:
+    Type type() const override { return Type::Pcm16; }
+
+    bool encode(const QByteArray &pcm, QByteArray &outPayload) override
+    {
+        outPayload = pcm;
+        return !outPayload.isEmpty();
+    }
+
+    bool decode(const QByteArray &payload, QByteArray &outPcm) override
+    {
+        if (payload.size() % int(sizeof(qint16)) != 0) {
+            return false;
+        }
+        outPcm = payload;
+        return !outPcm.isEmpty();
+    }
+
+    int encodeFrame(const qint16 *pcm, int samples, uchar *out, int maxBytes) override
+    {
+        const int bytes = samples * int(sizeof(qint16));
+        if (samples <= 0 || bytes > maxBytes) {
+            return -1;
+        }
+        memcpy(out, pcm, size_t(bytes));
+        return bytes;
+    }
+};
+
+#ifdef USE_OPUS
+// Largest Opus frame (120 ms at 48 kHz); used to size the decode buffer.
+constexpr int kOpusMaxFrameSamples = 5760;
+// Generous upper bound for one encoded 20 ms frame.
+constexpr int kOpusMaxPacketBytes = 1275;
+
+class OpusCodec : public AudioCodec
+{
+public:
+    explicit OpusCodec(int bitrate)
+        : encoder(nullptr)
+        , decoder(nullptr)
+    {
+        int error = OPUS_OK;
+        encoder = opus_encoder_create(Config::AUDIO_SAMPLE_RATE,
+                                      Config::AUDIO_CHANNELS,
+                                      OPUS_APPLICATION_VOIP,
+                                      &error);
+        if (error != OPUS_OK) {
+            encoder = nullptr;
+            LOG_WARN(QStringLiteral("OpusCodec: failed to create encoder - %1")
+                         .arg(QString::fromUtf8(opus_strerror(error))));
+        } else {
+            opus_encoder_ctl(encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+            opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(5));
+            setBitrate(bitrate);
+        }
+
+        decoder = opus_decoder_create(Config::AUDIO_SAMPLE_RATE, Config::AUDIO_CHANNELS, &error);
+        if (error != OPUS_OK) {
+            decoder = nullptr;
+            LOG_WARN(QStringLiteral("OpusCodec: failed to create decoder - %1")
+                         .arg(QString::fromUtf8(opus_strerror(error))));
+        }
+    }
+
+    ~OpusCodec() override
+    {
+        if (encoder) {
+            opus_encoder_destroy(encoder);
+        }
+        if (decoder) {
+            opus_decoder_destroy(decoder);
+        }
+    }
+
+    bool isValid() const { return encoder && decoder; }
+
+    Type type() const override { return Type::Opus; }
+
+    bool encode(const QByteArray &pcm, QByteArray &outPayload) override
+    {
+        // Opus only accepts 2.5/5/10/20/40/60 ms frames; callers fall back
+        // to raw PCM for anything else.
+        const int samples = pcm.size() / int(sizeof(opus_int16) * Config::AUDIO_CHANNELS);
+        if (!encoder || !isValidFrameSize(samples)) {
+            return false;
+        }
+
+        outPayload.resize(kOpusMaxPacketBytes);
+        const opus_int32 bytes = opus_encode(encoder,
+                                             reinterpret_cast<const opus_int16 *>(pcm.constData()),
+                                             samples,
+                                             reinterpret_cast<unsigned char *>(outPayload.data()),
+                                             outPayload.size());
+        if (bytes <= 0) {
+            outPayload.clear();
+            return false;
+        }
+        outPayload.resize(int(bytes));
+        return true;
+    }
+
+    int encodeFrame(const qint16 *pcm, int samples, uchar *out, int maxBytes) override
+    {
+        if (!encoder || !isValidFrameSize(samples)) {
+            return -1;
+        }
+        const opus_int32 bytes = opus_encode(encoder, pcm, samples, out, maxBytes);
+        return bytes > 0 ? int(bytes) : -1;
+    }
+
+    bool decode(const QByteArray &payload, QByteArray &outPcm) override
+    {
+        if (!decoder || payload.isEmpty()) {
+            return false;
+        }
+
+        outPcm.resize(kOpusMaxFrameSamples * Config::AUDIO_CHANNELS * int(sizeof(opus_int16)));
+        const int samples = opus_decode(decoder,
+                                        reinterpret_cast<const unsigned char *>(payload.constData()),
+                                        payload.size(),
+                                        reinterpret_cast<opus_int16 *>(outPcm.data()),
+                                        kOpusMaxFrameSamples,
+                                        0);
+        if (samples <= 0) {
+            outPcm.clear();
+            return false;
+        }
+        outPcm.resize(samples * Config::AUDIO_CHANNELS * int(sizeof(opus_int16)));
+        return true;
+    }
+
+    void setBitrate(int bitsPerSecond) override
+    {
+        if (encoder && bitsPerSecond > 0) {
+            opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitsPerSecond));
+        }
+    }
+
+private:
+    static bool isValidFrameSize(int samples)
+    {
+        const int perMs = Config::AUDIO_SAMPLE_RATE / 1000;
+        return samples * 2 == perMs * 5 || samples == perMs * 5 || samples == perMs * 10
+               || samples == perMs * 20 || samples == perMs * 40 || samples == perMs * 60;
+    }
+
+    OpusEncoder *encoder;
+    OpusDecoder *decoder;
+};
+#endif // USE_OPUS
+
+} // namespace
+
+AudioCodec *AudioCodec::create(Type type, int bitrate)
+{
+    switch (type) {
+    case Type::Pcm16:
+        return new Pcm16Codec();
+    case Type::Opus:
+#ifdef USE_OPUS
+    {
+        auto *codec = new OpusCodec(bitrate > 0 ? bitrate : Config::AUDIO_CODEC_BITRATE);
+        if (!codec->isValid()) {
+            delete codec;
+            return nullptr;
+        }
+        return codec;
+    }
+#else
+        Q_UNUSED(bitrate);
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+bool AudioCodec::isSupported(Type type)
+{
+    switch (type) {
+    case Type::Pcm16:
+        return true;
+    case Type::Opus:
+#ifdef USE_OPUS
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+QString AudioCodec::name(Type type)
+{
+    switch (type) {
+    case Type::Pcm16:
+        return QStringLiteral("pcm16");
+    case Type::Opus:
+        return QStringLiteral("opus");
+    }
+    return QString();
+}
+
+bool AudioCodec::fromName(const QString &name, Type &outType)
+{
+    const QString normalized = name.trimmed().toLower();
+    if (normalized == QLatin1String("pcm16")) {
+        outType = Type::Pcm16;
+        return true;
+    }
+    if (normalized == QLatin1String("opus")) {
+        outType = Type::Opus;
+        return true;
+    }
+    return false;
+}
+
+QStringList AudioCodec::supportedNames()
+{
+    QStringList names;
+    if (isSupported(Type::Opus)) {
+        names << name(Type::Opus);
+    }
+    names << name(Type::Pcm16);
+    return names;
+}
+
+int AudioCodec::encodeFrame(const qint16 *pcm, int samples, uchar *out, int maxBytes)
+{
+    // Generic fallback through the QByteArray API; the built-in codecs
+    // override this with versions that do not allocate.
+    QByteArray payload;
+    if (samples <= 0
+        || !encode(QByteArray::fromRawData(reinterpret_cast<const char *>(pcm), samples * int(sizeof(qint16))),
+                   payload)
+        || payload.size() > maxBytes) {
+        return -1;
+    }
+    memcpy(out, payload.constData(), size_t(payload.size()));
+    return payload.size();
+}
+
+void AudioCodec::setBitrate(int bitsPerSecond)
+{
+    Q_UNUSED(bitsPerSecond);
+}
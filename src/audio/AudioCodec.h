@@ -0,0 +1,45 @@
+#ifndef AUDIOCODEC_H
+#define AUDIOCODEC_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+// Pluggable codec stage for 20 ms frames of mono int16 PCM at
+// Config::AUDIO_SAMPLE_RATE.
+//
+// Raw PCM is always available and doubles as the fallback when a
+// compressed codec is not compiled in or refuses a frame. Opus is
+// available when the project is built with ENABLE_OPUS.
+class AudioCodec
+{
+public:
+    // Values double as the payload type carried in AudioPacket headers,
+    // so they must stay stable across releases.
+    enum class Type : quint8 {
+        Pcm16 = 0,
+        Opus = 1
+    };
+
+    virtual ~AudioCodec() = default;
+
+    // Returns nullptr when the requested codec is not available in this build.
+    static AudioCodec *create(Type type, int bitrate);
+    static bool isSupported(Type type);
+    static QString name(Type type);
+    static bool fromName(const QString &name, Type &outType);
+    // Codec names supported by this build, most preferred first.
+    static QStringList supportedNames();
+
+    virtual Type type() const = 0;
+    virtual bool encode(const QByteArray &pcm, QByteArray &outPayload) = 0;
+    virtual bool decode(const QByteArray &payload, QByteArray &outPcm) = 0;
+    // Allocation-free variant for the real-time send path: encodes
+    // `samples` samples into `out` and returns the payload size, or -1 if
+    // the frame was refused or does not fit in maxBytes.
+    virtual int encodeFrame(const qint16 *pcm, int samples, uchar *out, int maxBytes);
+    virtual void setBitrate(int bitsPerSecond);
+};
+
+#endif // AUDIOCODEC_H
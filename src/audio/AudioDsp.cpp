@@ -0,0 +1,620 @@
+#include "AudioDsp.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define AUDIODSP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define AUDIODSP_TARGET(isa)
+#else
+#define AUDIODSP_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace AudioDsp {
+namespace {
+
+inline qint16 saturate16(qint32 value)
+{
+    return qint16(qBound(-32768, value, 32767));
+}
+
+inline float gainStep(int count, float startGain, float endGain)
+{
+    return count > 1 ? (endGain - startGain) / float(count - 1) : 0.0f;
+}
+
+Level finishLevel(int peak, qint64 sumAbs, quint64 sumSquares, int count)
+{
+    Level level;
+    if (count <= 0) {
+        return level;
+    }
+    level.peak = peak;
+    level.meanAbs = double(sumAbs) / double(count);
+    level.rms = std::sqrt(double(sumSquares) / double(count));
+    return level;
+}
+
+// ---------------------------------------------------------------------------
+// Scalar reference implementations. The SIMD variants hand their tails to
+// these, so they also define the exact semantics.
+
+void addSaturateScalar(qint16 *dst, const qint16 *src, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        dst[i] = saturate16(qint32(dst[i]) + qint32(src[i]));
+    }
+}
+
+void accumulateScalar(qint32 *acc, const qint16 *src, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        acc[i] += src[i];
+    }
+}
+
+bool packSaturateScalar(const qint32 *acc, const qint16 *exclude, qint16 *out, int count)
+{
+    int nonZero = 0;
+    for (int i = 0; i < count; ++i) {
+        const qint16 sample = saturate16(exclude ? acc[i] - exclude[i] : acc[i]);
+        out[i] = sample;
+        nonZero |= sample;
+    }
+    return nonZero != 0;
+}
+
+void gainRampScalarFrom(const qint16 *in, qint16 *out, int begin, int count, float startGain, float step)
+{
+    for (int i = begin; i < count; ++i) {
+        const float gain = startGain + step * float(i);
+        float value = float(in[i]) * gain;
+        value = value < -32768.0f ? -32768.0f : (value > 32767.0f ? 32767.0f : value);
+        out[i] = qint16(int(value));
+    }
+}
+
+void applyGainRampScalar(const qint16 *in, qint16 *out, int count, float startGain, float endGain)
+{
+    gainRampScalarFrom(in, out, 0, count, startGain, gainStep(count, startGain, endGain));
+}
+
+struct LevelSums
+{
+    int peak = 0;
+    qint64 sumAbs = 0;
+    quint64 sumSquares = 0;
+};
+
+void levelScalarFrom(const qint16 *samples, int begin, int count, LevelSums &sums)
+{
+    for (int i = begin; i < count; ++i) {
+        const int magnitude = qMin(std::abs(int(samples[i])), 32767);
+        sums.peak = qMax(sums.peak, magnitude);
+        sums.sumAbs += magnitude;
+        sums.sumSquares += quint64(magnitude * magnitude);
+    }
+}
+
+Level measureLevelScalar(const qint16 *samples, int count)
+{
+    LevelSums sums;
+    levelScalarFrom(samples, 0, count, sums);
+    return finishLevel(sums.peak, sums.sumAbs, sums.sumSquares, count);
+}
+
+qint32 dotProductScalar(const qint16 *a, const qint16 *b, int count)
+{
+    qint32 sum = 0;
+    for (int i = 0; i < count; ++i) {
+        sum += qint32(a[i]) * qint32(b[i]);
+    }
+    return sum;
+}
+
+#ifdef AUDIODSP_X86
+// Inner-loop iterations between flushes of the 32-bit |x| partial sums
+// (each lane gains at most 2 * 32767 per iteration).
+constexpr int kAbsFlushIterations = 16384;
+
+// ---------------------------------------------------------------------------
+// SSE2
+
+AUDIODSP_TARGET("sse2")
+void addSaturateSse2(qint16 *dst, const qint16 *src, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_adds_epi16(a, b));
+    }
+    addSaturateScalar(dst + i, src + i, count - i);
+}
+
+AUDIODSP_TARGET("sse2")
+void accumulateSse2(qint32 *acc, const qint16 *src, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128i sign = _mm_cmpgt_epi16(zero, x);
+        __m128i *out = reinterpret_cast<__m128i *>(acc + i);
+        _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), _mm_unpacklo_epi16(x, sign)));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(x, sign)));
+    }
+    accumulateScalar(acc + i, src + i, count - i);
+}
+
+AUDIODSP_TARGET("sse2")
+bool packSaturateSse2(const qint32 *acc, const qint16 *exclude, qint16 *out, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i nonZero = zero;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i *in = reinterpret_cast<const __m128i *>(acc + i);
+        __m128i lo = _mm_loadu_si128(in);
+        __m128i hi = _mm_loadu_si128(in + 1);
+        if (exclude) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(exclude + i));
+            const __m128i sign = _mm_cmpgt_epi16(zero, x);
+            lo = _mm_sub_epi32(lo, _mm_unpacklo_epi16(x, sign));
+            hi = _mm_sub_epi32(hi, _mm_unpackhi_epi16(x, sign));
+        }
+        const __m128i packed = _mm_packs_epi32(lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+        nonZero = _mm_or_si128(nonZero, packed);
+    }
+    const bool tail = packSaturateScalar(acc + i, exclude ? exclude + i : nullptr, out + i, count - i);
+    return tail || _mm_movemask_epi8(_mm_cmpeq_epi8(nonZero, zero)) != 0xFFFF;
+}
+
+AUDIODSP_TARGET("sse2")
+void applyGainRampSse2(const qint16 *in, qint16 *out, int count, float startGain, float endGain)
+{
+    const float step = gainStep(count, startGain, endGain);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 start = _mm_set1_ps(startGain);
+    const __m128 stepV = _mm_set1_ps(step);
+    const __m128 lanesLo = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 lanesHi = _mm_setr_ps(4.0f, 5.0f, 6.0f, 7.0f);
+    const __m128 minV = _mm_set1_ps(-32768.0f);
+    const __m128 maxV = _mm_set1_ps(32767.0f);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i sign = _mm_cmpgt_epi16(zero, x);
+        const __m128 base = _mm_set1_ps(float(i));
+        const __m128 gainLo = _mm_add_ps(start, _mm_mul_ps(stepV, _mm_add_ps(base, lanesLo)));
+        const __m128 gainHi = _mm_add_ps(start, _mm_mul_ps(stepV, _mm_add_ps(base, lanesHi)));
+        __m128 lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(x, sign)), gainLo);
+        __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(x, sign)), gainHi);
+        lo = _mm_min_ps(_mm_max_ps(lo, minV), maxV);
+        hi = _mm_min_ps(_mm_max_ps(hi, minV), maxV);
+        const __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+    }
+    gainRampScalarFrom(in, out, i, count, startGain, step);
+}
+
+AUDIODSP_TARGET("sse2")
+Level measureLevelSse2(const qint16 *samples, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i peak = zero;
+    __m128i absSum = zero;
+    __m128i squareSum = zero;
+    LevelSums sums;
+
+    int i = 0;
+    int sinceFlush = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        const __m128i magnitude = _mm_max_epi16(x, _mm_subs_epi16(zero, x));
+        peak = _mm_max_epi16(peak, magnitude);
+        absSum = _mm_add_epi32(absSum, _mm_madd_epi16(magnitude, ones));
+        const __m128i squares = _mm_madd_epi16(magnitude, magnitude);
+        squareSum = _mm_add_epi64(squareSum,
+                                  _mm_add_epi64(_mm_unpacklo_epi32(squares, zero),
+                                                _mm_unpackhi_epi32(squares, zero)));
+        if (++sinceFlush == kAbsFlushIterations) {
+            alignas(16) qint32 partial[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(partial), absSum);
+            sums.sumAbs += qint64(partial[0]) + partial[1] + partial[2] + partial[3];
+            absSum = zero;
+            sinceFlush = 0;
+        }
+    }
+
+    alignas(16) qint16 peaks[8];
+    alignas(16) qint32 partial[4];
+    alignas(16) quint64 squares[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(peaks), peak);
+    _mm_store_si128(reinterpret_cast<__m128i *>(partial), absSum);
+    _mm_store_si128(reinterpret_cast<__m128i *>(squares), squareSum);
+    for (qint16 p : peaks) {
+        sums.peak = qMax(sums.peak, int(p));
+    }
+    sums.sumAbs += qint64(partial[0]) + partial[1] + partial[2] + partial[3];
+    sums.sumSquares += squares[0] + squares[1];
+
+    levelScalarFrom(samples, i, count, sums);
+    return finishLevel(sums.peak, sums.sumAbs, sums.sumSquares, count);
+}
+
+AUDIODSP_TARGET("sse2")
+qint32 dotProductSse2(const qint16 *a, const qint16 *b, int count)
+{
+    __m128i sum = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(x, y));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum) + dotProductScalar(a + i, b + i, count - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2. 256-bit packs work per 128-bit lane, hence the permute after each.
+
+AUDIODSP_TARGET("avx2")
+void addSaturateAvx2(qint16 *dst, const qint16 *src, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_adds_epi16(a, b));
+    }
+    addSaturateScalar(dst + i, src + i, count - i);
+}
+
+AUDIODSP_TARGET("avx2")
+void accumulateAvx2(qint32 *acc, const qint16 *src, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        const __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8)));
+        __m256i *out = reinterpret_cast<__m256i *>(acc + i);
+        _mm256_storeu_si256(out, _mm256_add_epi32(_mm256_loadu_si256(out), lo));
+        _mm256_storeu_si256(out + 1, _mm256_add_epi32(_mm256_loadu_si256(out + 1), hi));
+    }
+    accumulateScalar(acc + i, src + i, count - i);
+}
+
+AUDIODSP_TARGET("avx2")
+bool packSaturateAvx2(const qint32 *acc, const qint16 *exclude, qint16 *out, int count)
+{
+    __m256i nonZero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i *in = reinterpret_cast<const __m256i *>(acc + i);
+        __m256i lo = _mm256_loadu_si256(in);
+        __m256i hi = _mm256_loadu_si256(in + 1);
+        if (exclude) {
+            lo = _mm256_sub_epi32(lo, _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(exclude + i))));
+            hi = _mm256_sub_epi32(hi, _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(exclude + i + 8))));
+        }
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+        nonZero = _mm256_or_si256(nonZero, packed);
+    }
+    const bool tail = packSaturateScalar(acc + i, exclude ? exclude + i : nullptr, out + i, count - i);
+    return tail || !_mm256_testz_si256(nonZero, nonZero);
+}
+
+AUDIODSP_TARGET("avx2")
+void applyGainRampAvx2(const qint16 *in, qint16 *out, int count, float startGain, float endGain)
+{
+    const float step = gainStep(count, startGain, endGain);
+    const __m256 start = _mm256_set1_ps(startGain);
+    const __m256 stepV = _mm256_set1_ps(step);
+    const __m256 lanesLo = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 lanesHi = _mm256_setr_ps(8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+    const __m256 minV = _mm256_set1_ps(-32768.0f);
+    const __m256 maxV = _mm256_set1_ps(32767.0f);
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i xLo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+        const __m256i xHi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8)));
+        const __m256 base = _mm256_set1_ps(float(i));
+        const __m256 gainLo = _mm256_add_ps(start, _mm256_mul_ps(stepV, _mm256_add_ps(base, lanesLo)));
+        const __m256 gainHi = _mm256_add_ps(start, _mm256_mul_ps(stepV, _mm256_add_ps(base, lanesHi)));
+        __m256 lo = _mm256_mul_ps(_mm256_cvtepi32_ps(xLo), gainLo);
+        __m256 hi = _mm256_mul_ps(_mm256_cvtepi32_ps(xHi), gainHi);
+        lo = _mm256_min_ps(_mm256_max_ps(lo, minV), maxV);
+        hi = _mm256_min_ps(_mm256_max_ps(hi, minV), maxV);
+        const __m256i packed =
+            _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_cvttps_epi32(lo), _mm256_cvttps_epi32(hi)), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+    }
+    gainRampScalarFrom(in, out, i, count, startGain, step);
+}
+
+AUDIODSP_TARGET("avx2")
+Level measureLevelAvx2(const qint16 *samples, int count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i peak = zero;
+    __m256i absSum = zero;
+    __m256i squareSum = zero;
+    LevelSums sums;
+
+    int i = 0;
+    int sinceFlush = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+        const __m256i magnitude = _mm256_max_epi16(x, _mm256_subs_epi16(zero, x));
+        peak = _mm256_max_epi16(peak, magnitude);
+        absSum = _mm256_add_epi32(absSum, _mm256_madd_epi16(magnitude, ones));
+        const __m256i squares = _mm256_madd_epi16(magnitude, magnitude);
+        squareSum = _mm256_add_epi64(squareSum,
+                                     _mm256_add_epi64(_mm256_unpacklo_epi32(squares, zero),
+                                                      _mm256_unpackhi_epi32(squares, zero)));
+        if (++sinceFlush == kAbsFlushIterations) {
+            alignas(32) qint32 partial[8];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(partial), absSum);
+            for (qint32 p : partial) {
+                sums.sumAbs += p;
+            }
+            absSum = zero;
+            sinceFlush = 0;
+        }
+    }
+
+    alignas(32) qint16 peaks[16];
+    alignas(32) qint32 partial[8];
+    alignas(32) quint64 squares[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(peaks), peak);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(partial), absSum);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(squares), squareSum);
+    for (qint16 p : peaks) {
+        sums.peak = qMax(sums.peak, int(p));
+    }
+    for (qint32 p : partial) {
+        sums.sumAbs += p;
+    }
+    sums.sumSquares += squares[0] + squares[1] + squares[2] + squares[3];
+
+    levelScalarFrom(samples, i, count, sums);
+    return finishLevel(sums.peak, sums.sumAbs, sums.sumSquares, count);
+}
+
+AUDIODSP_TARGET("avx2")
+qint32 dotProductAvx2(const qint16 *a, const qint16 *b, int count)
+{
+    __m256i sum = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, y));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half) + dotProductScalar(a + i, b + i, count - i);
+}
+#endif // AUDIODSP_X86
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+struct Kernels
+{
+    Isa isa;
+    void (*addSaturate)(qint16 *, const qint16 *, int);
+    void (*accumulate)(qint32 *, const qint16 *, int);
+    bool (*packSaturate)(const qint32 *, const qint16 *, qint16 *, int);
+    void (*applyGainRamp)(const qint16 *, qint16 *, int, float, float);
+    Level (*measureLevel)(const qint16 *, int);
+    qint32 (*dotProduct)(const qint16 *, const qint16 *, int);
+};
+
+const Kernels kScalarKernels = {Isa::Scalar,
+                                addSaturateScalar,
+                                accumulateScalar,
+                                packSaturateScalar,
+                                applyGainRampScalar,
+                                measureLevelScalar,
+                                dotProductScalar};
+
+#ifdef AUDIODSP_X86
+const Kernels kSse2Kernels = {Isa::Sse2,
+                              addSaturateSse2,
+                              accumulateSse2,
+                              packSaturateSse2,
+                              applyGainRampSse2,
+                              measureLevelSse2,
+                              dotProductSse2};
+
+const Kernels kAvx2Kernels = {Isa::Avx2,
+                              addSaturateAvx2,
+                              accumulateAvx2,
+                              packSaturateAvx2,
+                              applyGainRampAvx2,
+                              measureLevelAvx2,
+                              dotProductAvx2};
+
+struct CpuFeatures
+{
+    bool sse2 = false;
+    bool avx2 = false;
+};
+
+CpuFeatures detectCpuFeatures()
+{
+    CpuFeatures features;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {0, 0, 0, 0};
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    features.sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    // AVX state must also be enabled by the OS (XCR0 bits 1 and 2).
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        features.avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    features.sse2 = __builtin_cpu_supports("sse2");
+    features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return features;
+}
+
+const CpuFeatures &cpuFeatures()
+{
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
+#endif // AUDIODSP_X86
+
+const Kernels *kernelsFor(Isa isa)
+{
+    switch (isa) {
+    case Isa::Scalar:
+        return &kScalarKernels;
+#ifdef AUDIODSP_X86
+    case Isa::Sse2:
+        return &kSse2Kernels;
+    case Isa::Avx2:
+        return &kAvx2Kernels;
+#else
+    case Isa::Sse2:
+    case Isa::Avx2:
+        break;
+#endif
+    }
+    return &kScalarKernels;
+}
+
+std::atomic<const Kernels *> g_activeKernels{nullptr};
+
+const Kernels &kernels()
+{
+    const Kernels *active = g_activeKernels.load(std::memory_order_acquire);
+    if (!active) {
+        active = kernelsFor(bestSupportedIsa());
+        g_activeKernels.store(active, std::memory_order_release);
+    }
+    return *active;
+}
+
+} // namespace
+
+bool isSupported(Isa isa)
+{
+    switch (isa) {
+    case Isa::Scalar:
+        return true;
+#ifdef AUDIODSP_X86
+    case Isa::Sse2:
+        return cpuFeatures().sse2;
+    case Isa::Avx2:
+        return cpuFeatures().avx2;
+#else
+    case Isa::Sse2:
+    case Isa::Avx2:
+        return false;
+#endif
+    }
+    return false;
+}
+
+Isa bestSupportedIsa()
+{
+    if (isSupported(Isa::Avx2)) {
+        return Isa::Avx2;
+    }
+    if (isSupported(Isa::Sse2)) {
+        return Isa::Sse2;
+    }
+    return Isa::Scalar;
+}
+
+Isa activeIsa()
+{
+    return kernels().isa;
+}
+
+bool setIsa(Isa isa)
+{
+    if (!isSupported(isa)) {
+        return false;
+    }
+    g_activeKernels.store(kernelsFor(isa), std::memory_order_release);
+    return true;
+}
+
+const char *isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::Scalar:
+        return "scalar";
+    case Isa::Sse2:
+        return "sse2";
+    case Isa::Avx2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+void addSaturate(qint16 *dst, const qint16 *src, int count)
+{
+    if (count > 0) {
+        kernels().addSaturate(dst, src, count);
+    }
+}
+
+void accumulate(qint32 *acc, const qint16 *src, int count)
+{
+    if (count > 0) {
+        kernels().accumulate(acc, src, count);
+    }
+}
+
+bool packSaturate(const qint32 *acc, const qint16 *exclude, qint16 *out, int count)
+{
+    return count > 0 && kernels().packSaturate(acc, exclude, out, count);
+}
+
+void applyGainRamp(const qint16 *in, qint16 *out, int count, float startGain, float endGain)
+{
+    if (count > 0) {
+        kernels().applyGainRamp(in, out, count, startGain, endGain);
+    }
+}
+
+Level measureLevel(const qint16 *samples, int count)
+{
+    if (count <= 0) {
+        return Level();
+    }
+    return kernels().measureLevel(samples, count);
+}
+
+qint32 dotProduct(const qint16 *a, const qint16 *b, int count)
+{
+    return count > 0 ? kernels().dotProduct(a, b, count) : 0;
+}
+
+} // namespace AudioDsp
@@ -0,0 +1,57 @@
+#ifndef AUDIODSP_H
+#define AUDIODSP_H
+
+#include <QtGlobal>
+
+// Small DSP kernel library for int16 PCM.
+//
+// Every kernel has a scalar reference implementation plus SSE2 and AVX2
+// variants on x86. The fastest variant the CPU supports is picked on
+// first use; setIsa() lets benchmarks and tests force a specific one.
+// Integer kernels give bit-identical results on every variant.
+namespace AudioDsp {
+
+enum class Isa {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+struct Level
+{
+    // Absolute values are saturated to 32767 (|-32768| counts as 32767).
+    int peak = 0;
+    double rms = 0.0;
+    double meanAbs = 0.0;
+};
+
+Isa activeIsa();
+Isa bestSupportedIsa();
+bool isSupported(Isa isa);
+// Returns false (and keeps the current variant) if the CPU lacks the ISA.
+bool setIsa(Isa isa);
+const char *isaName(Isa isa);
+
+// dst[i] = saturate(dst[i] + src[i])
+void addSaturate(qint16 *dst, const qint16 *src, int count);
+
+// acc[i] += src[i], for mixing many streams without intermediate clipping.
+void accumulate(qint32 *acc, const qint16 *src, int count);
+
+// out[i] = saturate(acc[i] - exclude[i]); exclude may be null. Returns
+// false when every output sample is zero.
+bool packSaturate(const qint32 *acc, const qint16 *exclude, qint16 *out, int count);
+
+// Linear gain ramp from startGain (first sample) to endGain (last sample),
+// truncating towards zero and saturating. in and out may alias.
+void applyGainRamp(const qint16 *in, qint16 *out, int count, float startGain, float endGain);
+
+Level measureLevel(const qint16 *samples, int count);
+
+// Sum of a[i] * b[i] in 32 bits, for FIR filters with Q15 taps. Callers
+// keep the sum of |b| below 2.0 so that the result cannot overflow.
+qint32 dotProduct(const qint16 *a, const qint16 *b, int count);
+
+} // namespace AudioDsp
+
+#endif // AUDIODSP_H
@@ -1,33 +1,158 @@
 #include "AudioEngine.h"
 
+#include <QMetaObject>
+#include <QTimer>
+#include <algorithm>
+#include <cstring>
+
+#include "Resampler.h"
 #include "common/Logger.h"
 
+namespace {
+// Depth of the playAudio() ring. Kept short: anything the device has not
+// consumed within ~80 ms is stale and better dropped than played late.
+constexpr int kPlaybackRingFrames = 4;
+constexpr bool kResampling = Config::AUDIO_SAMPLE_RATE != Config::AUDIO_DEVICE_SAMPLE_RATE;
+// Device samples converted per capture read.
+constexpr int kCaptureChunkSamples = Config::AUDIO_DEVICE_FRAME_SAMPLES * 4;
+}
+
+// Pull-mode device handed to the QAudioSink. The sink reads from it on the
+// audio thread whenever its buffer has room; data comes from the
+// engine's current playback source one frame at a time, and gaps are
+// filled with silence so the device clock never stalls.
+class AudioPlaybackDevice : public QIODevice
+{
+public:
+    explicit AudioPlaybackDevice(AudioEngine *engineValue)
+        : engine(engineValue)
+        , frameBytes(0)
+        , frameOffset(0)
+    {
+    }
+
+    bool isSequential() const override { return true; }
+
+    qint64 bytesAvailable() const override
+    {
+        // Audio is always available (silence at worst).
+        return qint64(sizeof(frame)) + QIODevice::bytesAvailable();
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        qint64 written = 0;
+        while (written < maxSize) {
+            if (frameOffset >= frameBytes) {
+                frameBytes = engine->pullPlayback(frame) * int(sizeof(qint16));
+                frameOffset = 0;
+                if (frameBytes <= 0) {
+                    frameBytes = 0;
+                    memset(data + written, 0, size_t(maxSize - written));
+                    return maxSize;
+                }
+            }
+
+            const qint64 chunk = std::min<qint64>(maxSize - written, frameBytes - frameOffset);
+            memcpy(data + written, reinterpret_cast<const char *>(frame) + frameOffset, size_t(chunk));
+            written += chunk;
+            frameOffset += int(chunk);
+        }
+        return written;
+    }
+
+    qint64 writeData(const char *data, qint64 maxSize) override
+    {
+        Q_UNUSED(data);
+        Q_UNUSED(maxSize);
+        return -1;
+    }
+
+private:
+    AudioEngine *engine;
+    qint16 frame[Config::AUDIO_DEVICE_FRAME_SAMPLES];
+    int frameBytes;
+    int frameOffset;
+};
+
 AudioEngine::AudioEngine(QObject *parent)
     : QObject(parent)
     , audioSource(nullptr)
     , audioSink(nullptr)
     , inputDevice(nullptr)
-    , outputDevice(nullptr)
+    , playbackDevice(nullptr)
+    , playbackOutput(nullptr)
+    , playbackClock(nullptr)
+    , playbackClockFrames(0)
+    , captureResampler(nullptr)
+    , playbackResampler(nullptr)
+    , engineThread()
+    , threadContext(new QObject)
+    , playbackRunning(false)
+    , playbackBufferDurationMs(Config::AUDIO_PLAYBACK_BUFFER_MS)
+    , playbackSource(nullptr)
+    , playbackRing(kPlaybackRingFrames)
+    , playbackOverflowCount(0)
 {
-    format.setSampleRate(48000);
+    format.setSampleRate(Config::AUDIO_DEVICE_SAMPLE_RATE);
     format.setChannelCount(1);
     format.setSampleFormat(QAudioFormat::Int16);
+
+    if (kResampling) {
+        captureResampler =
+            new Resampler(Config::AUDIO_DEVICE_SAMPLE_RATE, Config::AUDIO_SAMPLE_RATE, kCaptureChunkSamples);
+        playbackResampler =
+            new Resampler(Config::AUDIO_SAMPLE_RATE, Config::AUDIO_DEVICE_SAMPLE_RATE, Config::AUDIO_FRAME_SAMPLES);
+        captureScratch.resize(kCaptureChunkSamples);
+        LOG_INFO(QStringLiteral("AudioEngine: streaming at %1 Hz, resampling from the %2 Hz devices (%3 taps)")
+                     .arg(Config::AUDIO_SAMPLE_RATE)
+                     .arg(Config::AUDIO_DEVICE_SAMPLE_RATE)
+                     .arg(captureResampler->tapsPerPhase()));
+    }
+
+    engineThread.setObjectName(QStringLiteral("AudioThread"));
+    threadContext->moveToThread(&engineThread);
+    connect(&engineThread, &QThread::finished, threadContext, &QObject::deleteLater);
+    engineThread.start(QThread::TimeCriticalPriority);
 }
 
 AudioEngine::~AudioEngine()
 {
     stopCapture();
     stopPlayback();
+
+    engineThread.quit();
+    engineThread.wait();
+
+    delete captureResampler;
+    delete playbackResampler;
+}
+
+void AudioEngine::runOnAudioThread(const std::function<void()> &fn)
+{
+    if (QThread::currentThread() == &engineThread) {
+        fn();
+        return;
+    }
+    QMetaObject::invokeMethod(threadContext, fn, Qt::BlockingQueuedConnection);
 }
 
 bool AudioEngine::startCapture()
 {
-    if (audioSource) {
+    if (audioSource || inputDevice) {
         stopCapture();
     }
 
-    audioSource = new QAudioSource(format, this);
-    inputDevice = audioSource->start();
+    // Created on the audio thread, so the device notifies and is read
+    // there.
+    runOnAudioThread([this]() {
+        audioSource = new QAudioSource(format);
+        inputDevice = audioSource->start();
+        if (captureResampler) {
+            captureResampler->reset();
+        }
+    });
 
     if (!inputDevice) {
         LOG_WARN(QStringLiteral("AudioEngine: failed to start audio capture"));
@@ -37,41 +162,152 @@ bool AudioEngine::startCapture()
     return true;
 }
 
+bool AudioEngine::startCapture(QIODevice *device)
+{
+    if (audioSource || inputDevice) {
+        stopCapture();
+    }
+    if (!device || !device->isReadable()) {
+        LOG_WARN(QStringLiteral("AudioEngine: headless capture device is not readable"));
+        return false;
+    }
+
+    runOnAudioThread([this, device]() {
+        inputDevice = device;
+        if (captureResampler) {
+            captureResampler->reset();
+        }
+    });
+    return true;
+}
+
 void AudioEngine::stopCapture()
 {
-    if (audioSource) {
-        audioSource->stop();
-        audioSource->deleteLater();
-        audioSource = nullptr;
+    if (!audioSource && !inputDevice) {
+        return;
     }
-    inputDevice = nullptr;
+    runOnAudioThread([this]() {
+        if (audioSource) {
+            audioSource->stop();
+            delete audioSource;
+            audioSource = nullptr;
+        }
+        inputDevice = nullptr;
+    });
 }
 
 bool AudioEngine::startPlayback()
 {
-    if (audioSink) {
+    if (playbackDevice) {
         stopPlayback();
     }
 
-    audioSink = new QAudioSink(format, this);
-    outputDevice = audioSink->start();
+    // The device and sink are created on the audio thread so that the
+    // sink's pull timer, and therefore every readData() call, runs there.
+    bool started = false;
+    qsizetype bufferBytes = 0;
+    runOnAudioThread([this, &started, &bufferBytes]() {
+        if (playbackResampler) {
+            playbackResampler->reset();
+        }
+        playbackDevice = new AudioPlaybackDevice(this);
+        playbackDevice->open(QIODevice::ReadOnly);
+        audioSink = new QAudioSink(format);
+        audioSink->setBufferSize(format.bytesForDuration(qint64(playbackBufferDurationMs) * 1000));
+        audioSink->start(playbackDevice);
+        started = audioSink->error() == QAudio::NoError && audioSink->state() != QAudio::StoppedState;
+        bufferBytes = audioSink->bufferSize();
+    });
 
-    if (!outputDevice) {
+    if (!started) {
         LOG_WARN(QStringLiteral("AudioEngine: failed to start audio playback"));
+        stopPlayback();
         return false;
     }
+    playbackRunning.store(true);
 
+    LOG_INFO(QStringLiteral("AudioEngine: pull-mode playback started, device buffer %1 bytes (%2 ms requested)")
+                 .arg(qint64(bufferBytes))
+                 .arg(playbackBufferDurationMs));
     return true;
 }
 
+bool AudioEngine::startPlayback(QIODevice *device)
+{
+    if (playbackDevice) {
+        stopPlayback();
+    }
+    if (!device || !device->isWritable()) {
+        LOG_WARN(QStringLiteral("AudioEngine: headless playback device is not writable"));
+        return false;
+    }
+
+    // Same pull path as a real sink, so whatever a harness measures
+    // includes the playback resampler and the source's pullFrame().
+    runOnAudioThread([this, device]() {
+        if (playbackResampler) {
+            playbackResampler->reset();
+        }
+        playbackDevice = new AudioPlaybackDevice(this);
+        playbackDevice->open(QIODevice::ReadOnly);
+        playbackOutput = device;
+        playbackClock = new QTimer;
+        playbackClock->setTimerType(Qt::PreciseTimer);
+        playbackClock->setInterval(Config::AUDIO_FRAME_MS);
+        connect(playbackClock, &QTimer::timeout, playbackClock, [this]() { pumpPlayback(); });
+        playbackClockTime.start();
+        playbackClockFrames = 0;
+        playbackClock->start();
+    });
+    playbackRunning.store(true);
+
+    LOG_INFO(QStringLiteral("AudioEngine: headless playback started"));
+    return true;
+}
+
+void AudioEngine::pumpPlayback()
+{
+    // Catch up on whole frames, so timer slack delays a frame but never
+    // slows the clock down.
+    char frame[Config::AUDIO_DEVICE_FRAME_SAMPLES * sizeof(qint16)];
+    const qint64 due = playbackClockTime.elapsed() / Config::AUDIO_FRAME_MS + 1;
+    while (playbackClockFrames < due) {
+        const qint64 read = playbackDevice->read(frame, qint64(sizeof(frame)));
+        if (read > 0) {
+            playbackOutput->write(frame, read);
+        }
+        ++playbackClockFrames;
+    }
+}
+
 void AudioEngine::stopPlayback()
 {
-    if (audioSink) {
-        audioSink->stop();
-        audioSink->deleteLater();
-        audioSink = nullptr;
+    if (!playbackDevice) {
+        return;
     }
-    outputDevice = nullptr;
+
+    playbackRunning.store(false);
+    runOnAudioThread([this]() {
+        if (audioSink) {
+            audioSink->stop();
+            delete audioSink;
+            audioSink = nullptr;
+        }
+        delete playbackClock;
+        playbackClock = nullptr;
+        playbackOutput = nullptr;
+        playbackDevice->close();
+        delete playbackDevice;
+        playbackDevice = nullptr;
+    });
+
+    // Nothing consumes the ring until the next start.
+    playbackRing.discardAll();
+}
+
+void AudioEngine::setPlaybackBufferMs(int ms)
+{
+    playbackBufferDurationMs = qMax(Config::AUDIO_FRAME_MS, ms);
 }
 
 QByteArray AudioEngine::readCapturedAudio()
@@ -79,15 +315,111 @@ QByteArray AudioEngine::readCapturedAudio()
     if (!inputDevice) {
         return QByteArray();
     }
+    if (!captureResampler) {
+        return inputDevice->readAll();
+    }
+
+    QByteArray pcm;
+    QByteArray chunk(int(captureResampler->maxOutputFor(kCaptureChunkSamples) * sizeof(qint16)), Qt::Uninitialized);
+    qint64 read = 0;
+    while ((read = readCapturedAudio(chunk.data(), chunk.size())) > 0) {
+        pcm.append(chunk.constData(), int(read));
+    }
+    return pcm;
+}
+
+qint64 AudioEngine::readCapturedAudio(char *data, qint64 maxSize)
+{
+    if (!inputDevice || maxSize <= 0) {
+        return 0;
+    }
+    if (!captureResampler) {
+        const qint64 read = inputDevice->read(data, maxSize);
+        return read > 0 ? read : 0;
+    }
 
-    return inputDevice->readAll();
+    // Read only as much as is sure to fit once converted. The device
+    // hands out whole samples for a 16-bit format.
+    const int maxSamples = int(maxSize / qint64(sizeof(qint16)));
+    const int deviceSamples = qMin(kCaptureChunkSamples,
+                                   int(qint64(maxSamples - 1) * Config::AUDIO_DEVICE_SAMPLE_RATE
+                                       / Config::AUDIO_SAMPLE_RATE));
+    if (deviceSamples <= 0) {
+        return 0;
+    }
+    const qint64 read = inputDevice->read(reinterpret_cast<char *>(captureScratch.data()),
+                                          qint64(deviceSamples) * qint64(sizeof(qint16)));
+    if (read <= 0) {
+        return 0;
+    }
+    const int produced = captureResampler->process(captureScratch.constData(),
+                                                   int(read / qint64(sizeof(qint16))),
+                                                   reinterpret_cast<qint16 *>(data),
+                                                   maxSamples);
+    return qint64(produced) * qint64(sizeof(qint16));
+}
+
+void AudioEngine::setPlaybackSource(AudioPlaybackSource *source)
+{
+    Q_ASSERT(QThread::currentThread() == &engineThread);
+    playbackSource.store(source, std::memory_order_release);
 }
 
 void AudioEngine::playAudio(const QByteArray &data)
 {
-    if (!outputDevice || data.isEmpty()) {
+    playAudio(reinterpret_cast<const qint16 *>(data.constData()), data.size() / int(sizeof(qint16)));
+}
+
+void AudioEngine::playAudio(const qint16 *samples, int count)
+{
+    if (!playbackRunning.load(std::memory_order_relaxed) || count <= 0) {
         return;
     }
 
-    outputDevice->write(data);
+    while (count > 0) {
+        PlaybackFrame *slot = playbackRing.beginWrite();
+        if (!slot) {
+            // Drop the rest rather than let latency build up.
+            playbackOverflowCount.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        const int chunk = std::min(count, Config::AUDIO_FRAME_SAMPLES);
+        memcpy(slot->samples, samples, size_t(chunk) * sizeof(qint16));
+        slot->count = chunk;
+        playbackRing.commitWrite();
+        samples += chunk;
+        count -= chunk;
+    }
+}
+
+int AudioEngine::pullPlayback(qint16 *out)
+{
+    if (!playbackResampler) {
+        return pullStreamFrame(out);
+    }
+
+    const int count = pullStreamFrame(playbackScratch);
+    if (count <= 0) {
+        // The device plays silence; start the next audio from a clean
+        // filter history.
+        playbackResampler->reset();
+        return 0;
+    }
+    return playbackResampler->process(playbackScratch, count, out, Config::AUDIO_DEVICE_FRAME_SAMPLES);
+}
+
+int AudioEngine::pullStreamFrame(qint16 *out)
+{
+    if (AudioPlaybackSource *source = playbackSource.load(std::memory_order_acquire)) {
+        return source->pullFrame(out);
+    }
+
+    PlaybackFrame *frame = playbackRing.front();
+    if (!frame) {
+        return 0;
+    }
+    const int count = frame->count;
+    memcpy(out, frame->samples, size_t(count) * sizeof(qint16));
+    playbackRing.popFront();
+    return count;
 }
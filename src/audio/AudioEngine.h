@@ -7,7 +7,39 @@
 #include <QAudioSink>
 #include <QIODevice>
 #include <QByteArray>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include <functional>
 
+#include "common/Config.h"
+#include "common/SpscRing.h"
+
+class AudioPlaybackDevice;
+class QTimer;
+class Resampler;
+
+// Supplies audio to the playback device. pullFrame() is called on the
+// audio thread whenever the device needs more data.
+class AudioPlaybackSource
+{
+public:
+    virtual ~AudioPlaybackSource() = default;
+
+    // Writes up to Config::AUDIO_FRAME_SAMPLES samples and returns how many
+    // were written; 0 means nothing is ready and the device plays silence.
+    virtual int pullFrame(qint16 *out) = 0;
+};
+
+// Capture and playback. The devices run at Config::AUDIO_DEVICE_SAMPLE_RATE;
+// everything the engine hands out or accepts is at the stream rate,
+// Config::AUDIO_SAMPLE_RATE, and it resamples in between when they differ.
+//
+// Both devices live on one time-critical audio thread, so GUI work never
+// delays a capture notification or a playback pull. Objects that read
+// the capture or feed playback (the transport) are moved to the same
+// thread; see audioThread().
 class AudioEngine : public QObject
 {
     Q_OBJECT
@@ -16,22 +48,91 @@ public:
     explicit AudioEngine(QObject *parent = nullptr);
     ~AudioEngine();
 
+    // The real-time audio thread; started with the engine.
+    QThread *audioThread() { return &engineThread; }
+
     bool startCapture();
     void stopCapture();
 
+    // Playback runs in pull mode on the audio thread: the sink asks for
+    // data on the device clock, so GUI stalls or timer drift cannot cause
+    // underruns. The device buffer size bounds the output latency.
     bool startPlayback();
     void stopPlayback();
 
+    // Headless variants for harnesses, with no audio hardware involved.
+    // Capture reads device-rate PCM from the given device instead of the
+    // default input; playback writes one device frame per
+    // Config::AUDIO_FRAME_MS to the given device, paced by a timer on the
+    // audio thread standing in for the device clock. Both devices are
+    // used on the audio thread and must stay open until the matching
+    // stop call.
+    bool startCapture(QIODevice *device);
+    bool startPlayback(QIODevice *device);
+
+    // Takes effect on the next startPlayback().
+    void setPlaybackBufferMs(int ms);
+    int playbackBufferMs() const { return playbackBufferDurationMs; }
+
+    // Capture reads belong on the audio thread.
     QByteArray readCapturedAudio();
+    // Reads into caller storage; returns the number of bytes read.
+    qint64 readCapturedAudio(char *data, qint64 maxSize);
+
+    // Routes playback to the given source (e.g. a jitter buffer). With no
+    // source set, the device plays whatever is queued with playAudio().
+    // The source must stay alive until it is replaced or cleared. Audio
+    // thread only: the device pulls on that thread too, so a source is
+    // never swapped out in the middle of a pull and no lock is needed.
+    void setPlaybackSource(AudioPlaybackSource *source);
+
+    // Queues PCM for playback through a short ring of preallocated frames.
+    // Lock-free; all calls must come from one thread at a time.
     void playAudio(const QByteArray &data);
+    void playAudio(const qint16 *samples, int count);
+    // Safe to read from any thread.
+    quint64 playbackOverflows() const { return playbackOverflowCount.load(std::memory_order_relaxed); }
 
 private:
+    struct PlaybackFrame
+    {
+        qint16 samples[Config::AUDIO_FRAME_SAMPLES];
+        int count;
+    };
+
+    friend class AudioPlaybackDevice;
+    // Called on the audio thread; out has room for one device frame.
+    int pullPlayback(qint16 *out);
+    int pullStreamFrame(qint16 *out);
+    // Headless playback tick: writes every frame that is due.
+    void pumpPlayback();
+    // Runs fn on the audio thread and waits for it.
+    void runOnAudioThread(const std::function<void()> &fn);
+
     QAudioSource *audioSource;
     QAudioSink *audioSink;
     QIODevice *inputDevice;
-    QIODevice *outputDevice;
+    AudioPlaybackDevice *playbackDevice;
+    // Headless playback only: where frames go, and the clock pacing them.
+    QIODevice *playbackOutput;
+    QTimer *playbackClock;
+    QElapsedTimer playbackClockTime;
+    qint64 playbackClockFrames;
     QAudioFormat format;
+    // Null when the stream runs at the device rate.
+    Resampler *captureResampler;
+    Resampler *playbackResampler;
+    QVector<qint16> captureScratch;
+    qint16 playbackScratch[Config::AUDIO_FRAME_SAMPLES];
+    QThread engineThread;
+    // Lives on engineThread; the target of runOnAudioThread().
+    QObject *threadContext;
+    std::atomic<bool> playbackRunning;
+    int playbackBufferDurationMs;
+
+    std::atomic<AudioPlaybackSource *> playbackSource;
+    SpscRing<PlaybackFrame> playbackRing;
+    std::atomic<quint64> playbackOverflowCount;
 };
 
 #endif // AUDIOENGINE_H
-
@@ -0,0 +1,119 @@
+#include "AudioFramer.h"
+
+#include <algorithm>
+#include <cstring>
+
+AudioFramer::AudioFramer(int frameSamples, int capacityFrames)
+    : m_frameSamples(qMax(1, frameSamples))
+    , m_ring(m_frameSamples * qMax(2, capacityFrames), 0)
+{
+}
+
+void AudioFramer::reset(quint32 initialTimestamp)
+{
+    m_readPos = 0;
+    m_count = 0;
+    m_timestamp = initialTimestamp;
+    m_dropped = 0;
+    m_hasCarry = false;
+    m_carry = 0;
+}
+
+void AudioFramer::push(const QByteArray &pcm)
+{
+    push(pcm.constData(), pcm.size());
+}
+
+void AudioFramer::push(const char *data, int bytes)
+{
+    if (!data || bytes <= 0) {
+        return;
+    }
+
+    if (m_hasCarry) {
+        qint16 sample = 0;
+        char joined[2] = {m_carry, data[0]};
+        memcpy(&sample, joined, sizeof(sample));
+        pushSamples(&sample, 1);
+        m_hasCarry = false;
+        ++data;
+        --bytes;
+    }
+
+    const int samples = bytes / int(sizeof(qint16));
+    if (samples > 0) {
+        pushSamples(reinterpret_cast<const qint16 *>(data), samples);
+    }
+
+    if (bytes % int(sizeof(qint16)) != 0) {
+        m_hasCarry = true;
+        m_carry = data[bytes - 1];
+    }
+}
+
+void AudioFramer::pushSamples(const qint16 *samples, int count)
+{
+    const int capacity = m_ring.size();
+
+    // A single read larger than the ring only keeps its newest part.
+    if (count > capacity) {
+        const int skipped = count - capacity;
+        samples += skipped;
+        count = capacity;
+        m_dropped += quint64(skipped + m_count);
+        m_timestamp += quint32(skipped + m_count);
+        m_readPos = 0;
+        m_count = 0;
+    }
+
+    const int overflow = m_count + count - capacity;
+    if (overflow > 0) {
+        m_readPos = (m_readPos + overflow) % capacity;
+        m_count -= overflow;
+        m_timestamp += quint32(overflow);
+        m_dropped += quint64(overflow);
+    }
+
+    int writePos = (m_readPos + m_count) % capacity;
+    int remaining = count;
+    while (remaining > 0) {
+        const int chunk = std::min(remaining, capacity - writePos);
+        memcpy(m_ring.data() + writePos, samples, size_t(chunk) * sizeof(qint16));
+        samples += chunk;
+        remaining -= chunk;
+        writePos = (writePos + chunk) % capacity;
+    }
+    m_count += count;
+}
+
+bool AudioFramer::pop(QByteArray &outFrame, quint32 &outTimestamp)
+{
+    if (m_count < m_frameSamples) {
+        return false;
+    }
+
+    outFrame.resize(m_frameSamples * int(sizeof(qint16)));
+    return pop(reinterpret_cast<qint16 *>(outFrame.data()), outTimestamp);
+}
+
+bool AudioFramer::pop(qint16 *out, quint32 &outTimestamp)
+{
+    if (m_count < m_frameSamples) {
+        return false;
+    }
+
+    const int capacity = m_ring.size();
+    int remaining = m_frameSamples;
+    while (remaining > 0) {
+        const int chunk = std::min(remaining, capacity - m_readPos);
+        memcpy(out, m_ring.constData() + m_readPos, size_t(chunk) * sizeof(qint16));
+        out += chunk;
+        remaining -= chunk;
+        m_readPos = (m_readPos + chunk) % capacity;
+    }
+    m_count -= m_frameSamples;
+
+    outTimestamp = m_timestamp;
+    m_timestamp += quint32(m_frameSamples);
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef AUDIOFRAMER_H
+#define AUDIOFRAMER_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+#include "common/Config.h"
+
+// Slices captured PCM of arbitrary size into exact fixed-length frames.
+//
+// The capture device hands back whatever happens to be in the OS buffer,
+// so the framer keeps a small ring of samples and releases them one frame
+// at a time, each stamped with an RTP-style sample-clock timestamp (the
+// index of its first sample). When the ring overflows the oldest samples
+// are dropped and the clock skips ahead by the same amount, so receivers
+// see the gap instead of a silently compressed timeline.
+class AudioFramer
+{
+public:
+    explicit AudioFramer(int frameSamples = Config::AUDIO_FRAME_SAMPLES, int capacityFrames = 10);
+
+    void reset(quint32 initialTimestamp = 0);
+    void push(const QByteArray &pcm);
+    void push(const char *data, int bytes);
+    // Returns false when fewer than one full frame is buffered.
+    bool pop(QByteArray &outFrame, quint32 &outTimestamp);
+    // Same, writing frameSamples() samples straight into caller storage.
+    bool pop(qint16 *outSamples, quint32 &outTimestamp);
+
+    int frameSamples() const { return m_frameSamples; }
+    int bufferedSamples() const { return m_count; }
+    quint64 droppedSamples() const { return m_dropped; }
+
+private:
+    void pushSamples(const qint16 *samples, int count);
+
+    int m_frameSamples;
+    QVector<qint16> m_ring;
+    int m_readPos = 0;
+    int m_count = 0;
+    // Timestamp of the sample at m_readPos.
+    quint32 m_timestamp = 0;
+    quint64 m_dropped = 0;
+    // Capture reads are not guaranteed to end on a sample boundary.
+    bool m_hasCarry = false;
+    char m_carry = 0;
+};
+
+#endif // AUDIOFRAMER_H
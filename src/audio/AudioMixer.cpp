@@ -0,0 +1,823 @@
+#include "AudioMixer.h"
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QMap>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVector>
+#include <algorithm>
+
+#include "AudioDsp.h"
+#include "AudioEngine.h"
+#include "AudioFramer.h"
+#include "AudioPacket.h"
+#include "AudioRedundancy.h"
+#include "ComfortNoise.h"
+#include "MeetingRecorder.h"
+#include "common/Config.h"
+#include "common/Logger.h"
+
+namespace {
+
+// Frames a source must have queued before it starts contributing, and
+// again after it has gone idle.
+constexpr int kPrefillFrames = 2;
+// Upper bound on queued frames per source (~200 ms).
+constexpr int kMaxPendingFrames = 10;
+// Consecutive empty ticks after which a source is treated as idle.
+constexpr int kIdleTicks = 10;
+// Frames mixed in one timer callback when the clock has fallen behind.
+constexpr int kMaxCatchUpFrames = 3;
+constexpr qint64 kStatsIntervalMs = 10000;
+// Silence descriptors to a quiet recipient, as often as a DTX sender
+// refreshes its own.
+constexpr int kSidIntervalFrames = Config::AUDIO_DTX_SID_INTERVAL_MS / Config::AUDIO_FRAME_MS;
+// A source already in the mix keeps its place against one up to this
+// much louder, so the selection does not flap between similar talkers.
+constexpr int kSelectionHysteresisDb = 6;
+
+bool seqBefore(quint32 a, quint32 b)
+{
+    return qint32(a - b) < 0;
+}
+
+} // namespace
+
+class AudioMixerWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AudioMixerWorker(QObject *parent = nullptr)
+        : QObject(parent)
+        , socket(nullptr)
+        , tickTimer(nullptr)
+        , playback(nullptr)
+        , recorder(nullptr)
+        , peerPort(0)
+        , framesMixed(0)
+        , packetsSinceTick(0)
+        , localSeq(0)
+        , accumulator(Config::AUDIO_FRAME_SAMPLES, 0)
+    {
+    }
+
+    ~AudioMixerWorker() override
+    {
+        clearPeers();
+    }
+
+    bool start(quint16 listenPort, quint16 peerPortValue, AudioEngine *playbackValue)
+    {
+        stop();
+
+        socket = new QUdpSocket(this);
+        if (!socket->bind(QHostAddress::AnyIPv4, listenPort)) {
+            LOG_WARN(QStringLiteral("AudioMixer: failed to bind UDP port %1: %2")
+                         .arg(listenPort)
+                         .arg(socket->errorString()));
+            delete socket;
+            socket = nullptr;
+            return false;
+        }
+        connect(socket, &QUdpSocket::readyRead, this, &AudioMixerWorker::onReadyRead);
+
+        peerPort = peerPortValue;
+        playback = playbackValue;
+        framesMixed = 0;
+        packetsSinceTick = 0;
+        localSeq = 0;
+        lossReportTimer.start();
+
+        tickTimer = new QTimer(this);
+        tickTimer->setTimerType(Qt::PreciseTimer);
+        tickTimer->setInterval(Config::AUDIO_FRAME_MS);
+        connect(tickTimer, &QTimer::timeout, this, &AudioMixerWorker::onTick);
+        clock.start();
+        statsTimer.start();
+        tickTimer->start();
+        return true;
+    }
+
+    void stop()
+    {
+        if (tickTimer) {
+            tickTimer->stop();
+            delete tickTimer;
+            tickTimer = nullptr;
+        }
+        if (socket) {
+            socket->close();
+            delete socket;
+            socket = nullptr;
+        }
+        clearPeers();
+    }
+
+public slots:
+    void configurePeerCodec(const QString &ip, int codecType, int bitrate)
+    {
+        Peer &peer = peers[ip];
+        delete peer.encoder;
+        peer.encoder = nullptr;
+        delete peer.redundancy;
+        peer.redundancy = nullptr;
+        peer.versioned = true;
+        peer.codec = static_cast<AudioCodec::Type>(codecType);
+        peer.bitrate = bitrate;
+        peer.sendTimestamp = QRandomGenerator::global()->generate();
+    }
+
+    void setRecorder(MeetingRecorder *recorderValue) { recorder = recorderValue; }
+
+    void addRecipient(const QString &ip)
+    {
+        Peer &peer = peers[ip];
+        peer.recipient = true;
+        peer.address = QHostAddress(ip);
+    }
+
+    void removePeer(const QString &ip)
+    {
+        auto it = peers.find(ip);
+        if (it == peers.end()) {
+            return;
+        }
+        delete it.value().decoder;
+        delete it.value().encoder;
+        delete it.value().redundancy;
+        peers.erase(it);
+    }
+
+    void pushLocalFrame(const QByteArray &pcm)
+    {
+        if (!socket) {
+            return;
+        }
+        QueuedFrame frame;
+        frame.data = pcm;
+        queueFrame(peers[AudioMixer::localSourceId()], ++localSeq, frame);
+    }
+
+signals:
+    void frameMixed(const QByteArray &pcm, const QHash<QString, double> &levels, int packetsReceived);
+    void sourceStatsUpdated(const QList<AudioMixer::SourceStats> &stats);
+
+private slots:
+    void onReadyRead()
+    {
+        while (socket && socket->hasPendingDatagrams()) {
+            QByteArray datagram;
+            datagram.resize(int(socket->pendingDatagramSize()));
+            QHostAddress senderAddr;
+            quint16 senderPort = 0;
+            const qint64 read = socket->readDatagram(datagram.data(), datagram.size(), &senderAddr, &senderPort);
+            if (read <= 0) {
+                LOG_WARN(QStringLiteral("AudioMixer: failed to read UDP datagram - %1")
+                             .arg(socket->errorString()));
+                continue;
+            }
+            if (read < datagram.size()) {
+                datagram.resize(int(read));
+            }
+
+            AudioPacket::Header header;
+            QByteArray payload;
+            if (senderAddr.isNull() || !AudioPacket::parse(datagram, header, payload)) {
+                continue;
+            }
+
+            // Peers exist only between addRecipient()/setPeerCodec() and
+            // removePeer(); anything else on the port is not in the meeting.
+            const auto peerIt = peers.find(senderAddr.toString());
+            if (peerIt == peers.end()) {
+                continue;
+            }
+            Peer &peer = peerIt.value();
+            if (!header.legacy && header.payloadType == AudioPacket::kLossReportPayloadType) {
+                // How much of our mix this guest loses sets the redundancy
+                // we send it.
+                peer.redundancyDepth = AudioRedundancy::depthForLoss(peer.redundancyDepth, quint8(payload.at(0)));
+                continue;
+            }
+            if (!header.legacy) {
+                peer.lossMeter.notePacket(header.seq);
+            }
+            if (!header.legacy && header.payloadType == AudioPacket::kComfortNoisePayloadType) {
+                // The sender has gone quiet. Its background noise is not
+                // mixed in: summed over every silent guest it would only
+                // raise the noise floor for everyone else.
+                ++packetsSinceTick;
+                ++peer.stats.silenceDescriptors;
+                QueuedFrame marker;
+                marker.silence = true;
+                queueFrame(peer, header.seq, marker);
+                continue;
+            }
+
+            QueuedFrame frame;
+            if (!header.legacy && header.payloadType == AudioPacket::kRedPayloadType) {
+                if (!AudioRedundancy::parse(payload, redBlocks)) {
+                    continue;
+                }
+                // Earlier frames only fill holes; they are ranked by the
+                // level of the packet that carried them.
+                for (int i = 0; i + 1 < redBlocks.size(); ++i) {
+                    QueuedFrame redundant;
+                    redundant.data = redBlocks[i].data;
+                    redundant.payloadType = redBlocks[i].payloadType;
+                    redundant.encoded = true;
+                    redundant.level = header.level;
+                    queueRedundantFrame(peer, header.seq - redBlocks[i].seqBack, redundant);
+                }
+                frame.data = redBlocks.last().data;
+                frame.payloadType = redBlocks.last().payloadType;
+                frame.encoded = true;
+                frame.level = header.level;
+            } else if (header.legacy) {
+                frame.data = payload;
+            } else if (header.hasLevel) {
+                // Ranked by the sender's level; decoded only if it makes
+                // it into the mix.
+                frame.data = payload;
+                frame.payloadType = header.payloadType;
+                frame.encoded = true;
+                frame.level = header.level;
+            } else if (!decode(peer, header.payloadType, payload, frame.data)) {
+                continue;
+            }
+
+            ++packetsSinceTick;
+            queueFrame(peer, header.seq, frame);
+        }
+    }
+
+    void onTick()
+    {
+        // Mix by the wall clock rather than by timer callbacks so that a
+        // late callback produces the missing frames instead of drifting.
+        const qint64 due = clock.elapsed() / Config::AUDIO_FRAME_MS;
+        int produced = 0;
+        while (framesMixed < due && produced < kMaxCatchUpFrames) {
+            mixOneFrame();
+            ++framesMixed;
+            ++produced;
+        }
+        if (framesMixed < due) {
+            // Long stall: drop the backlog rather than bursting it out.
+            framesMixed = due;
+        }
+
+        if (lossReportTimer.hasExpired(Config::AUDIO_LOSS_REPORT_INTERVAL_MS)) {
+            sendLossReports();
+            lossReportTimer.restart();
+        }
+
+        if (statsTimer.hasExpired(kStatsIntervalMs)) {
+            reportStats();
+            statsTimer.restart();
+        }
+    }
+
+private:
+    // A received packet. Packets that carry a level stay encoded until the
+    // mixer picks them; everything else is PCM already and its level is
+    // measured once it has been framed.
+    struct QueuedFrame
+    {
+        QByteArray data;
+        quint8 payloadType = 0;
+        bool encoded = false;
+        quint8 level = AudioPacket::kSilentLevel;
+        // Comfort-noise descriptor: the end of a talkspurt.
+        bool silence = false;
+    };
+
+    struct Peer
+    {
+        // Receive side
+        QMap<quint32, QueuedFrame> pending;
+        AudioFramer framer{Config::AUDIO_FRAME_SAMPLES, 8};
+        quint32 nextSeq = 0;
+        bool playing = false;
+        int emptyTicks = 0;
+        AudioCodec *decoder = nullptr;
+        AudioRedundancy::LossMeter lossMeter;
+        // This tick's frame, before and after selection. The decoded
+        // contribution is kept for the mix-minus pass.
+        QueuedFrame candidate;
+        QByteArray frame;
+        bool contributed = false;
+        bool mixedLastTick = false;
+        AudioMixer::SourceStats stats;
+
+        // Send side
+        bool recipient = false;
+        QHostAddress address;
+        bool versioned = false;
+        AudioCodec::Type codec = AudioCodec::Type::Pcm16;
+        int bitrate = 0;
+        AudioCodec *encoder = nullptr;
+        // Created with the encoder; the depth follows the recipient's
+        // loss reports.
+        AudioRedundancy::Encoder *redundancy = nullptr;
+        int redundancyDepth = 0;
+        quint32 sendSeq = 0;
+        quint32 sendTimestamp = 0;
+        // Frames until the next silence descriptor while the mix for this
+        // recipient is silent.
+        int sidCountdown = 0;
+    };
+
+    struct RankedSource
+    {
+        int rank;
+        Peer *peer;
+    };
+
+    bool decode(Peer &peer, quint8 payloadType, const QByteArray &payload, QByteArray &outPcm)
+    {
+        const auto type = static_cast<AudioCodec::Type>(payloadType);
+        if (!peer.decoder || peer.decoder->type() != type) {
+            delete peer.decoder;
+            peer.decoder = AudioCodec::create(type, 0);
+        }
+        return peer.decoder && peer.decoder->decode(payload, outPcm);
+    }
+
+    void queueFrame(Peer &peer, quint32 seq, const QueuedFrame &frame)
+    {
+        if (frame.data.isEmpty() && !frame.silence) {
+            return;
+        }
+        ++peer.stats.received;
+
+        if (peer.playing && seqBefore(seq, peer.nextSeq)) {
+            ++peer.stats.late;
+            return;
+        }
+        if (peer.pending.contains(seq)) {
+            return;
+        }
+        peer.pending.insert(seq, frame);
+
+        while (peer.pending.size() > kMaxPendingFrames) {
+            const auto it = peer.pending.begin();
+            const quint32 droppedSeq = it.key();
+            peer.pending.erase(it);
+            ++peer.stats.lost;
+            if (peer.playing && !seqBefore(droppedSeq, peer.nextSeq)) {
+                peer.nextSeq = droppedSeq + 1;
+            }
+        }
+    }
+
+    // A frame rebuilt from a RED packet: only fills a hole that is still
+    // waiting to be mixed.
+    void queueRedundantFrame(Peer &peer, quint32 seq, const QueuedFrame &frame)
+    {
+        if (frame.data.isEmpty() || peer.pending.contains(seq)) {
+            return;
+        }
+        if (peer.playing ? seqBefore(seq, peer.nextSeq) : peer.pending.isEmpty()) {
+            return;
+        }
+        ++peer.stats.recovered;
+        peer.pending.insert(seq, frame);
+        while (peer.pending.size() > kMaxPendingFrames) {
+            peer.pending.erase(peer.pending.begin());
+        }
+    }
+
+    // Pulls the next frame of one source in sequence order. PCM is
+    // re-sliced through an AudioFramer so that legacy peers sending
+    // arbitrarily sized packets still contribute exact 20 ms frames;
+    // encoded packets always hold exactly one frame.
+    bool pullFrame(Peer &peer, QueuedFrame &outFrame)
+    {
+        if (!peer.playing) {
+            if (peer.pending.size() < kPrefillFrames) {
+                return false;
+            }
+            peer.playing = true;
+            peer.nextSeq = peer.pending.firstKey();
+            peer.emptyTicks = 0;
+        }
+
+        bool silenced = false;
+        while (peer.framer.bufferedSamples() < Config::AUDIO_FRAME_SAMPLES && !peer.pending.isEmpty()) {
+            auto it = peer.pending.find(peer.nextSeq);
+            if (it == peer.pending.end()) {
+                // Only give up on a missing frame once later ones have
+                // piled up; otherwise it may simply be reordered.
+                if (peer.pending.size() < kPrefillFrames) {
+                    break;
+                }
+                ++peer.stats.lost;
+                ++peer.nextSeq;
+                continue;
+            }
+            const QueuedFrame frame = it.value();
+            peer.pending.erase(it);
+            ++peer.nextSeq;
+            silenced = frame.silence;
+            if (frame.encoded) {
+                // PCM left over from before a codec switch can no longer
+                // be completed.
+                peer.framer.reset();
+                outFrame = frame;
+                peer.emptyTicks = 0;
+                return true;
+            }
+            peer.framer.push(frame.data);
+        }
+
+        quint32 timestamp = 0;
+        if (peer.framer.pop(outFrame.data, timestamp)) {
+            const auto *samples = reinterpret_cast<const qint16 *>(outFrame.data.constData());
+            outFrame.encoded = false;
+            outFrame.silence = false;
+            outFrame.level = AudioPacket::levelByte(samples, Config::AUDIO_FRAME_SAMPLES, false);
+            peer.emptyTicks = 0;
+            return true;
+        }
+
+        if (silenced) {
+            // DTX: the sender stopped on purpose. Go idle without counting
+            // underruns; its next talkspurt is prefilled afresh.
+            peer.playing = false;
+            peer.framer.reset();
+            return false;
+        }
+
+        ++peer.stats.underruns;
+        if (++peer.emptyTicks >= kIdleTicks) {
+            peer.playing = false;
+            peer.framer.reset();
+        }
+        return false;
+    }
+
+    // Only the loudest few sources are mixed, ranked by level, and only
+    // those are decoded. Mix-minus: every listener gets the shared total
+    // minus its own contribution, so nobody hears themselves echoed back.
+    void mixOneFrame()
+    {
+        const QString localId = AudioMixer::localSourceId();
+        const int sampleCount = Config::AUDIO_FRAME_SAMPLES;
+
+        accumulator.fill(0);
+        QHash<QString, double> levels;
+        int contributors = 0;
+
+        ranked.clear();
+        for (auto it = peers.begin(); it != peers.end(); ++it) {
+            Peer &peer = it.value();
+            peer.contributed = false;
+            if (!pullFrame(peer, peer.candidate)) {
+                continue;
+            }
+            levels.insert(it.key(), -double(peer.candidate.level));
+            if (peer.candidate.level >= AudioPacket::kSilentLevel) {
+                ++peer.stats.skipped;
+                continue;
+            }
+            const int bonus = peer.mixedLastTick ? kSelectionHysteresisDb : 0;
+            ranked.append({peer.candidate.level - bonus, &peer});
+        }
+
+        // Lower rank is louder (-dBov).
+        const int selected = qMin(int(ranked.size()), Config::AUDIO_MIX_MAX_SPEAKERS);
+        std::partial_sort(ranked.begin(),
+                          ranked.begin() + selected,
+                          ranked.end(),
+                          [](const RankedSource &a, const RankedSource &b) { return a.rank < b.rank; });
+        for (int i = selected; i < ranked.size(); ++i) {
+            ++ranked[i].peer->stats.skipped;
+        }
+
+        for (int i = 0; i < selected; ++i) {
+            Peer &peer = *ranked[i].peer;
+            QueuedFrame &candidate = peer.candidate;
+            if (candidate.encoded) {
+                if (!decode(peer, candidate.payloadType, candidate.data, peer.frame)) {
+                    continue;
+                }
+            } else {
+                peer.frame = candidate.data;
+            }
+            if (peer.frame.size() < Config::AUDIO_FRAME_BYTES) {
+                continue;
+            }
+
+            AudioDsp::accumulate(accumulator.data(), reinterpret_cast<const qint16 *>(peer.frame.constData()), sampleCount);
+            peer.contributed = true;
+            ++contributors;
+        }
+        for (Peer &peer : peers) {
+            peer.mixedLastTick = peer.contributed;
+        }
+
+        // Local playback: everyone except the host's own microphone. The
+        // GUI gets a frame every tick so that playback stays continuous.
+        const auto localIt = peers.constFind(localId);
+        const Peer *local = (localIt != peers.constEnd() && localIt.value().contributed) ? &localIt.value() : nullptr;
+        QByteArray localMix(Config::AUDIO_FRAME_BYTES, Qt::Uninitialized);
+        mixMinus(local ? &local->frame : nullptr, localMix);
+        if (playback) {
+            playback->playAudio(localMix);
+        }
+        // The recording has everyone, the host included.
+        if (recorder) {
+            mixMinus(nullptr, recordMix);
+            recorder->push(reinterpret_cast<const qint16 *>(recordMix.constData()));
+        }
+        emit frameMixed(localMix, levels, packetsSinceTick);
+        packetsSinceTick = 0;
+
+        for (auto it = peers.begin(); it != peers.end(); ++it) {
+            Peer &peer = it.value();
+            if (!peer.recipient) {
+                continue;
+            }
+            // Timestamps keep running through skipped frames so that the
+            // receiver sees a silence gap rather than a compressed timeline.
+            const quint32 timestamp = peer.sendTimestamp;
+            peer.sendTimestamp += quint32(sampleCount);
+
+            // A lone talker has nothing to hear.
+            const bool audible = contributors - (peer.contributed ? 1 : 0) > 0
+                                 && mixMinus(peer.contributed ? &peer.frame : nullptr, recipientMix);
+            if (audible) {
+                sendTo(it.key(), peer, timestamp, recipientMix);
+                peer.sidCountdown = 0;
+            } else if (peer.versioned && peer.sidCountdown-- <= 0) {
+                // Tell the recipient the silence is deliberate, so it
+                // plays (silent) comfort noise instead of concealing.
+                sendSilence(it.key(), peer, timestamp);
+                peer.sidCountdown = kSidIntervalFrames - 1;
+            }
+        }
+    }
+
+    // Writes the saturated total minus one optional contribution into
+    // out and returns false when the result is digital silence.
+    bool mixMinus(const QByteArray *exclude, QByteArray &out) const
+    {
+        out.resize(Config::AUDIO_FRAME_BYTES);
+        return AudioDsp::packSaturate(accumulator.constData(),
+                                      exclude ? reinterpret_cast<const qint16 *>(exclude->constData()) : nullptr,
+                                      reinterpret_cast<qint16 *>(out.data()),
+                                      Config::AUDIO_FRAME_SAMPLES);
+    }
+
+    void sendTo(const QString &ip, Peer &peer, quint32 timestamp, const QByteArray &mixed)
+    {
+        QByteArray packet;
+        if (!peer.versioned) {
+            packet = AudioPacket::buildLegacy(++peer.sendSeq, mixed);
+        } else {
+            if (!peer.encoder) {
+                peer.encoder = AudioCodec::create(peer.codec, peer.bitrate);
+            }
+            const quint8 level = AudioPacket::levelByte(reinterpret_cast<const qint16 *>(mixed.constData()),
+                                                        Config::AUDIO_FRAME_SAMPLES,
+                                                        true);
+            QByteArray payload;
+            quint8 payloadType = quint8(AudioCodec::Type::Pcm16);
+            if (peer.encoder && peer.encoder->encode(mixed, payload)) {
+                payloadType = quint8(peer.encoder->type());
+            } else {
+                payload = mixed;
+            }
+            ++peer.sendSeq;
+
+            if (peer.redundancyDepth > 0 && !peer.redundancy) {
+                peer.redundancy = new AudioRedundancy::Encoder;
+                peer.redundancy->configure(peer.codec, peer.bitrate);
+            }
+            if (peer.redundancy) {
+                peer.redundancy->setDepth(peer.redundancyDepth);
+            }
+            int redBytes = -1;
+            if (peer.redundancy && peer.redundancy->depth() > 0) {
+                redPayload.resize(AudioRedundancy::kMaxPayloadBytes);
+                redBytes = peer.redundancy->wrap(peer.sendSeq,
+                                                 reinterpret_cast<const qint16 *>(mixed.constData()),
+                                                 Config::AUDIO_FRAME_SAMPLES,
+                                                 payloadType,
+                                                 reinterpret_cast<const uchar *>(payload.constData()),
+                                                 int(payload.size()),
+                                                 reinterpret_cast<uchar *>(redPayload.data()),
+                                                 int(redPayload.size()));
+            }
+            if (redBytes > 0) {
+                packet = AudioPacket::build(AudioPacket::kRedPayloadType,
+                                            peer.sendSeq,
+                                            timestamp,
+                                            level,
+                                            QByteArray::fromRawData(redPayload.constData(), redBytes));
+            } else {
+                packet = AudioPacket::build(payloadType, peer.sendSeq, timestamp, level, payload);
+            }
+        }
+
+        if (socket->writeDatagram(packet, peer.address, peerPort) < 0) {
+            LOG_WARN(QStringLiteral("AudioMixer: failed to send mix to %1 - %2")
+                         .arg(ip, socket->errorString()));
+        }
+    }
+
+    void sendSilence(const QString &ip, Peer &peer, quint32 timestamp)
+    {
+        uchar descriptor[ComfortNoise::kPayloadBytes];
+        const int size = ComfortNoise::encode(ComfortNoise::Parameters(), descriptor);
+        const QByteArray packet = AudioPacket::build(AudioPacket::kComfortNoisePayloadType,
+                                                     ++peer.sendSeq,
+                                                     timestamp,
+                                                     AudioPacket::kSilentLevel,
+                                                     QByteArray(reinterpret_cast<const char *>(descriptor), size));
+        if (socket->writeDatagram(packet, peer.address, peerPort) < 0) {
+            LOG_WARN(QStringLiteral("AudioMixer: failed to send silence descriptor to %1 - %2")
+                         .arg(ip, socket->errorString()));
+        }
+    }
+
+    // Tells every versioned guest how much of its audio is being lost, so
+    // that it can add redundancy.
+    void sendLossReports()
+    {
+        for (auto it = peers.begin(); it != peers.end(); ++it) {
+            Peer &peer = it.value();
+            if (!peer.versioned || !peer.recipient) {
+                continue;
+            }
+            const char fractionLost = char(peer.lossMeter.takeFractionLost());
+            const QByteArray packet = AudioPacket::build(AudioPacket::kLossReportPayloadType,
+                                                         0,
+                                                         0,
+                                                         AudioPacket::kSilentLevel,
+                                                         QByteArray(1, fractionLost));
+            if (socket->writeDatagram(packet, peer.address, peerPort) < 0) {
+                LOG_WARN(QStringLiteral("AudioMixer: failed to send loss report to %1 - %2")
+                             .arg(it.key(), socket->errorString()));
+            }
+        }
+    }
+
+    void reportStats()
+    {
+        QList<AudioMixer::SourceStats> stats;
+        for (auto it = peers.begin(); it != peers.end(); ++it) {
+            const Peer &peer = it.value();
+            if (peer.stats.received == 0) {
+                continue;
+            }
+            AudioMixer::SourceStats entry = peer.stats;
+            entry.id = it.key();
+            entry.buffered = peer.pending.size();
+            stats.append(entry);
+            LOG_INFO(QStringLiteral("AudioMixer source %1: received=%2 underruns=%3 late=%4 lost=%5 buffered=%6 "
+                                    "silenceDescriptors=%7 skipped=%8 recovered=%9 redDepth=%10")
+                         .arg(entry.id)
+                         .arg(static_cast<qulonglong>(entry.received))
+                         .arg(static_cast<qulonglong>(entry.underruns))
+                         .arg(static_cast<qulonglong>(entry.late))
+                         .arg(static_cast<qulonglong>(entry.lost))
+                         .arg(entry.buffered)
+                         .arg(static_cast<qulonglong>(entry.silenceDescriptors))
+                         .arg(static_cast<qulonglong>(entry.skipped))
+                         .arg(static_cast<qulonglong>(entry.recovered))
+                         .arg(peer.redundancyDepth));
+        }
+        if (!stats.isEmpty()) {
+            emit sourceStatsUpdated(stats);
+        }
+    }
+
+    void clearPeers()
+    {
+        for (const Peer &peer : std::as_const(peers)) {
+            delete peer.decoder;
+            delete peer.encoder;
+            delete peer.redundancy;
+        }
+        peers.clear();
+    }
+
+    QUdpSocket *socket;
+    QTimer *tickTimer;
+    // Plays the host's mix from this thread, without a GUI round trip.
+    AudioEngine *playback;
+    MeetingRecorder *recorder;
+    quint16 peerPort;
+    QElapsedTimer clock;
+    QElapsedTimer statsTimer;
+    QElapsedTimer lossReportTimer;
+    qint64 framesMixed;
+    int packetsSinceTick;
+    quint32 localSeq;
+    QHash<QString, Peer> peers;
+    QVector<qint32> accumulator;
+    QVector<RankedSource> ranked;
+    QByteArray recipientMix;
+    QByteArray recordMix;
+    QVector<AudioRedundancy::Block> redBlocks;
+    QByteArray redPayload;
+};
+
+AudioMixer::AudioMixer(QObject *parent)
+    : QObject(parent)
+    , mixThread()
+    , worker(new AudioMixerWorker)
+    , running(false)
+{
+    worker->moveToThread(&mixThread);
+    mixThread.setObjectName(QStringLiteral("AudioMixThread"));
+    connect(&mixThread, &QThread::finished, worker, &QObject::deleteLater);
+
+    connect(worker, &AudioMixerWorker::frameMixed, this, &AudioMixer::frameMixed, Qt::QueuedConnection);
+    connect(worker,
+            &AudioMixerWorker::sourceStatsUpdated,
+            this,
+            &AudioMixer::sourceStatsUpdated,
+            Qt::QueuedConnection);
+
+    connect(this, &AudioMixer::peerCodecConfigured, worker, &AudioMixerWorker::configurePeerCodec, Qt::QueuedConnection);
+    connect(this, &AudioMixer::recipientAdded, worker, &AudioMixerWorker::addRecipient, Qt::QueuedConnection);
+    connect(this, &AudioMixer::peerRemoved, worker, &AudioMixerWorker::removePeer, Qt::QueuedConnection);
+    connect(this, &AudioMixer::localFrameQueued, worker, &AudioMixerWorker::pushLocalFrame, Qt::QueuedConnection);
+
+    // Mixing is on the audio deadline path, same as the transport's send thread.
+    mixThread.start(QThread::TimeCriticalPriority);
+}
+
+AudioMixer::~AudioMixer()
+{
+    stop();
+    if (mixThread.isRunning()) {
+        mixThread.quit();
+        mixThread.wait();
+    }
+}
+
+QString AudioMixer::localSourceId()
+{
+    return QStringLiteral("local");
+}
+
+bool AudioMixer::start(quint16 listenPort, quint16 peerPort, AudioEngine *playback)
+{
+    bool ok = false;
+    AudioMixerWorker *target = worker;
+    QMetaObject::invokeMethod(
+        worker,
+        [target, listenPort, peerPort, playback, &ok]() { ok = target->start(listenPort, peerPort, playback); },
+        Qt::BlockingQueuedConnection);
+    running = ok;
+    return ok;
+}
+
+void AudioMixer::stop()
+{
+    if (!running) {
+        return;
+    }
+    AudioMixerWorker *target = worker;
+    QMetaObject::invokeMethod(worker, [target]() { target->stop(); }, Qt::BlockingQueuedConnection);
+    running = false;
+}
+
+void AudioMixer::setRecorder(MeetingRecorder *recorder)
+{
+    // Blocking, so that once this returns with nullptr the old recorder
+    // is no longer fed and can be stopped.
+    AudioMixerWorker *target = worker;
+    QMetaObject::invokeMethod(worker, [target, recorder]() { target->setRecorder(recorder); }, Qt::BlockingQueuedConnection);
+}
+
+void AudioMixer::setPeerCodec(const QString &ip, AudioCodec::Type type, int bitrate)
+{
+    emit peerCodecConfigured(ip, int(type), bitrate);
+}
+
+void AudioMixer::addRecipient(const QString &ip)
+{
+    emit recipientAdded(ip);
+}
+
+void AudioMixer::removePeer(const QString &ip)
+{
+    emit peerRemoved(ip);
+}
+
+void AudioMixer::pushLocalFrame(const QByteArray &pcm)
+{
+    if (running) {
+        emit localFrameQueued(pcm);
+    }
+}
+
+#include "AudioMixer.moc"
@@ -0,0 +1,95 @@
+#ifndef AUDIOMIXER_H
+#define AUDIOMIXER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <atomic>
+
+#include "audio/AudioCodec.h"
+
+class AudioEngine;
+class AudioMixerWorker;
+class MeetingRecorder;
+
+// Host-side conference mixer.
+//
+// Receives every guest's audio on one UDP port, keeps a sequence-aware
+// jitter buffer per sender and mixes exactly one 20 ms frame per tick of
+// its own clock, independent of how packets happen to arrive. Only the
+// Config::AUDIO_MIX_MAX_SPEAKERS loudest sources are mixed, ranked by
+// the level senders put in each packet header, so silent participants
+// are never decoded and the mixing cost does not grow with the meeting.
+// Every recipient gets its own mix-minus (the total without its own
+// stream), and the host's mix without its microphone is handed to the
+// GUI. All socket I/O, decoding and mixing run on a dedicated thread,
+// which also queues the host's mix for playback.
+class AudioMixer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct SourceStats
+    {
+        QString id;
+        quint64 received = 0;
+        // Ticks on which an active source had no frame ready.
+        quint64 underruns = 0;
+        // Packets that arrived after their slot had already been mixed.
+        quint64 late = 0;
+        // Sequence numbers skipped because they never arrived.
+        quint64 lost = 0;
+        // Comfort-noise descriptors from a sender in DTX.
+        quint64 silenceDescriptors = 0;
+        // Frames left out of the mix: silent, or not among the loudest.
+        quint64 skipped = 0;
+        // Lost frames rebuilt from the redundancy in later packets.
+        quint64 recovered = 0;
+        int buffered = 0;
+    };
+
+    explicit AudioMixer(QObject *parent = nullptr);
+    ~AudioMixer() override;
+
+    // Source id used for the host's own microphone.
+    static QString localSourceId();
+
+    // With playback set, the host's mix is played from the mixer thread
+    // as well as handed out through frameMixed().
+    bool start(quint16 listenPort, quint16 peerPort, AudioEngine *playback = nullptr);
+    void stop();
+    bool isRunning() const { return running.load(); }
+
+    // Feeds the full mix (the host included) to recorder on every tick;
+    // nullptr detaches it. Waits for the mixer thread.
+    void setRecorder(MeetingRecorder *recorder);
+    void setPeerCodec(const QString &ip, AudioCodec::Type type, int bitrate);
+    void addRecipient(const QString &ip);
+    void removePeer(const QString &ip);
+    // Feeds one 20 ms frame of the host's own microphone. Safe to call
+    // from the audio thread.
+    void pushLocalFrame(const QByteArray &pcm);
+
+signals:
+    // Emitted once per mixer tick. The frame excludes the local source so
+    // that the host does not hear itself; levels are in dBov for every
+    // source with a frame this tick, mixed or not.
+    void frameMixed(const QByteArray &pcm, const QHash<QString, double> &levels, int packetsReceived);
+    void sourceStatsUpdated(const QList<AudioMixer::SourceStats> &stats);
+
+    // Forwarded to the mixer thread.
+    void peerCodecConfigured(const QString &ip, int codecType, int bitrate);
+    void recipientAdded(const QString &ip);
+    void peerRemoved(const QString &ip);
+    void localFrameQueued(const QByteArray &pcm);
+
+private:
+    QThread mixThread;
+    AudioMixerWorker *worker;
+    std::atomic<bool> running;
+};
+
+#endif // AUDIOMIXER_H
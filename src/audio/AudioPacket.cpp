@@ -0,0 +1,86 @@
+#include "AudioPacket.h"
+
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+
+#include "AudioDsp.h"
+
+namespace AudioPacket {
+
+quint8 levelByte(const qint16 *samples, int count, bool voice)
+{
+    const double rms = count > 0 ? AudioDsp::measureLevel(samples, count).rms : 0.0;
+    int level = kSilentLevel;
+    if (rms > 0.0) {
+        level = qBound(0, int(std::lround(-20.0 * std::log10(rms / 32768.0))), int(kSilentLevel));
+    }
+    return quint8(level | (voice ? 0x80 : 0x00));
+}
+
+void writeHeader(uchar *out, quint8 payloadType, quint32 seq, quint32 timestamp, quint8 level)
+{
+    out[0] = kMarker;
+    out[1] = payloadType;
+    qToBigEndian<quint32>(seq, out + 2);
+    qToBigEndian<quint32>(timestamp, out + 6);
+    out[10] = level;
+}
+
+void writeLegacyHeader(uchar *out, quint32 seq)
+{
+    qToBigEndian<quint32>(seq, out);
+}
+
+QByteArray build(quint8 payloadType, quint32 seq, quint32 timestamp, quint8 level, const QByteArray &payload)
+{
+    QByteArray packet(kHeaderSize + payload.size(), Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar *>(packet.data());
+    writeHeader(out, payloadType, seq, timestamp, level);
+    if (!payload.isEmpty()) {
+        memcpy(out + kHeaderSize, payload.constData(), size_t(payload.size()));
+    }
+    return packet;
+}
+
+QByteArray buildLegacy(quint32 seq, const QByteArray &pcm)
+{
+    QByteArray packet(kLegacyHeaderSize + pcm.size(), Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar *>(packet.data());
+    writeLegacyHeader(out, seq);
+    if (!pcm.isEmpty()) {
+        memcpy(out + kLegacyHeaderSize, pcm.constData(), size_t(pcm.size()));
+    }
+    return packet;
+}
+
+bool parse(const QByteArray &datagram, Header &outHeader, QByteArray &outPayload)
+{
+    const uchar *in = reinterpret_cast<const uchar *>(datagram.constData());
+
+    if ((datagram.size() >= kHeaderSize && in[0] == kMarker)
+        || (datagram.size() >= kHeaderSizeNoLevel && in[0] == kMarkerNoLevel)) {
+        outHeader.legacy = false;
+        outHeader.payloadType = in[1];
+        outHeader.seq = qFromBigEndian<quint32>(in + 2);
+        outHeader.timestamp = qFromBigEndian<quint32>(in + 6);
+        outHeader.hasLevel = in[0] == kMarker;
+        outHeader.level = outHeader.hasLevel ? quint8(in[10] & 0x7F) : kSilentLevel;
+        outHeader.voice = outHeader.hasLevel && (in[10] & 0x80) != 0;
+        outPayload = datagram.mid(outHeader.hasLevel ? kHeaderSize : kHeaderSizeNoLevel);
+        return !outPayload.isEmpty();
+    }
+
+    if (datagram.size() > kLegacyHeaderSize) {
+        outHeader.legacy = true;
+        outHeader.payloadType = 0;
+        outHeader.seq = qFromBigEndian<quint32>(in);
+        outHeader.timestamp = 0;
+        outPayload = datagram.mid(kLegacyHeaderSize);
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace AudioPacket
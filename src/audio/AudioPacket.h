@@ -0,0 +1,76 @@
+#ifndef AUDIOPACKET_H
+#define AUDIOPACKET_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+// Wire format of audio datagrams.
+//
+// Legacy peers send a 4-byte big-endian sequence number followed by raw
+// PCM. Peers that negotiated a codec over the control channel prefix each
+// datagram with a versioned header instead:
+//
+//   marker (1) + payloadType (1) + sequence (4) + timestamp (4) + level (1)
+//   + payload
+//
+// The timestamp is an RTP-style sample clock: the index of the first
+// sample in the frame at Config::AUDIO_SAMPLE_RATE, starting from a
+// random offset. Multi-byte fields are big-endian.
+//
+// The level byte follows RFC 6464: the top bit is set while the sender's
+// voice activity detector hears speech, the low seven bits are the
+// frame's RMS level in -dBov (127 = silence). It lets the host rank
+// sources without decoding them. The first revision of the header had no
+// level byte (kMarkerNoLevel); it is still accepted.
+//
+// Senders using discontinuous transmission stop sending during silence
+// apart from occasional comfort-noise descriptors (see ComfortNoise.h).
+// Those take a sequence number like any frame, so the gap they leave in
+// the sample clock is not mistaken for loss.
+//
+// A legacy sequence number would need years of continuous audio before its
+// first byte reached the marker value, so both formats can share a port.
+namespace AudioPacket {
+
+constexpr quint8 kMarker = 0xA2;
+constexpr quint8 kMarkerNoLevel = 0xA1;
+constexpr int kLegacyHeaderSize = 4;
+constexpr int kHeaderSize = 1 + 1 + 4 + 4 + 1;
+constexpr int kHeaderSizeNoLevel = 1 + 1 + 4 + 4;
+constexpr quint8 kSilentLevel = 127;
+// Payload type of comfort-noise descriptors: the static RTP type for CN,
+// well clear of the AudioCodec::Type values.
+constexpr quint8 kComfortNoisePayloadType = 13;
+// Redundant frames and receiver loss reports (see AudioRedundancy.h),
+// in the dynamic RTP range.
+constexpr quint8 kRedPayloadType = 96;
+constexpr quint8 kLossReportPayloadType = 97;
+
+struct Header
+{
+    bool legacy = true;
+    quint8 payloadType = 0;
+    quint32 seq = 0;
+    // Only carried by the versioned format.
+    quint32 timestamp = 0;
+    // Only carried by the current versioned format.
+    bool hasLevel = false;
+    quint8 level = kSilentLevel;
+    bool voice = false;
+};
+
+// RFC 6464 level byte for a frame of PCM.
+quint8 levelByte(const qint16 *samples, int count, bool voice);
+
+// In-place writers for callers that reuse a preallocated packet buffer.
+// `out` must have room for kHeaderSize / kLegacyHeaderSize bytes.
+void writeHeader(uchar *out, quint8 payloadType, quint32 seq, quint32 timestamp, quint8 level);
+void writeLegacyHeader(uchar *out, quint32 seq);
+
+QByteArray build(quint8 payloadType, quint32 seq, quint32 timestamp, quint8 level, const QByteArray &payload);
+QByteArray buildLegacy(quint32 seq, const QByteArray &pcm);
+bool parse(const QByteArray &datagram, Header &outHeader, QByteArray &outPayload);
+
+} // namespace AudioPacket
+
+#endif // AUDIOPACKET_H
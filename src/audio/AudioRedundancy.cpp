@@ -0,0 +1,229 @@
+#include "AudioRedundancy.h"
+
+#include <QtEndian>
+#include <cstring>
+
+namespace AudioRedundancy {
+
+namespace {
+// Redundant copies use half the primary bitrate, but no less than this.
+constexpr int kMinSecondaryBitrate = 8000;
+
+// Loss thresholds, as fractions of packets.
+constexpr double kDepthOneLoss = 0.01;
+constexpr double kDepthTwoLoss = 0.05;
+constexpr double kBackToOneLoss = 0.02;
+constexpr double kBackToZeroLoss = 0.005;
+
+bool seqAfter(quint32 a, quint32 b)
+{
+    return qint32(a - b) > 0;
+}
+} // namespace
+
+bool parse(const QByteArray &payload, QVector<Block> &outBlocks)
+{
+    outBlocks.clear();
+    const auto *in = reinterpret_cast<const uchar *>(payload.constData());
+    const int size = int(payload.size());
+    if (size < 2) {
+        return false;
+    }
+
+    const int redundant = in[0];
+    const int headerBytes = 1 + redundant * kBlockHeaderSize + 1;
+    if (redundant > kMaxDepth || size < headerBytes) {
+        return false;
+    }
+
+    int offset = headerBytes;
+    for (int i = 0; i < redundant; ++i) {
+        const uchar *header = in + 1 + i * kBlockHeaderSize;
+        const int length = qFromBigEndian<quint16>(header + 2);
+        if (header[1] == 0 || offset + length > size) {
+            return false;
+        }
+        Block block;
+        block.payloadType = header[0];
+        block.seqBack = header[1];
+        block.data = payload.mid(offset, length);
+        outBlocks.append(block);
+        offset += length;
+    }
+
+    Block primary;
+    primary.payloadType = in[headerBytes - 1];
+    primary.data = payload.mid(offset);
+    if (primary.data.isEmpty()) {
+        return false;
+    }
+    outBlocks.append(primary);
+    return true;
+}
+
+int depthForLoss(int currentDepth, quint8 fractionLost)
+{
+    const double loss = fractionLost / 256.0;
+    int depth = currentDepth;
+    if (loss >= kDepthTwoLoss) {
+        depth = 2;
+    } else if (loss >= kDepthOneLoss) {
+        depth = qMax(depth, 1);
+    }
+
+    if (depth == currentDepth) {
+        if (depth == 2 && loss < kBackToOneLoss) {
+            depth = 1;
+        } else if (depth == 1 && loss < kBackToZeroLoss) {
+            depth = 0;
+        }
+    }
+    return qBound(0, depth, qMin(kMaxDepth, Config::AUDIO_REDUNDANCY_MAX_DEPTH));
+}
+
+Encoder::Encoder()
+    : historyCount(0)
+    , historyNext(0)
+    , secondary(nullptr)
+    , depthValue(0)
+{
+}
+
+Encoder::~Encoder()
+{
+    delete secondary;
+}
+
+void Encoder::configure(AudioCodec::Type type, int bitrate)
+{
+    delete secondary;
+    secondary = nullptr;
+    if (type != AudioCodec::Type::Pcm16) {
+        secondary = AudioCodec::create(type, qMax(bitrate / 2, kMinSecondaryBitrate));
+    }
+    historyCount = 0;
+    historyNext = 0;
+}
+
+void Encoder::setDepth(int depth)
+{
+    depth = qBound(0, depth, kMaxDepth);
+    if (depth == depthValue) {
+        return;
+    }
+    depthValue = depth;
+    if (depth == 0) {
+        // Nothing is remembered while redundancy is off, so nothing stale
+        // is sent when it comes back.
+        historyCount = 0;
+        historyNext = 0;
+    }
+}
+
+int Encoder::wrap(quint32 seq,
+                  const qint16 *pcm,
+                  int samples,
+                  quint8 primaryType,
+                  const uchar *primary,
+                  int primaryBytes,
+                  uchar *out,
+                  int maxBytes)
+{
+    // Newest depth entries, oldest first, dropping any that no longer fit
+    // in a packet or in the one-byte sequence distance.
+    const Entry *blocks[kMaxDepth];
+    int blockCount = 0;
+    int total = 1 + 1 + primaryBytes;
+    for (int back = qMin(depthValue, historyCount); back >= 1; --back) {
+        const Entry &entry = history[(historyNext - back + kMaxDepth) % kMaxDepth];
+        const quint32 distance = seq - entry.seq;
+        if (distance == 0 || distance > 255) {
+            continue;
+        }
+        blocks[blockCount++] = &entry;
+        total += kBlockHeaderSize + entry.size;
+    }
+    while (blockCount > 0 && total > maxBytes) {
+        total -= kBlockHeaderSize + blocks[0]->size;
+        memmove(blocks, blocks + 1, size_t(blockCount - 1) * sizeof(blocks[0]));
+        --blockCount;
+    }
+    if (total > maxBytes) {
+        return -1;
+    }
+
+    uchar *header = out;
+    *header++ = uchar(blockCount);
+    for (int i = 0; i < blockCount; ++i) {
+        header[0] = blocks[i]->payloadType;
+        header[1] = uchar(seq - blocks[i]->seq);
+        qToBigEndian<quint16>(quint16(blocks[i]->size), header + 2);
+        header += kBlockHeaderSize;
+    }
+    *header++ = primaryType;
+
+    uchar *data = header;
+    for (int i = 0; i < blockCount; ++i) {
+        memcpy(data, blocks[i]->data, size_t(blocks[i]->size));
+        data += blocks[i]->size;
+    }
+    memcpy(data, primary, size_t(primaryBytes));
+
+    remember(seq, pcm, samples, primaryType, primary, primaryBytes);
+    return total;
+}
+
+void Encoder::remember(quint32 seq, const qint16 *pcm, int samples, quint8 primaryType, const uchar *primary, int primaryBytes)
+{
+    Entry &entry = history[historyNext];
+    entry.seq = seq;
+    entry.size = secondary ? secondary->encodeFrame(pcm, samples, entry.data, int(sizeof(entry.data))) : -1;
+    if (entry.size > 0) {
+        entry.payloadType = quint8(secondary->type());
+    } else if (primaryBytes <= int(sizeof(entry.data))) {
+        entry.payloadType = primaryType;
+        entry.size = primaryBytes;
+        memcpy(entry.data, primary, size_t(primaryBytes));
+    } else {
+        return;
+    }
+    historyNext = (historyNext + 1) % kMaxDepth;
+    historyCount = qMin(historyCount + 1, kMaxDepth);
+}
+
+void LossMeter::reset()
+{
+    started = false;
+    base = 0;
+    highest = 0;
+    received = 0;
+}
+
+void LossMeter::notePacket(quint32 seq)
+{
+    if (!started) {
+        started = true;
+        base = seq;
+        highest = seq;
+    } else if (seqAfter(seq, highest)) {
+        highest = seq;
+    }
+    ++received;
+}
+
+quint8 LossMeter::takeFractionLost()
+{
+    if (!started) {
+        return 0;
+    }
+    const qint64 expected = qint64(qint32(highest - base)) + 1;
+    const qint64 lost = expected - qint64(received);
+    base = highest + 1;
+    received = 0;
+    if (expected <= 0 || lost <= 0) {
+        return 0;
+    }
+    return quint8(qMin<qint64>(lost * 256 / expected, 255));
+}
+
+} // namespace AudioRedundancy
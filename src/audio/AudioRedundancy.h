@@ -0,0 +1,118 @@
+#ifndef AUDIOREDUNDANCY_H
+#define AUDIOREDUNDANCY_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+#include "audio/AudioCodec.h"
+#include "common/Config.h"
+
+// Redundant audio (RED), after RFC 2198, and the loss feedback that
+// drives it.
+//
+// With redundancy on, each packet carries up to kMaxDepth earlier frames
+// besides its own, so a receiver can rebuild a lost frame from the next
+// packet instead of concealing it. Earlier frames are re-encoded at a
+// lower bitrate when a codec is in use; raw PCM is repeated as is.
+// Receivers report the fraction of packets they lose about once a
+// second and senders pick the depth from that, so a clean LAN carries
+// no redundancy at all.
+//
+// RED payload (versioned packets with AudioPacket::kRedPayloadType):
+//
+//   blockCount (1)
+//   per redundant block, oldest first: payloadType (1) + seqBack (1) + length (2)
+//   primary payloadType (1)
+//   redundant block data in the same order, then the primary data
+//
+// Loss report payload (AudioPacket::kLossReportPayloadType): one byte,
+// the RFC 3550 fixed-point fraction of packets lost since the last one.
+namespace AudioRedundancy {
+
+constexpr int kMaxDepth = 2;
+constexpr int kBlockHeaderSize = 4;
+// Largest RED payload: all headers plus kMaxDepth + 1 raw PCM frames.
+constexpr int kMaxPayloadBytes = 1 + kMaxDepth * kBlockHeaderSize + 1 + (kMaxDepth + 1) * Config::AUDIO_FRAME_BYTES;
+
+struct Block
+{
+    quint8 payloadType = 0;
+    // Sequence distance back from the packet's own frame (0 = primary).
+    quint8 seqBack = 0;
+    QByteArray data;
+};
+
+// Splits a RED payload into its blocks, oldest first and the primary
+// last, which is also the order a stateful decoder wants them in.
+bool parse(const QByteArray &payload, QVector<Block> &outBlocks);
+
+// Redundancy depth for the next interval given the loss a receiver
+// reported. Rises at once, falls one step per clean report.
+int depthForLoss(int currentDepth, quint8 fractionLost);
+
+// Send side: remembers the last frames and wraps each new primary frame
+// with as many of them as the current depth asks for. Not thread-safe.
+class Encoder
+{
+public:
+    Encoder();
+    ~Encoder();
+    Encoder(const Encoder &) = delete;
+    Encoder &operator=(const Encoder &) = delete;
+
+    // Matches the primary codec. Drops the history.
+    void configure(AudioCodec::Type type, int bitrate);
+    void setDepth(int depth);
+    int depth() const { return depthValue; }
+
+    // Writes the RED payload for frame `seq`, whose primary encoding is
+    // given, and keeps a redundant copy of `pcm` for the following
+    // packets. Returns the payload size, or -1 if it does not fit.
+    int wrap(quint32 seq,
+             const qint16 *pcm,
+             int samples,
+             quint8 primaryType,
+             const uchar *primary,
+             int primaryBytes,
+             uchar *out,
+             int maxBytes);
+
+private:
+    struct Entry
+    {
+        quint32 seq;
+        quint8 payloadType;
+        int size;
+        uchar data[Config::AUDIO_FRAME_BYTES];
+    };
+
+    void remember(quint32 seq, const qint16 *pcm, int samples, quint8 primaryType, const uchar *primary, int primaryBytes);
+
+    Entry history[kMaxDepth];
+    int historyCount;
+    int historyNext;
+    // Lower-bitrate encoder for the redundant copies; null for raw PCM.
+    AudioCodec *secondary;
+    int depthValue;
+};
+
+// Receive side: packets lost per report interval, from sequence numbers.
+class LossMeter
+{
+public:
+    void reset();
+    void notePacket(quint32 seq);
+    // Fraction lost since the previous call, in 1/256 units.
+    quint8 takeFractionLost();
+
+private:
+    bool started = false;
+    quint32 base = 0;
+    quint32 highest = 0;
+    quint32 received = 0;
+};
+
+} // namespace AudioRedundancy
+
+#endif // AUDIOREDUNDANCY_H
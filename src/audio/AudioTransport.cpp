@@ -1,105 +1,550 @@
 #include "AudioTransport.h"
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QHostAddress>
-#include <QtEndian>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QSemaphore>
+#include <QThread>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVector>
 #include <algorithm>
-#include <limits>
-#include <utility>
+#include <atomic>
+#include <cmath>
+#include <cstring>
 
 #include "AudioEngine.h"
+#include "AudioFramer.h"
+#include "AudioPacket.h"
+#include "AudioRedundancy.h"
+#include "ComfortNoise.h"
+#include "JitterBuffer.h"
+#include "VoiceActivityDetector.h"
+#include "common/Config.h"
 #include "common/Logger.h"
+#include "common/SpscRing.h"
+#include "common/TripleBuffer.h"
+
+namespace {
+// GUI calls waiting for the audio thread; it drains them every tick.
+constexpr int kCommandRingSize = 16;
+// Enough for 320 ms of audio; the send thread normally drains every frame
+// within microseconds of it being queued.
+constexpr int kSendRingFrames = 16;
+// Largest packet the send thread builds: raw PCM frames in a full RED
+// payload behind the versioned header (compressed payloads are smaller).
+constexpr int kMaxPacketBytes = AudioPacket::kHeaderSize + AudioRedundancy::kMaxPayloadBytes;
+// Capture bytes pulled from the device per read.
+constexpr int kCaptureReadBytes = Config::AUDIO_FRAME_BYTES * 4;
+constexpr int kSidIntervalFrames = Config::AUDIO_DTX_SID_INTERVAL_MS / Config::AUDIO_FRAME_MS;
+// Later frames that may arrive before a missing one is given up on.
+constexpr int kMaxReorderFrames = 2;
+
+bool seqBefore(quint32 a, quint32 b)
+{
+    return qint32(a - b) < 0;
+}
 
-// Worker object that lives in a dedicated high-priority thread and
-// performs the actual UDP send for audio frames so that the main/UI
-// thread (where AudioEngine typically lives) is not blocked by
-// network I/O or kernel socket back-pressure.
-class AudioSendWorker : public QObject
+// One captured frame on its way to the send thread. Frames are written
+// in place into preallocated ring slots.
+struct SendFrame
 {
-    Q_OBJECT
+    qint16 samples[Config::AUDIO_FRAME_SAMPLES];
+    quint32 seq;
+    quint32 timestamp;
+    // Frames left over from a previous start/stop are dropped.
+    quint32 session;
+    // Send a comfort-noise descriptor of these samples instead of
+    // the audio itself (the sender is in DTX).
+    bool comfortNoise;
+    // The capture-side VAD heard speech (or is in its hangover).
+    bool voice;
+};
+}
+
+// A GUI call on its way to the audio thread.
+struct AudioTransport::Command
+{
+    enum class Type
+    {
+        Start,
+        StartSendOnly,
+        StartCaptureOnly,
+        Stop,
+        SetMuted,
+        SetCodec,
+        ResetCodec,
+        // Stop, and never touch the command ring again.
+        Shutdown,
+    };
+
+    Type type = Type::Stop;
+    quint16 localPort = 0;
+    QString remoteIp;
+    quint16 remotePort = 0;
+    bool muted = false;
+    int codecType = 0;
+    int bitrate = 0;
+    // The caller waits for the result.
+    bool reply = false;
+};
 
+// Dedicated high-priority thread that encodes and sends audio frames so
+// that the audio thread, which also serves the devices, is never blocked
+// by codec work, network I/O or kernel socket back-pressure.
+//
+// Frames arrive through a preallocated SPSC ring and the thread is woken
+// by a semaphore rather than queued events. The destination is resolved
+// once per session and packets are built in a reused buffer, so the
+// steady-state path does not touch the heap.
+class AudioSendThread : public QThread
+{
 public:
-    explicit AudioSendWorker(QObject *parent = nullptr)
-        : QObject(parent)
-        , socket(nullptr)
+    explicit AudioSendThread(SpscRing<SendFrame> &ringValue)
+        : ring(ringValue)
+        , session(0)
+        , port(0)
+        , encoder(nullptr)
+        , versioned(false)
     {
+        setObjectName(QStringLiteral("AudioSendThread"));
     }
 
-public slots:
-    void sendAudioFrame(const QByteArray &data, const QString &ip, quint16 port)
+    ~AudioSendThread() override
+    {
+        stopRequested.store(true);
+        wakeup.release();
+        wait();
+        delete encoder;
+    }
+
+    // The configure calls come from the capture thread and are picked up
+    // by the send thread before it handles the next frame.
+    void configureSession(quint32 sessionValue, const QString &ip, quint16 portValue)
+    {
+        QMutexLocker locker(&configMutex);
+        pending.session = sessionValue;
+        pending.ip = ip;
+        pending.port = portValue;
+        configDirty.store(true);
+    }
+
+    void configureCodec(int codecType, int bitrate, bool versionedValue)
+    {
+        QMutexLocker locker(&configMutex);
+        pending.codecChanged = true;
+        pending.codecType = codecType;
+        pending.bitrate = bitrate;
+        pending.versioned = versionedValue;
+        configDirty.store(true);
+    }
+
+    // Takes effect from the next frame; any thread.
+    void setRedundancyDepth(int depth) { redundancyDepth.store(depth); }
+
+    void wake() { wakeup.release(); }
+
+protected:
+    void run() override
+    {
+        QUdpSocket socket;
+        packet.resize(kMaxPacketBytes);
+
+        while (true) {
+            wakeup.acquire();
+            if (stopRequested.load()) {
+                break;
+            }
+
+            applyPendingConfig();
+            while (SendFrame *frame = ring.front()) {
+                if (frame->session != session) {
+                    // The session may have changed after the check above.
+                    applyPendingConfig();
+                }
+                if (frame->session == session && port != 0) {
+                    sendFrame(socket, *frame);
+                }
+                ring.popFront();
+            }
+        }
+    }
+
+private:
+    struct PendingConfig
     {
-        if (data.isEmpty() || ip.isEmpty() || port == 0) {
+        quint32 session = 0;
+        QString ip;
+        quint16 port = 0;
+        bool codecChanged = false;
+        int codecType = 0;
+        int bitrate = 0;
+        bool versioned = false;
+    };
+
+    void applyPendingConfig()
+    {
+        if (!configDirty.exchange(false)) {
+            return;
+        }
+
+        PendingConfig config;
+        {
+            QMutexLocker locker(&configMutex);
+            config = pending;
+            pending.codecChanged = false;
+        }
+
+        if (config.session != session) {
+            session = config.session;
+            port = config.port;
+            address = config.ip.isEmpty() ? QHostAddress() : QHostAddress(config.ip);
+            if (port != 0 && address.isNull()) {
+                LOG_WARN(QStringLiteral("AudioSendThread: invalid destination address %1").arg(config.ip));
+                port = 0;
+            }
+        }
+
+        if (!config.codecChanged) {
+            return;
+        }
+
+        delete encoder;
+        encoder = nullptr;
+        versioned = config.versioned;
+        if (!versioned) {
             return;
         }
 
-        if (!socket) {
-            socket = new QUdpSocket(this);
+        const auto type = static_cast<AudioCodec::Type>(config.codecType);
+        encoder = AudioCodec::create(type, config.bitrate);
+        redundancy.configure(type, config.bitrate);
+        if (!encoder) {
+            LOG_WARN(QStringLiteral("AudioSendThread: codec %1 unavailable, sending raw PCM")
+                         .arg(AudioCodec::name(type)));
         }
+    }
 
-        const qint64 written = socket->writeDatagram(data, QHostAddress(ip), port);
+    void sendFrame(QUdpSocket &socket, const SendFrame &frame)
+    {
+        uchar *out = reinterpret_cast<uchar *>(packet.data());
+        int size = 0;
+
+        if (frame.comfortNoise && versioned) {
+            // The analysis runs here rather than on the capture tick.
+            const ComfortNoise::Parameters noise =
+                ComfortNoise::analyze(frame.samples, Config::AUDIO_FRAME_SAMPLES);
+            const int payloadBytes = ComfortNoise::encode(noise, out + AudioPacket::kHeaderSize);
+            AudioPacket::writeHeader(out,
+                                     AudioPacket::kComfortNoisePayloadType,
+                                     frame.seq,
+                                     frame.timestamp,
+                                     noise.level);
+            size = AudioPacket::kHeaderSize + payloadBytes;
+        } else if (!versioned) {
+            AudioPacket::writeLegacyHeader(out, frame.seq);
+            memcpy(out + AudioPacket::kLegacyHeaderSize, frame.samples, size_t(Config::AUDIO_FRAME_BYTES));
+            size = AudioPacket::kLegacyHeaderSize + Config::AUDIO_FRAME_BYTES;
+        } else {
+            // Encode on this thread; fall back to raw PCM for any frame the
+            // codec refuses so that audio never stops flowing. With
+            // redundancy on, the frame is encoded aside and then wrapped
+            // together with the previous ones.
+            redundancy.setDepth(redundancyDepth.load());
+            const bool red = redundancy.depth() > 0;
+            uchar *primary = red ? primaryFrame : out + AudioPacket::kHeaderSize;
+            auto payloadType = AudioCodec::Type::Pcm16;
+            int payloadBytes = encoder ? encoder->encodeFrame(frame.samples,
+                                                              Config::AUDIO_FRAME_SAMPLES,
+                                                              primary,
+                                                              Config::AUDIO_FRAME_BYTES)
+                                       : -1;
+            if (payloadBytes > 0) {
+                payloadType = encoder->type();
+            } else {
+                memcpy(primary, frame.samples, size_t(Config::AUDIO_FRAME_BYTES));
+                payloadBytes = Config::AUDIO_FRAME_BYTES;
+            }
+
+            quint8 packetType = quint8(payloadType);
+            if (red) {
+                const int redBytes = redundancy.wrap(frame.seq,
+                                                     frame.samples,
+                                                     Config::AUDIO_FRAME_SAMPLES,
+                                                     packetType,
+                                                     primary,
+                                                     payloadBytes,
+                                                     out + AudioPacket::kHeaderSize,
+                                                     kMaxPacketBytes - AudioPacket::kHeaderSize);
+                if (redBytes > 0) {
+                    packetType = AudioPacket::kRedPayloadType;
+                    payloadBytes = redBytes;
+                } else {
+                    memcpy(out + AudioPacket::kHeaderSize, primary, size_t(payloadBytes));
+                }
+            }
+            // The level lets the host mixer rank this stream without
+            // decoding it.
+            AudioPacket::writeHeader(out,
+                                     packetType,
+                                     frame.seq,
+                                     frame.timestamp,
+                                     AudioPacket::levelByte(frame.samples, Config::AUDIO_FRAME_SAMPLES, frame.voice));
+            size = AudioPacket::kHeaderSize + payloadBytes;
+        }
+
+        const qint64 written = socket.writeDatagram(packet.constData(), size, address, port);
         if (written < 0) {
-            LOG_WARN(QStringLiteral("AudioSendWorker: failed to send UDP datagram to %1:%2 - %3")
-                         .arg(ip)
+            LOG_WARN(QStringLiteral("AudioSendThread: failed to send UDP datagram to %1:%2 - %3")
+                         .arg(address.toString())
                          .arg(port)
-                         .arg(socket->errorString()));
+                         .arg(socket.errorString()));
         }
     }
 
+    SpscRing<SendFrame> &ring;
+    QSemaphore wakeup;
+    std::atomic<bool> stopRequested{false};
+
+    // Written by the capture thread, consumed when configDirty is set.
+    QMutex configMutex;
+    std::atomic<bool> configDirty{false};
+    PendingConfig pending;
+
+    // Owned by the send thread.
+    quint32 session;
+    QHostAddress address;
+    quint16 port;
+    AudioCodec *encoder;
+    bool versioned;
+    QByteArray packet;
+    AudioRedundancy::Encoder redundancy;
+    std::atomic<int> redundancyDepth{0};
+    uchar primaryFrame[Config::AUDIO_FRAME_BYTES];
+};
+
+// All audio-path state of the transport. Lives on the engine's audio
+// thread; the GUI only reaches it through the command ring, the reply
+// semaphore and the published stats.
+class AudioTransportWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AudioTransportWorker(AudioEngine *engine);
+    ~AudioTransportWorker() override;
+
+    SpscRing<AudioTransport::Command> commands;
+    // Released once for each command that asked for a reply.
+    QSemaphore replies;
+    std::atomic<bool> replyResult{false};
+    TripleBuffer<AudioTransport::Stats> stats;
+
+public slots:
+    // Starts the frame tick; queued once the worker is on its thread.
+    void begin();
+
+signals:
+    void localFrameCaptured(const QByteArray &pcm, quint32 timestamp);
+    void audioFrameReceived();
+
+private slots:
+    void onReadyRead();
+    void onTick();
+
 private:
-    QUdpSocket *socket;
+    bool runCommand(const AudioTransport::Command &command);
+    bool startTransport(quint16 localPort, const QString &remoteIp, quint16 remotePort);
+    bool startSendOnly(const QString &remoteIp, quint16 remotePort);
+    bool startCaptureOnly();
+    void stopTransport();
+    void setCodec(AudioCodec::Type type, int bitrate);
+    void resetCodec();
+    void captureFrames();
+    void publishStats();
+    void beginSendSession();
+    bool decodePayload(quint8 payloadType, const QByteArray &payload, QByteArray &outPcm);
+    void setRedundancyDepth(int depth);
+    void onLossReport(quint8 fractionLost);
+    void sendLossReport();
+
+    QUdpSocket *udpRecvSocket;
+    quint16 localPort;
+    QString remoteIp;
+    quint16 remotePort;
+    AudioEngine *audio;
+    // Runs for the worker's whole life: drains commands, then captures
+    // when a session is active.
+    QTimer *tickTimer;
+    bool capturing = false;
+    bool shutDown = false;
+    bool muted;
+    bool m_captureOnly = false;
+    uint32_t m_lastSeq = 0;
+    uint32_t m_sendSeq = 0;
+    uint32_t m_expectedSeq = 1;
+    // Decoded PCM, or the raw descriptor for comfort-noise packets.
+    struct ReceivedFrame
+    {
+        QByteArray data;
+        bool comfortNoise = false;
+    };
+    QMap<uint32_t, ReceivedFrame> m_reorderBuf;
+    // Ordered frames wait here until the playback device pulls them.
+    JitterBuffer m_jitter;
+
+    // Codec state. The encoder lives on the send thread; decoders are
+    // created lazily per payload type on the receive side.
+    bool m_versionedPackets = false;
+    AudioCodec::Type m_codecType = AudioCodec::Type::Pcm16;
+    int m_codecBitrate = 0;
+    QHash<quint8, AudioCodec *> m_decoders;
+
+    // Capture side: slices device reads into exact frames and owns the
+    // outgoing sample clock.
+    AudioFramer m_framer;
+    QByteArray m_captureBuffer;
+    QVector<qint16> m_discardFrame;
+
+    // Discontinuous transmission: silent frames are not sent, apart from
+    // a comfort-noise descriptor every AUDIO_DTX_SID_INTERVAL_MS.
+    VoiceActivityDetector m_vad;
+    int m_sidCountdown = 0;
+    quint64 m_dtxFrames = 0;
+
+    // Receive side: RFC 3550 interarrival jitter (in samples), computed
+    // from the sender's sample-clock timestamps on versioned packets.
+    QElapsedTimer m_transitClock;
+    bool m_haveTransit = false;
+    qint64 m_lastArrivalSamples = 0;
+    quint32 m_lastRtpTimestamp = 0;
+    double m_transitJitter = 0.0;
+
+    // Redundancy: this side measures the loss of what it receives and
+    // reports it back; the far end's reports set the send-side depth.
+    AudioRedundancy::LossMeter m_lossMeter;
+    QElapsedTimer m_lossReportTimer;
+    QVector<AudioRedundancy::Block> m_redBlocks;
+    quint64 m_recoveredFrames = 0;
+    int m_redundancyDepth = 0;
+
+    // Captured frames are handed to a dedicated high-priority thread that
+    // owns the UDP send socket, through a lock-free ring so the capture
+    // tick never allocates or posts events.
+    SpscRing<SendFrame> m_sendRing;
+    quint32 m_sendSession = 0;
+    quint64 m_sendOverruns = 0;
+    AudioSendThread *sendThread;
 };
 
-AudioTransport::AudioTransport(AudioEngine *engine, QObject *parent)
-    : QObject(parent)
+AudioTransportWorker::AudioTransportWorker(AudioEngine *engine)
+    : commands(kCommandRingSize)
     , udpRecvSocket(new QUdpSocket(this))
     , localPort(0)
     , remoteIp()
     , remotePort(0)
     , audio(engine)
-    , sendTimer(new QTimer(this))
+    , tickTimer(new QTimer(this))
     , muted(false)
-    , m_jitterQueue()
     , m_lastSeq(0)
     , m_sendSeq(0)
     , m_expectedSeq(1)
     , m_reorderBuf()
-    , m_lastPcm()
-    , m_jitterTimer(nullptr)
-    , sendThread()
-    , sendWorker(new AudioSendWorker)
-{
-    sendTimer->setInterval(20);
-    connect(sendTimer, &QTimer::timeout, this, &AudioTransport::onSendTimer);
-
-    // Configure dedicated audio send thread.
-    sendWorker->moveToThread(&sendThread);
-    sendThread.setObjectName(QStringLiteral("AudioSendThread"));
-    connect(&sendThread, &QThread::finished, sendWorker, &QObject::deleteLater);
-
-    // Audio frames captured on the main/GUI thread are forwarded to
-    // the worker via a queued connection so that network I/O happens
-    // independently of screen sharing or video encoding work.
-    connect(this,
-            &AudioTransport::audioFrameCaptured,
-            sendWorker,
-            &AudioSendWorker::sendAudioFrame,
-            Qt::QueuedConnection);
+    , m_captureBuffer(kCaptureReadBytes, Qt::Uninitialized)
+    , m_discardFrame(Config::AUDIO_FRAME_SAMPLES)
+    , m_sendRing(kSendRingFrames)
+    , sendThread(new AudioSendThread(m_sendRing))
+{
+    tickTimer->setTimerType(Qt::PreciseTimer);
+    tickTimer->setInterval(Config::AUDIO_FRAME_MS);
+    connect(tickTimer, &QTimer::timeout, this, &AudioTransportWorker::onTick);
 
     // Give the audio sending thread a higher scheduling priority so
     // that 20 ms audio frames are transmitted on time even under load.
-    sendThread.start(QThread::TimeCriticalPriority);
+    sendThread->start(QThread::TimeCriticalPriority);
 }
 
-AudioTransport::~AudioTransport()
+AudioTransportWorker::~AudioTransportWorker()
+{
+    stopTransport();
+    delete sendThread;
+    qDeleteAll(m_decoders);
+    m_decoders.clear();
+}
+
+void AudioTransportWorker::begin()
+{
+    tickTimer->start();
+}
+
+bool AudioTransportWorker::runCommand(const AudioTransport::Command &command)
 {
-    if (sendThread.isRunning()) {
-        sendThread.quit();
-        sendThread.wait();
+    using Type = AudioTransport::Command::Type;
+    switch (command.type) {
+    case Type::Start:
+        return startTransport(command.localPort, command.remoteIp, command.remotePort);
+    case Type::StartSendOnly:
+        return startSendOnly(command.remoteIp, command.remotePort);
+    case Type::StartCaptureOnly:
+        return startCaptureOnly();
+    case Type::Stop:
+        stopTransport();
+        return true;
+    case Type::SetMuted:
+        muted = command.muted;
+        return true;
+    case Type::SetCodec:
+        setCodec(static_cast<AudioCodec::Type>(command.codecType), command.bitrate);
+        return true;
+    case Type::ResetCodec:
+        resetCodec();
+        return true;
+    case Type::Shutdown:
+        stopTransport();
+        tickTimer->stop();
+        shutDown = true;
+        return true;
     }
+    return false;
+}
 
-    stopTransport();
+void AudioTransportWorker::onTick()
+{
+    while (!shutDown) {
+        AudioTransport::Command *command = commands.front();
+        if (!command) {
+            break;
+        }
+        const bool reply = command->reply;
+        const bool ok = runCommand(*command);
+        commands.popFront();
+        if (reply) {
+            replyResult.store(ok);
+            replies.release();
+        }
+    }
+
+    if (capturing) {
+        captureFrames();
+    }
+    if (!shutDown) {
+        publishStats();
+    }
 }
 
-bool AudioTransport::startTransport(quint16 localPortValue,
+void AudioTransportWorker::beginSendSession()
+{
+    // Resolve the destination once; frames queued under the previous
+    // session are discarded by the send thread.
+    sendThread->configureSession(++m_sendSession, remoteIp, remotePort);
+    sendThread->wake();
+}
+
+bool AudioTransportWorker::startTransport(quint16 localPortValue,
                                     const QString &remoteIpValue,
                                     quint16 remotePortValue)
 {
@@ -116,34 +561,36 @@ bool AudioTransport::startTransport(quint16 localPortValue,
         return false;
     }
 
-    connect(udpRecvSocket, &QUdpSocket::readyRead, this, &AudioTransport::onReadyRead);
+    connect(udpRecvSocket, &QUdpSocket::readyRead, this, &AudioTransportWorker::onReadyRead);
 
-    if (!m_jitterTimer) {
-        m_jitterTimer = new QTimer(this);
-        m_jitterTimer->setInterval(20);
-        connect(m_jitterTimer, &QTimer::timeout, this, &AudioTransport::onJitterTimer);
-    }
-
-    m_jitterQueue.clear();
     m_lastSeq = 0;
     m_sendSeq = 0;
     m_expectedSeq = 1;
     m_reorderBuf.clear();
-    m_jitterTarget = m_jitterMin + 1;
-    m_interArrivalTimes.clear();
-    m_arrivalTimer.invalidate();
-    m_diagTimer.restart();
-    m_plcCount = 0;
-    m_lossEvents = 0;
-    m_lastPcm.clear();
-    m_jitterTimer->start();
-
-    sendTimer->start();
+    m_sendOverruns = 0;
+    m_haveTransit = false;
+    m_transitJitter = 0.0;
+    m_transitClock.invalidate();
+    m_framer.reset(QRandomGenerator::global()->generate());
+    m_vad.reset();
+    m_sidCountdown = 0;
+    m_dtxFrames = 0;
+    m_lossMeter.reset();
+    m_lossReportTimer.invalidate();
+    m_recoveredFrames = 0;
+    setRedundancyDepth(0);
+
+    // Playback pulls received audio straight from the jitter buffer.
+    m_jitter.reset();
+    audio->setPlaybackSource(&m_jitter);
+
+    beginSendSession();
+    capturing = true;
 
     return true;
 }
 
-bool AudioTransport::startSendOnly(const QString &remoteIpValue,
+bool AudioTransportWorker::startSendOnly(const QString &remoteIpValue,
                                    quint16 remotePortValue)
 {
     // Only (re)configure the sending side; do not bind the receive socket.
@@ -153,41 +600,54 @@ bool AudioTransport::startSendOnly(const QString &remoteIpValue,
     remoteIp = remoteIpValue;
     remotePort = remotePortValue;
     m_sendSeq = 0;
-    m_interArrivalTimes.clear();
-    m_arrivalTimer.invalidate();
-    m_diagTimer.restart();
-    m_plcCount = 0;
-    m_lossEvents = 0;
+    m_sendOverruns = 0;
+    m_framer.reset(QRandomGenerator::global()->generate());
+    m_vad.reset();
+    m_sidCountdown = 0;
+    m_dtxFrames = 0;
+    setRedundancyDepth(0);
 
-    sendTimer->start();
+    beginSendSession();
+    capturing = true;
 
     return true;
 }
 
-void AudioTransport::stopTransport()
+bool AudioTransportWorker::startCaptureOnly()
 {
-    if (sendTimer->isActive()) {
-        sendTimer->stop();
-    }
+    stopTransport();
+
+    m_captureOnly = true;
+    m_framer.reset(QRandomGenerator::global()->generate());
+
+    capturing = true;
+
+    return true;
+}
+
+void AudioTransportWorker::stopTransport()
+{
+    capturing = false;
 
-    if (m_jitterTimer) {
-        m_jitterTimer->stop();
-        m_jitterTimer->deleteLater();
-        m_jitterTimer = nullptr;
+    if (audio) {
+        audio->setPlaybackSource(nullptr);
     }
+    m_jitter.reset();
 
-    m_jitterQueue.clear();
     m_lastSeq = 0;
     m_sendSeq = 0;
     m_expectedSeq = 1;
     m_reorderBuf.clear();
-    m_jitterTarget = m_jitterMin + 1;
-    m_interArrivalTimes.clear();
-    m_arrivalTimer.invalidate();
-    m_diagTimer.invalidate();
-    m_plcCount = 0;
-    m_lossEvents = 0;
-    m_lastPcm.clear();
+    m_sendOverruns = 0;
+    m_haveTransit = false;
+    m_transitJitter = 0.0;
+    m_transitClock.invalidate();
+    m_framer.reset();
+    m_captureOnly = false;
+    m_lossMeter.reset();
+    m_lossReportTimer.invalidate();
+    m_recoveredFrames = 0;
+    setRedundancyDepth(0);
 
     if (udpRecvSocket->isOpen()) {
         udpRecvSocket->close();
@@ -199,84 +659,103 @@ void AudioTransport::stopTransport()
     localPort = 0;
     remotePort = 0;
     remoteIp.clear();
+    beginSendSession();
 }
 
-void AudioTransport::setMuted(bool mutedValue)
+void AudioTransportWorker::setCodec(AudioCodec::Type type, int bitrate)
 {
-    muted = mutedValue;
-    LOG_INFO(QStringLiteral("AudioTransport: mute state changed to %1")
-                 .arg(muted ? QStringLiteral("ON") : QStringLiteral("OFF")));
+    m_versionedPackets = true;
+    m_codecType = type;
+    m_codecBitrate = bitrate;
+    sendThread->configureCodec(int(m_codecType), m_codecBitrate, true);
+    m_vad.reset();
+    m_sidCountdown = 0;
 }
 
-void AudioTransport::logDiagnostics() const
+void AudioTransportWorker::resetCodec()
 {
-    qint64 jitterSpread = 0;
-    if (!m_interArrivalTimes.isEmpty()) {
-        qint64 minIa = std::numeric_limits<qint64>::max();
-        qint64 maxIa = 0;
-        for (qint64 ia : std::as_const(m_interArrivalTimes)) {
-            minIa = std::min(minIa, ia);
-            maxIa = std::max(maxIa, ia);
-        }
-        if (maxIa > minIa) {
-            jitterSpread = maxIa - minIa;
-        }
+    if (!m_versionedPackets) {
+        return;
     }
-    LOG_INFO(QStringLiteral("AudioNet diag: jitterQ=%1 target=%2 reorderBuf=%3 plcCount=%4 lossEvents=%5 iaJitter=%6ms")
-                 .arg(m_jitterQueue.size())
-                 .arg(m_jitterTarget)
-                 .arg(m_reorderBuf.size())
-                 .arg(static_cast<qulonglong>(m_plcCount))
-                 .arg(static_cast<qulonglong>(m_lossEvents))
-                 .arg(jitterSpread));
+    m_versionedPackets = false;
+    m_codecType = AudioCodec::Type::Pcm16;
+    m_codecBitrate = 0;
+    sendThread->configureCodec(int(m_codecType), 0, false);
+    LOG_INFO(QStringLiteral("AudioTransport: reverted to legacy raw PCM packets"));
 }
 
-QByteArray AudioTransport::generatePLC(const QByteArray &lastFrame) const
+void AudioTransportWorker::setRedundancyDepth(int depth)
 {
-    if (lastFrame.isEmpty() || (lastFrame.size() % int(sizeof(qint16)) != 0)) {
-        return QByteArray();
+    if (depth != m_redundancyDepth) {
+        LOG_INFO(QStringLiteral("AudioTransport: audio redundancy depth %1 -> %2").arg(m_redundancyDepth).arg(depth));
     }
+    m_redundancyDepth = depth;
+    sendThread->setRedundancyDepth(depth);
+}
 
-    const int sampleCount = lastFrame.size() / int(sizeof(qint16));
-    if (sampleCount <= 0) {
-        return QByteArray();
+void AudioTransportWorker::onLossReport(quint8 fractionLost)
+{
+    // The far end reports how much of what we send gets lost.
+    if (m_versionedPackets) {
+        setRedundancyDepth(AudioRedundancy::depthForLoss(m_redundancyDepth, fractionLost));
     }
+}
 
-    QByteArray plcFrame(lastFrame.size(), Qt::Uninitialized);
-    const qint16 *in = reinterpret_cast<const qint16 *>(lastFrame.constData());
-    qint16 *out = reinterpret_cast<qint16 *>(plcFrame.data());
-
-    const int firstHalf = sampleCount / 2;
-    const int secondHalf = sampleCount - firstHalf;
-
-    auto clampSample = [](double v) -> qint16 {
-        if (v > 32767.0) {
-            return 32767;
-        }
-        if (v < -32768.0) {
-            return -32768;
-        }
-        return static_cast<qint16>(v);
-    };
-
-    for (int i = 0; i < firstHalf; ++i) {
-        const double t = firstHalf > 1 ? static_cast<double>(i) / static_cast<double>(firstHalf - 1) : 0.0;
-        const double gain = 1.0 - 0.5 * t; // from 1.0 down to 0.5
-        out[i] = clampSample(static_cast<double>(in[i]) * gain);
+void AudioTransportWorker::sendLossReport()
+{
+    const char fractionLost = char(m_lossMeter.takeFractionLost());
+    const QByteArray packet = AudioPacket::build(AudioPacket::kLossReportPayloadType,
+                                                 0,
+                                                 0,
+                                                 AudioPacket::kSilentLevel,
+                                                 QByteArray(1, fractionLost));
+    if (udpRecvSocket->writeDatagram(packet, QHostAddress(remoteIp), remotePort) < 0) {
+        LOG_WARN(QStringLiteral("AudioTransport: failed to send loss report to %1:%2 - %3")
+                     .arg(remoteIp)
+                     .arg(remotePort)
+                     .arg(udpRecvSocket->errorString()));
     }
+}
 
-    for (int i = 0; i < secondHalf; ++i) {
-        const double t = secondHalf > 1 ? static_cast<double>(i) / static_cast<double>(secondHalf - 1) : 0.0;
-        const double gain = 0.5 * (1.0 - t); // from 0.5 down to 0.0
-        const int idx = firstHalf + i;
-        const qint16 sample = (idx < sampleCount) ? in[idx] : 0;
-        out[idx] = clampSample(static_cast<double>(sample) * gain);
+bool AudioTransportWorker::decodePayload(quint8 payloadType, const QByteArray &payload, QByteArray &outPcm)
+{
+    AudioCodec *decoder = m_decoders.value(payloadType, nullptr);
+    if (!decoder) {
+        decoder = AudioCodec::create(static_cast<AudioCodec::Type>(payloadType), 0);
+        if (!decoder) {
+            return false;
+        }
+        m_decoders.insert(payloadType, decoder);
     }
+    return decoder->decode(payload, outPcm);
+}
 
-    return plcFrame;
+void AudioTransportWorker::publishStats()
+{
+    AudioTransport::Stats &out = stats.writeSlot();
+    out.jitterDepth = m_jitter.depth();
+    out.targetFrames = m_jitter.targetFrames();
+    out.reorderFrames = m_reorderBuf.size();
+    out.plcFrames = m_jitter.plcCount();
+    out.lossEvents = m_jitter.lossEvents();
+    out.delayP95Ms = m_jitter.delayPercentileMs();
+    out.transitJitterMs = m_transitJitter / (Config::AUDIO_SAMPLE_RATE / 1000.0);
+    out.captureDropped = m_framer.droppedSamples();
+    out.sendOverruns = m_sendOverruns;
+    out.playbackOverflows = audio ? audio->playbackOverflows() : 0;
+    out.underruns = m_jitter.underruns();
+    out.trimmed = m_jitter.trimmedFrames();
+    out.accelerate = m_jitter.accelerateCount();
+    out.expand = m_jitter.expandCount();
+    out.dtxSkipped = m_dtxFrames;
+    out.comfortNoise = m_jitter.comfortNoiseFrames();
+    out.redundancyDepth = m_redundancyDepth;
+    out.recovered = m_recoveredFrames;
+    out.driftPpm = m_jitter.driftPpm();
+    stats.publish();
 }
 
-void AudioTransport::onReadyRead()
+void AudioTransportWorker::onReadyRead()
 {
     if (!audio) {
         return;
@@ -309,153 +788,336 @@ void AudioTransport::onReadyRead()
             continue;
         }
 
-        uint32_t seq = 0;
-        QByteArray pcm;
-        if (buffer.size() >= int(sizeof(uint32_t))) {
-            seq = qFromBigEndian<uint32_t>(reinterpret_cast<const uchar *>(buffer.constData()));
-            pcm = buffer.mid(int(sizeof(uint32_t)));
-        } else {
-            seq = ++m_lastSeq;
-            pcm = buffer;
-        }
-
-        if (pcm.isEmpty()) {
+        AudioPacket::Header header;
+        QByteArray payload;
+        if (!AudioPacket::parse(buffer, header, payload)) {
             LOG_WARN(QStringLiteral("AudioTransport: received UDP audio packet with no PCM payload"));
             continue;
         }
 
-        if (!m_arrivalTimer.isValid()) {
-            m_arrivalTimer.start();
-        } else {
-            const qint64 delta = m_arrivalTimer.restart();
-            if (delta > 0) {
-                m_interArrivalTimes.append(delta);
-                if (m_interArrivalTimes.size() > 20) {
-                    m_interArrivalTimes.remove(0);
-                }
+        if (!header.legacy && header.payloadType == AudioPacket::kLossReportPayloadType) {
+            onLossReport(quint8(payload.at(0)));
+            continue;
+        }
+        const uint32_t seq = header.seq;
 
-                qint64 minIa = std::numeric_limits<qint64>::max();
-                qint64 maxIa = 0;
-                for (qint64 ia : std::as_const(m_interArrivalTimes)) {
-                    minIa = std::min(minIa, ia);
-                    maxIa = std::max(maxIa, ia);
-                }
-                const qint64 jitter = maxIa > minIa ? (maxIa - minIa) : 0;
-                const qint64 highJitter = 20; // ms window mapped to max depth
-                const double ratio = qBound(0.0, double(jitter) / double(highJitter), 1.0);
-                const int target = int(m_jitterMin + ratio * (m_jitterMax - m_jitterMin));
-                m_jitterTarget = qBound(m_jitterMin, target, m_jitterMax);
+        if (!header.legacy) {
+            // RFC 3550 interarrival jitter: compare arrival spacing with the
+            // sender's sample-clock spacing, both measured in samples.
+            if (!m_transitClock.isValid()) {
+                m_transitClock.start();
             }
+            const qint64 arrival =
+                m_transitClock.nsecsElapsed() * (Config::AUDIO_SAMPLE_RATE / 1000) / 1000000;
+            if (m_haveTransit) {
+                const qint64 d = (arrival - m_lastArrivalSamples)
+                                 - qint64(qint32(header.timestamp - m_lastRtpTimestamp));
+                m_transitJitter += (std::abs(double(d)) - m_transitJitter) / 16.0;
+            }
+            m_haveTransit = true;
+            m_lastArrivalSamples = arrival;
+            m_lastRtpTimestamp = header.timestamp;
         }
 
-        m_reorderBuf.insert(seq, pcm);
+        // Legacy packets carry no sample clock, but every sender emits
+        // exactly one 20 ms frame per sequence number.
+        m_jitter.notePacketArrival(header.legacy ? seq * quint32(Config::AUDIO_FRAME_SAMPLES)
+                                                 : header.timestamp);
+        m_lossMeter.notePacket(seq);
+
+        if (qint32(m_expectedSeq - seq) > kMaxReorderFrames * 16) {
+            // Far behind what was already played: the sender restarted.
+            m_reorderBuf.clear();
+            m_expectedSeq = seq;
+        }
+
+        // Decode before the jitter queue so that reordering, PLC and
+        // playback only ever deal with PCM. Comfort-noise descriptors stay
+        // as they are; the jitter buffer synthesises the noise. A RED
+        // packet also carries earlier frames, which fill holes left by
+        // lost packets; blocks come oldest first, the order a stateful
+        // decoder wants.
+        m_redBlocks.clear();
+        if (header.legacy || header.payloadType != AudioPacket::kRedPayloadType) {
+            AudioRedundancy::Block block;
+            block.payloadType = header.payloadType;
+            block.data = payload;
+            m_redBlocks.append(block);
+        } else if (!AudioRedundancy::parse(payload, m_redBlocks)) {
+            LOG_WARN(QStringLiteral("AudioTransport: malformed redundant audio payload (size=%1)").arg(payload.size()));
+            continue;
+        }
 
-        while (m_reorderBuf.contains(m_expectedSeq)) {
-            const QByteArray orderedPcm = m_reorderBuf.take(m_expectedSeq);
-            m_jitterQueue.enqueue({orderedPcm, m_expectedSeq});
-            if (m_jitterQueue.size() > 5) {
-                m_jitterQueue.dequeue();
+        for (const AudioRedundancy::Block &block : std::as_const(m_redBlocks)) {
+            const uint32_t blockSeq = seq - block.seqBack;
+            if (seqBefore(blockSeq, m_expectedSeq) || m_reorderBuf.contains(blockSeq)) {
+                // Already played, given up on, or here already.
+                continue;
             }
-            m_lastPcm = orderedPcm;
-            ++m_expectedSeq;
-            emit audioFrameReceived();
+            ReceivedFrame frame;
+            frame.comfortNoise = !header.legacy && block.payloadType == AudioPacket::kComfortNoisePayloadType;
+            if (header.legacy || frame.comfortNoise) {
+                frame.data = block.data;
+            } else if (!decodePayload(block.payloadType, block.data, frame.data)) {
+                LOG_WARN(QStringLiteral("AudioTransport: failed to decode audio payload (type=%1 size=%2)")
+                             .arg(block.payloadType)
+                             .arg(block.data.size()));
+                continue;
+            }
+            if (block.seqBack > 0) {
+                ++m_recoveredFrames;
+            }
+            m_reorderBuf.insert(blockSeq, frame);
         }
 
-        while (m_reorderBuf.size() > 20) {
+        // Release frames in order. A missing frame is only waited for
+        // until kMaxReorderFrames later ones have arrived; after that the
+        // jitter buffer conceals it.
+        while (!m_reorderBuf.isEmpty()) {
             const auto it = m_reorderBuf.begin();
-            const uint32_t droppedSeq = it.key();
-            m_reorderBuf.erase(it);
-            if (droppedSeq >= m_expectedSeq) {
-                m_expectedSeq = droppedSeq + 1;
+            if (it.key() != m_expectedSeq) {
+                if (m_reorderBuf.size() < kMaxReorderFrames) {
+                    break;
+                }
+                m_expectedSeq = it.key();
+            }
+            if (it.value().comfortNoise) {
+                m_jitter.pushComfortNoise(m_expectedSeq, it.value().data);
+            } else {
+                m_jitter.push(m_expectedSeq, it.value().data);
+                emit audioFrameReceived();
             }
+            m_reorderBuf.erase(it);
+            ++m_expectedSeq;
+        }
+    }
+
+    if (m_versionedPackets && !remoteIp.isEmpty() && remotePort != 0) {
+        if (!m_lossReportTimer.isValid()) {
+            m_lossReportTimer.start();
+        } else if (m_lossReportTimer.hasExpired(Config::AUDIO_LOSS_REPORT_INTERVAL_MS)) {
+            sendLossReport();
+            m_lossReportTimer.restart();
         }
     }
 }
 
-void AudioTransport::onSendTimer()
+void AudioTransportWorker::captureFrames()
 {
-    if (!audio || remoteIp.isEmpty() || remotePort == 0 || muted) {
+    if (!audio || (!m_captureOnly && (remoteIp.isEmpty() || remotePort == 0))) {
         return;
     }
 
-    const QByteArray data = audio->readCapturedAudio();
-    if (data.isEmpty()) {
+    // The device returns whatever the OS buffered since the last tick, so
+    // a tick may complete zero, one or several 20 ms frames.
+    qint64 read = 0;
+    do {
+        read = audio->readCapturedAudio(m_captureBuffer.data(), m_captureBuffer.size());
+        m_framer.push(m_captureBuffer.constData(), int(read));
+    } while (read == m_captureBuffer.size());
+
+    if (m_captureOnly) {
+        QByteArray frame;
+        quint32 timestamp = 0;
+        while (m_framer.pop(frame, timestamp)) {
+            if (!muted) {
+                emit localFrameCaptured(frame, timestamp);
+            }
+        }
         return;
     }
 
-    QByteArray packet;
-    packet.resize(int(sizeof(uint32_t)));
-    qToBigEndian<uint32_t>(++m_sendSeq, reinterpret_cast<uchar *>(packet.data()));
-    packet.append(data);
+    bool queued = false;
+    while (m_framer.bufferedSamples() >= m_framer.frameSamples()) {
+        quint32 timestamp = 0;
+        SendFrame *slot = muted ? nullptr : m_sendRing.beginWrite();
+        if (!slot) {
+            // While muted the capture is drained and discarded so the
+            // sample clock keeps running and no stale audio is sent on
+            // unmute. A full ring means the send thread is stalled; the
+            // frame is dropped rather than blocking capture.
+            m_framer.pop(m_discardFrame.data(), timestamp);
+            if (!muted) {
+                ++m_sendOverruns;
+            }
+            continue;
+        }
+        m_framer.pop(slot->samples, timestamp);
+        slot->comfortNoise = false;
+        // The voice flag travels in the versioned header; legacy packets
+        // have nowhere to put it.
+        slot->voice = m_versionedPackets && m_vad.process(slot->samples, Config::AUDIO_FRAME_SAMPLES);
+        if (m_versionedPackets && Config::AUDIO_DTX_ENABLED && !slot->voice) {
+            if (m_sidCountdown > 0) {
+                // Silence: the slot is left uncommitted and reused. The
+                // sequence number does not advance, so the receiver sees
+                // a timestamp gap but no loss.
+                --m_sidCountdown;
+                ++m_dtxFrames;
+                continue;
+            }
+            slot->comfortNoise = true;
+            m_sidCountdown = kSidIntervalFrames - 1;
+        } else {
+            // Describe the noise as soon as the talkspurt ends.
+            m_sidCountdown = 0;
+        }
+        slot->seq = ++m_sendSeq;
+        slot->timestamp = timestamp;
+        slot->session = m_sendSession;
+        m_sendRing.commitWrite();
+        queued = true;
+    }
 
-    // Offload the actual UDP send to the dedicated audio send thread.
-    emit audioFrameCaptured(packet, remoteIp, remotePort);
+    if (queued) {
+        sendThread->wake();
+    }
 }
 
-void AudioTransport::onJitterTimer()
+AudioTransport::AudioTransport(AudioEngine *engine, QObject *parent)
+    : QObject(parent)
+    , worker(new AudioTransportWorker(engine))
 {
-    if (!audio) {
-        return;
-    }
+    // Re-emitted straight from the audio thread; receivers elsewhere get
+    // them queued as usual.
+    connect(worker,
+            &AudioTransportWorker::localFrameCaptured,
+            this,
+            &AudioTransport::localFrameCaptured,
+            Qt::DirectConnection);
+    connect(worker,
+            &AudioTransportWorker::audioFrameReceived,
+            this,
+            &AudioTransport::audioFrameReceived,
+            Qt::DirectConnection);
+
+    worker->moveToThread(engine->audioThread());
+    QMetaObject::invokeMethod(worker, &AudioTransportWorker::begin, Qt::QueuedConnection);
+}
 
-    static uint32_t lastPlayedSeq = 0;
-    bool plcApplied = false;
+AudioTransport::~AudioTransport()
+{
+    Command command;
+    command.type = Command::Type::Shutdown;
+    command.reply = true;
+    post(command);
+    // Deleted on the audio thread, which owns its sockets and timer.
+    worker->deleteLater();
+}
 
-    if (m_jitterQueue.isEmpty()) {
-        lastPlayedSeq = 0;
-        return;
+bool AudioTransport::post(const Command &command)
+{
+    if (!worker->commands.push(command)) {
+        LOG_WARN(QStringLiteral("AudioTransport: audio thread is not taking commands, dropped command %1")
+                     .arg(int(command.type)));
+        return false;
     }
-
-    if (m_jitterQueue.size() > m_jitterMax + 2) {
-        m_jitterQueue.dequeue();
+    if (!command.reply) {
+        return true;
     }
+    worker->replies.acquire();
+    return worker->replyResult.load();
+}
 
-    if (m_jitterQueue.size() < m_jitterTarget) {
-        return;
-    }
+bool AudioTransport::startTransport(quint16 localPortValue,
+                                    const QString &remoteIpValue,
+                                    quint16 remotePortValue)
+{
+    Command command;
+    command.type = Command::Type::Start;
+    command.localPort = localPortValue;
+    command.remoteIp = remoteIpValue;
+    command.remotePort = remotePortValue;
+    command.reply = true;
+    return post(command);
+}
 
-    const JitterFrame frame = m_jitterQueue.dequeue();
+bool AudioTransport::startSendOnly(const QString &remoteIpValue, quint16 remotePortValue)
+{
+    Command command;
+    command.type = Command::Type::StartSendOnly;
+    command.remoteIp = remoteIpValue;
+    command.remotePort = remotePortValue;
+    command.reply = true;
+    return post(command);
+}
 
-    if (lastPlayedSeq != 0 && frame.seq > lastPlayedSeq + 1 && !m_lastPcm.isEmpty()) {
-        ++m_lossEvents;
-        const QByteArray plc = generatePLC(m_lastPcm);
-        if (!plc.isEmpty()) {
-            audio->playAudio(plc);
-            plcApplied = true;
-            ++m_plcCount;
-        } else {
-            audio->playAudio(m_lastPcm);
-        }
-    }
+bool AudioTransport::startCaptureOnly()
+{
+    Command command;
+    command.type = Command::Type::StartCaptureOnly;
+    command.reply = true;
+    return post(command);
+}
 
-    audio->playAudio(frame.pcm);
-    lastPlayedSeq = frame.seq;
+void AudioTransport::stopTransport()
+{
+    Command command;
+    command.type = Command::Type::Stop;
+    command.reply = true;
+    post(command);
+}
 
-    if (!m_diagTimer.isValid()) {
-        m_diagTimer.start();
-    }
-    if (m_diagTimer.hasExpired(12000)) {
-        qint64 jitterSpread = 0;
-        if (!m_interArrivalTimes.isEmpty()) {
-            qint64 minIa = std::numeric_limits<qint64>::max();
-            qint64 maxIa = 0;
-            for (qint64 ia : std::as_const(m_interArrivalTimes)) {
-                minIa = std::min(minIa, ia);
-                maxIa = std::max(maxIa, ia);
-            }
-            if (maxIa > minIa) {
-                jitterSpread = maxIa - minIa;
-            }
-        }
-        LOG_INFO(QStringLiteral("AudioNet jitter: q=%1 target=%2 reorder=%3 plcApplied=%4 iaJitter=%5ms")
-                     .arg(m_jitterQueue.size())
-                     .arg(m_jitterTarget)
-                     .arg(m_reorderBuf.size())
-                     .arg(plcApplied)
-                     .arg(jitterSpread));
-        logDiagnostics();
-        m_diagTimer.restart();
-    }
+void AudioTransport::setMuted(bool muted)
+{
+    Command command;
+    command.type = Command::Type::SetMuted;
+    command.muted = muted;
+    post(command);
+    LOG_INFO(QStringLiteral("AudioTransport: mute state changed to %1")
+                 .arg(muted ? QStringLiteral("ON") : QStringLiteral("OFF")));
+}
+
+void AudioTransport::setCodec(AudioCodec::Type type, int bitrate)
+{
+    Command command;
+    command.type = Command::Type::SetCodec;
+    command.codecType = int(type);
+    command.bitrate = bitrate > 0 ? bitrate : Config::AUDIO_CODEC_BITRATE;
+    post(command);
+    LOG_INFO(QStringLiteral("AudioTransport: sending %1 at %2 bit/s")
+                 .arg(AudioCodec::name(type))
+                 .arg(command.bitrate));
+}
+
+void AudioTransport::resetCodec()
+{
+    Command command;
+    command.type = Command::Type::ResetCodec;
+    post(command);
+}
+
+AudioTransport::Stats AudioTransport::stats() const
+{
+    return worker->stats.read();
+}
+
+void AudioTransport::logDiagnostics() const
+{
+    const Stats s = stats();
+    LOG_INFO(QStringLiteral("AudioNet diag: jitterQ=%1 target=%2 reorderBuf=%3 plcCount=%4 lossEvents=%5 delayP95=%6ms "
+                            "rtpJitter=%7ms captureDropped=%8 sendOverruns=%9 playbackOverflows=%10 "
+                            "underruns=%11 trimmed=%12 accelerate=%13 expand=%14 dtxSkipped=%15 comfortNoise=%16 "
+                            "redDepth=%17 recovered=%18 drift=%19ppm")
+                 .arg(s.jitterDepth)
+                 .arg(s.targetFrames)
+                 .arg(s.reorderFrames)
+                 .arg(static_cast<qulonglong>(s.plcFrames))
+                 .arg(static_cast<qulonglong>(s.lossEvents))
+                 .arg(s.delayP95Ms, 0, 'f', 1)
+                 .arg(s.transitJitterMs, 0, 'f', 1)
+                 .arg(static_cast<qulonglong>(s.captureDropped))
+                 .arg(static_cast<qulonglong>(s.sendOverruns))
+                 .arg(static_cast<qulonglong>(s.playbackOverflows))
+                 .arg(static_cast<qulonglong>(s.underruns))
+                 .arg(static_cast<qulonglong>(s.trimmed))
+                 .arg(static_cast<qulonglong>(s.accelerate))
+                 .arg(static_cast<qulonglong>(s.expand))
+                 .arg(static_cast<qulonglong>(s.dtxSkipped))
+                 .arg(static_cast<qulonglong>(s.comfortNoise))
+                 .arg(s.redundancyDepth)
+                 .arg(static_cast<qulonglong>(s.recovered))
+                 .arg(s.driftPpm, 0, 'f', 1));
 }
 
 #include "AudioTransport.moc"
@@ -2,89 +2,90 @@
 #define AUDIOTRANSPORT_H
 
 #include <QObject>
-#include <QUdpSocket>
-#include <QQueue>
-#include <QMap>
-#include <QVector>
-#include <QTimer>
+#include <QByteArray>
 #include <QString>
-#include <QThread>
-#include <QElapsedTimer>
-#include <cstdint>
+
+#include "audio/AudioCodec.h"
 
 class AudioEngine;
-class AudioSendWorker;
+class AudioTransportWorker;
 
+// Guest audio: local capture out to the host, the host's mix back in.
+//
+// Everything on the audio path (capture framing, DTX, the receive socket,
+// reordering, decoding and the jitter buffer) lives in a worker on the
+// engine's audio thread, next to the devices it feeds and drains. This
+// object is the GUI-side handle: calls become commands in a lock-free
+// ring that the worker drains on every frame tick, and diagnostics come
+// from snapshots it publishes, so no GUI work can delay a frame.
 class AudioTransport : public QObject
 {
     Q_OBJECT
 
-    struct JitterFrame
+public:
+    // Diagnostics, as last published by the audio thread.
+    struct Stats
     {
-        QByteArray pcm;
-        uint32_t seq;
+        int jitterDepth = 0;
+        int targetFrames = 0;
+        int reorderFrames = 0;
+        quint64 plcFrames = 0;
+        quint64 lossEvents = 0;
+        double delayP95Ms = 0.0;
+        double transitJitterMs = 0.0;
+        quint64 captureDropped = 0;
+        quint64 sendOverruns = 0;
+        quint64 playbackOverflows = 0;
+        quint64 underruns = 0;
+        quint64 trimmed = 0;
+        quint64 accelerate = 0;
+        quint64 expand = 0;
+        quint64 dtxSkipped = 0;
+        quint64 comfortNoise = 0;
+        int redundancyDepth = 0;
+        quint64 recovered = 0;
+        double driftPpm = 0.0;
     };
 
-public:
     explicit AudioTransport(AudioEngine *engine, QObject *parent = nullptr);
     ~AudioTransport();
 
+    // The start and stop calls wait for the audio thread to carry them out
+    // (at most a frame tick), as they report whether the socket was bound.
     bool startTransport(quint16 localPort, const QString &remoteIp, quint16 remotePort);
     // Send-only mode: only transmit local audio to the given
     // remote endpoint without binding a local receive port.
     bool startSendOnly(const QString &remoteIp, quint16 remotePort);
+    // Capture-only mode: frame local audio and hand it out through
+    // localFrameCaptured() instead of sending it (used by the host,
+    // whose microphone feeds the conference mixer).
+    bool startCaptureOnly();
     void stopTransport();
     void setMuted(bool muted);
+    // Switch the send path to the versioned packet format with the given
+    // codec (as negotiated over the control channel). Until this is called,
+    // or after resetCodec(), audio is sent in the legacy raw-PCM format so
+    // that older peers keep working.
+    void setCodec(AudioCodec::Type type, int bitrate);
+    void resetCodec();
+    Stats stats() const;
     void logDiagnostics() const;
 
-private slots:
-    void onReadyRead();
-    void onSendTimer();
-    void onJitterTimer();
-
-    QByteArray generatePLC(const QByteArray &lastFrame) const;
-
 signals:
-    // Emitted on the main/GUI thread whenever a new chunk
-    // of captured audio should be sent over UDP. The actual
-    // network I/O is performed on a dedicated worker thread
-    // to avoid being blocked by heavy screen sharing or video.
-    void audioFrameCaptured(const QByteArray &data,
-                            const QString &remoteIp,
-                            quint16 remotePort);
+    // Both are emitted on the audio thread.
+    // Emitted per 20 ms frame in capture-only mode.
+    void localFrameCaptured(const QByteArray &pcm, quint32 timestamp);
 
     // Emitted on the receive side whenever a remote audio
     // packet is successfully read and queued for playback.
     void audioFrameReceived();
 
 private:
-    QUdpSocket *udpRecvSocket;
-    quint16 localPort;
-    QString remoteIp;
-    quint16 remotePort;
-    AudioEngine *audio;
-    QTimer *sendTimer;
-    bool muted;
-    QQueue<JitterFrame> m_jitterQueue;
-    uint32_t m_lastSeq = 0;
-    uint32_t m_sendSeq = 0;
-    uint32_t m_expectedSeq = 1;
-    QMap<uint32_t, QByteArray> m_reorderBuf;
-    int m_jitterMin = 2;
-    int m_jitterMax = 8;
-    int m_jitterTarget = 3;
-    QVector<qint64> m_interArrivalTimes;
-    QElapsedTimer m_arrivalTimer;
-    mutable QElapsedTimer m_diagTimer;
-    uint64_t m_plcCount = 0;
-    uint64_t m_lossEvents = 0;
-    QByteArray m_lastPcm;
-    QTimer *m_jitterTimer = nullptr;
+    friend class AudioTransportWorker;
+    struct Command;
+    bool post(const Command &command);
 
-    // Dedicated worker thread and helper object that own
-    // the UDP send socket for audio frames.
-    QThread sendThread;
-    AudioSendWorker *sendWorker;
+    AudioTransportWorker *worker;
 };
 
 #endif // AUDIOTRANSPORT_H
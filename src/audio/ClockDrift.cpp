@@ -0,0 +1,202 @@
+#include "ClockDrift.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "AudioDsp.h"
+
+namespace ClockDrift {
+
+namespace {
+constexpr qint64 kBlockSamples = Config::AUDIO_SAMPLE_RATE;
+// A segment is folded into the pooled fit after this many blocks, and
+// the pool then decays by kPoolDecay.
+constexpr int kSegmentBlocks = 60;
+constexpr double kPoolDecay = 0.75;
+// Spread of block times (s^2) needed before the slope is trusted; about
+// 20 s of continuous playout.
+constexpr double kMinSxx = 20.0 * 20.0 * 20.0 / 12.0;
+
+constexpr double kPi = 3.14159265358979323846;
+// Half-band cutoff: zeros of the sinc fall on whole samples, so phase 0
+// is a pure delay. Ratios this close to 1 need no anti-aliasing margin.
+constexpr double kCutoff = 0.5;
+constexpr double kKaiserBeta = 6.0;
+
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+} // namespace
+
+Estimator::Estimator()
+{
+    reset();
+}
+
+void Estimator::reset()
+{
+    blockOpen = false;
+    blockStart = 0;
+    blockMaxLead = 0;
+    segment = Fit();
+    pooledSxx = 0.0;
+    pooledSxy = 0.0;
+    valid = false;
+    driftPpm = 0.0;
+}
+
+void Estimator::startSegment()
+{
+    // The half-finished block straddles the step and is dropped.
+    blockOpen = false;
+    foldSegment();
+}
+
+void Estimator::addPacket(qint64 senderTimestamp, qint64 playoutPosition)
+{
+    const qint64 lead = senderTimestamp - playoutPosition;
+    if (blockOpen && playoutPosition - blockStart >= kBlockSamples) {
+        closeBlock();
+    }
+    if (!blockOpen) {
+        blockOpen = true;
+        blockStart = playoutPosition;
+        blockMaxLead = lead;
+        return;
+    }
+    blockMaxLead = qMax(blockMaxLead, lead);
+}
+
+void Estimator::closeBlock()
+{
+    blockOpen = false;
+    // Welford update with x in seconds of playout and y in samples.
+    const double x = double(blockStart) / Config::AUDIO_SAMPLE_RATE;
+    const double y = double(blockMaxLead);
+    ++segment.n;
+    const double dx = x - segment.meanX;
+    segment.meanX += dx / segment.n;
+    segment.meanY += (y - segment.meanY) / segment.n;
+    segment.sxx += dx * (x - segment.meanX);
+    segment.sxy += dx * (y - segment.meanY);
+
+    if (segment.n >= kSegmentBlocks) {
+        foldSegment();
+    }
+    updateEstimate();
+}
+
+void Estimator::foldSegment()
+{
+    if (segment.n >= 2) {
+        pooledSxx = pooledSxx * kPoolDecay + segment.sxx;
+        pooledSxy = pooledSxy * kPoolDecay + segment.sxy;
+    }
+    segment = Fit();
+}
+
+void Estimator::updateEstimate()
+{
+    const double sxx = pooledSxx + segment.sxx;
+    if (sxx < kMinSxx) {
+        return;
+    }
+    // Slope in samples of lead per second, as a fraction of the rate.
+    const double ppm = (pooledSxy + segment.sxy) / sxx / Config::AUDIO_SAMPLE_RATE * 1e6;
+    driftPpm = qBound(-kMaxDriftPpm, ppm, kMaxDriftPpm);
+    valid = true;
+}
+
+Corrector::Corrector()
+{
+    // Phase p interpolates at p / kPhases of a sample past the centre
+    // tap, with each phase normalised to unity gain. Phase 0 is never
+    // used for filtering; whole-sample positions are copied exactly.
+    const double windowNorm = besselI0(kKaiserBeta);
+    const double half = kTaps / 2.0;
+    for (int phase = 0; phase < kPhases; ++phase) {
+        const double frac = double(phase) / kPhases;
+        double taps[kTaps];
+        double sum = 0.0;
+        for (int k = 0; k < kTaps; ++k) {
+            const double t = k - (kTaps / 2 - 1) - frac;
+            const double sinc = std::abs(t) < 1e-9 ? 2.0 * kCutoff
+                                                   : std::sin(2.0 * kPi * kCutoff * t) / (kPi * t);
+            const double r = t / half;
+            taps[k] = sinc * besselI0(kKaiserBeta * std::sqrt(qMax(0.0, 1.0 - r * r))) / windowNorm;
+            sum += taps[k];
+        }
+        qint16 *out = filters + phase * kTaps;
+        int total = 0;
+        int largest = 0;
+        for (int k = 0; k < kTaps; ++k) {
+            out[k] = qint16(qBound(-32767, int(std::lround(taps[k] / sum * 32768.0)), 32767));
+            total += out[k];
+            if (std::abs(out[k]) > std::abs(out[largest])) {
+                largest = k;
+            }
+        }
+        out[largest] = qint16(qBound(-32767, out[largest] + 32768 - total, 32767));
+    }
+    step = quint64(1) << 32;
+    reset();
+}
+
+void Corrector::reset()
+{
+    // Half a filter of silence so that the first input sample lines up
+    // with the centre tap.
+    memset(buffer, 0, sizeof(buffer));
+    buffered = kTaps / 2 - 1;
+    position = 0;
+}
+
+void Corrector::setRatio(double ratio)
+{
+    step = quint64(std::llround(qBound(0.99, ratio, 1.01) * 4294967296.0));
+}
+
+int Corrector::process(const qint16 *in, int count, qint16 *out, int maxOut, int &consumed)
+{
+    consumed = 0;
+    int produced = 0;
+    while (produced < maxOut) {
+        const int index = int(position >> 32);
+        const int needed = index + kTaps;
+        if (needed > buffered) {
+            const int take = qMin(needed - buffered, count - consumed);
+            memcpy(buffer + buffered, in + consumed, size_t(take) * sizeof(qint16));
+            buffered += take;
+            consumed += take;
+            if (buffered < needed) {
+                break;
+            }
+        }
+        const int phase = int(((position & 0xFFFFFFFFu) * kPhases) >> 32);
+        if (phase == 0) {
+            out[produced++] = buffer[index + kTaps / 2 - 1];
+        } else {
+            const qint32 acc = AudioDsp::dotProduct(buffer + index, filters + phase * kTaps, kTaps);
+            out[produced++] = qint16(qBound(-32768, (acc + (1 << 14)) >> 15, 32767));
+        }
+        position += step;
+    }
+
+    const int drop = qMin(int(position >> 32), buffered);
+    memmove(buffer, buffer + drop, size_t(buffered - drop) * sizeof(qint16));
+    buffered -= drop;
+    position -= quint64(drop) << 32;
+    return produced;
+}
+
+} // namespace ClockDrift
@@ -0,0 +1,98 @@
+#ifndef CLOCKDRIFT_H
+#define CLOCKDRIFT_H
+
+#include <QtGlobal>
+
+#include "common/Config.h"
+
+// Clock drift between a remote capture device and the local playback
+// device, and continuous correction of it.
+//
+// No two sound cards run at exactly the same rate; tens of ppm are
+// normal. Left alone, the receive buffer slowly fills or drains, and the
+// jitter buffer can only correct that in audible steps. The estimator
+// measures the drift from sender timestamps against the local playout
+// position, and the corrector resamples playout by the matching tiny
+// ratio so that latency stays constant for the whole meeting.
+namespace ClockDrift {
+
+// Beyond this the clocks are not drifting, something else is wrong.
+constexpr double kMaxDriftPpm = 500.0;
+
+// Receive side. Each packet adds the sender timestamp it carries and the
+// local playout position at the moment it arrived; the difference (how
+// far the sender is ahead of playout) grows or shrinks at the drift rate.
+// Only the fastest packet of each second is used, so network jitter does
+// not show up as drift. Fitting is done per segment, so a playout restart
+// (which moves the difference in one step) does not disturb it.
+class Estimator
+{
+public:
+    Estimator();
+
+    void reset();
+    // The offset between the two clocks changed in one step.
+    void startSegment();
+    void addPacket(qint64 senderTimestamp, qint64 playoutPosition);
+
+    bool isValid() const { return valid; }
+    // Positive when the sender's clock is faster than playout.
+    double ppm() const { return driftPpm; }
+
+private:
+    struct Fit
+    {
+        int n = 0;
+        double meanX = 0.0;
+        double meanY = 0.0;
+        double sxx = 0.0;
+        double sxy = 0.0;
+    };
+
+    void closeBlock();
+    void foldSegment();
+    void updateEstimate();
+
+    bool blockOpen;
+    qint64 blockStart;
+    qint64 blockMaxLead;
+    Fit segment;
+    // Earlier segments, decayed so that the estimate follows temperature
+    // changes over tens of minutes.
+    double pooledSxx;
+    double pooledSxy;
+    bool valid;
+    double driftPpm;
+};
+
+// Playback side: variable-ratio interpolation through a windowed-sinc
+// filter bank, for ratios within a fraction of a percent of 1. At ratio 1
+// it passes audio through unchanged.
+class Corrector
+{
+public:
+    static constexpr int kTaps = 16;
+    static constexpr int kPhases = 256;
+
+    Corrector();
+
+    void reset();
+    // Input samples consumed per output sample.
+    void setRatio(double ratio);
+
+    // Produces up to maxOut samples from in, taking only as much input as
+    // they need. consumed is set to the input samples taken.
+    int process(const qint16 *in, int count, qint16 *out, int maxOut, int &consumed);
+
+private:
+    qint16 filters[kPhases * kTaps];
+    qint16 buffer[kTaps + Config::AUDIO_FRAME_SAMPLES * 2];
+    int buffered;
+    // Read position in buffer, 32.32 fixed point.
+    quint64 position;
+    quint64 step;
+};
+
+} // namespace ClockDrift
+
+#endif // CLOCKDRIFT_H
@@ -0,0 +1,155 @@
+#include "ComfortNoise.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace ComfortNoise {
+
+namespace {
+constexpr double kFullScale = 32768.0;
+// Keeps the synthesis filter comfortably stable after quantisation.
+constexpr double kMaxReflection = 0.99;
+// A uniform variable on [-1, 1) has variance 1/3.
+const double kUniformToUnitVariance = std::sqrt(3.0);
+
+double clampReflection(double k)
+{
+    return qBound(-kMaxReflection, k, kMaxReflection);
+}
+} // namespace
+
+Parameters analyze(const qint16 *samples, int count)
+{
+    Parameters params;
+    if (count <= kOrder) {
+        return params;
+    }
+
+    double r[kOrder + 1];
+    for (int lag = 0; lag <= kOrder; ++lag) {
+        double sum = 0.0;
+        for (int i = lag; i < count; ++i) {
+            sum += double(samples[i]) * samples[i - lag];
+        }
+        r[lag] = sum;
+    }
+    if (r[0] <= 0.0) {
+        return params;
+    }
+
+    const double dbov = 10.0 * std::log10(r[0] / count / (kFullScale * kFullScale));
+    params.level = quint8(qBound(0, int(std::lround(-dbov)), int(kSilentLevel)));
+
+    // Levinson-Durbin recursion. A touch of white-noise correction keeps
+    // it well conditioned on very tonal noise.
+    r[0] *= 1.0 + 1e-4;
+    double a[kOrder] = {};
+    double error = r[0];
+    for (int i = 0; i < kOrder; ++i) {
+        double acc = r[i + 1];
+        for (int j = 0; j < i; ++j) {
+            acc -= a[j] * r[i - j];
+        }
+        const double k = clampReflection(error > 0.0 ? acc / error : 0.0);
+        params.reflection[i] = k;
+
+        double next[kOrder];
+        memcpy(next, a, sizeof(a));
+        for (int j = 0; j < i; ++j) {
+            next[j] = a[j] - k * a[i - 1 - j];
+        }
+        next[i] = k;
+        memcpy(a, next, sizeof(a));
+        error *= 1.0 - k * k;
+    }
+    return params;
+}
+
+int encode(const Parameters &params, uchar *out)
+{
+    out[0] = qMin(params.level, kSilentLevel);
+    for (int i = 0; i < kOrder; ++i) {
+        const double q = (qBound(-1.0, params.reflection[i], 1.0) + 1.0) * 127.5;
+        out[1 + i] = uchar(qBound(0, int(std::lround(q)), 255));
+    }
+    return kPayloadBytes;
+}
+
+bool decode(const uchar *payload, int size, Parameters &outParams)
+{
+    if (size < 1) {
+        return false;
+    }
+    // Senders may describe the spectrum with fewer coefficients (or none,
+    // for white noise); the rest stay zero.
+    outParams = Parameters();
+    outParams.level = payload[0] & 0x7F;
+    const int coefficients = qMin(size - 1, kOrder);
+    for (int i = 0; i < coefficients; ++i) {
+        outParams.reflection[i] = clampReflection(payload[1 + i] / 127.5 - 1.0);
+    }
+    return true;
+}
+
+Generator::Generator()
+{
+    reset();
+}
+
+void Generator::reset()
+{
+    memset(lpc, 0, sizeof(lpc));
+    memset(history, 0, sizeof(history));
+    gain = 0.0;
+    targetGain = 0.0;
+    seed = 0x2545F491u;
+}
+
+void Generator::setParameters(const Parameters &params)
+{
+    // Step-up recursion from reflection to direct-form coefficients; the
+    // product of (1 - k^2) is the filter's prediction gain, which the
+    // excitation level has to compensate for.
+    double a[kOrder] = {};
+    double residual = 1.0;
+    for (int i = 0; i < kOrder; ++i) {
+        const double k = clampReflection(params.reflection[i]);
+        double next[kOrder];
+        memcpy(next, a, sizeof(a));
+        for (int j = 0; j < i; ++j) {
+            next[j] = a[j] - k * a[i - 1 - j];
+        }
+        next[i] = k;
+        memcpy(a, next, sizeof(a));
+        residual *= 1.0 - k * k;
+    }
+    memcpy(lpc, a, sizeof(lpc));
+
+    if (params.level >= kSilentLevel) {
+        targetGain = 0.0;
+        return;
+    }
+    const double rms = kFullScale * std::pow(10.0, -params.level / 20.0);
+    targetGain = rms * std::sqrt(residual) * kUniformToUnitVariance;
+}
+
+void Generator::generate(qint16 *out, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const double excitation = qint32(seed) / 2147483648.0;
+        const double g = gain + (targetGain - gain) * (i + 1) / count;
+
+        double y = g * excitation;
+        for (int j = 0; j < kOrder; ++j) {
+            y += lpc[j] * history[j];
+        }
+        memmove(history + 1, history, sizeof(double) * (kOrder - 1));
+        history[0] = y;
+
+        out[i] = qint16(qBound(-32768L, std::lround(y), 32767L));
+    }
+    gain = targetGain;
+}
+
+} // namespace ComfortNoise
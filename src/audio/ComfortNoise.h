@@ -0,0 +1,59 @@
+#ifndef COMFORTNOISE_H
+#define COMFORTNOISE_H
+
+#include <QtGlobal>
+
+// Comfort noise for discontinuous transmission (DTX), after RFC 3389.
+//
+// While a sender is silent it stops sending audio frames and only sends
+// an occasional silence insertion descriptor (SID): the background noise
+// level plus the reflection coefficients of a low-order LPC fit to its
+// spectrum. The receiver shapes white noise with that filter, so silence
+// sounds like the sender's room instead of a dead line.
+//
+// SID payload: one level byte (noise level in -dBov, 0..127) followed by
+// kOrder coefficient bytes, each k quantised linearly from [-1, 1] to
+// [0, 255].
+namespace ComfortNoise {
+
+constexpr int kOrder = 6;
+constexpr int kPayloadBytes = 1 + kOrder;
+// Level byte that describes digital silence.
+constexpr quint8 kSilentLevel = 127;
+
+struct Parameters
+{
+    quint8 level = kSilentLevel;
+    double reflection[kOrder] = {};
+};
+
+// Describes a frame of background noise.
+Parameters analyze(const qint16 *samples, int count);
+
+// out needs room for kPayloadBytes; returns the payload size.
+int encode(const Parameters &params, uchar *out);
+bool decode(const uchar *payload, int size, Parameters &outParams);
+
+// Noise synthesis from received descriptors. Not thread-safe.
+class Generator
+{
+public:
+    Generator();
+
+    void reset();
+    void setParameters(const Parameters &params);
+    void generate(qint16 *out, int count);
+
+private:
+    double lpc[kOrder];
+    double history[kOrder];
+    // Excitation gain; ramps towards targetGain over one generated block
+    // so level updates do not click.
+    double gain;
+    double targetGain;
+    quint32 seed;
+};
+
+} // namespace ComfortNoise
+
+#endif // COMFORTNOISE_H
@@ -0,0 +1,361 @@
+#include "JitterBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+#include "TimeStretch.h"
+
+namespace {
+constexpr int kFrame = Config::AUDIO_FRAME_SAMPLES;
+// Decoded audio kept ahead of playout: a frame plus the drift
+// corrector's filter.
+constexpr int kWanted = kFrame + ClockDrift::Corrector::kTaps;
+// Delay statistics cover the last ~5 s of packets.
+constexpr int kDelayWindow = 250;
+constexpr int kMinTargetFrames = 1;
+constexpr int kMaxTargetFrames = 10;
+// Beyond this many frames over the target (e.g. after the device stalled)
+// time stretching would take too long to catch up, so frames are dropped.
+constexpr int kHardTrimFrames = 6;
+// Smoothing of the playback-side buffer level (per pulled frame).
+constexpr double kLevelSmoothing = 1.0 / 8.0;
+// Longer sequence gaps (sender restart, long outage) are not concealed
+// frame by frame; playback just resumes at the new position.
+constexpr int kMaxConcealedGap = 25;
+// Pulls concealed while the buffer is empty before playback stops and
+// waits for a fresh prefill. Concealment is silent after 60 ms anyway.
+constexpr int kMaxDryConcealFrames = 3;
+// A sender in DTX refreshes its comfort noise regularly. After three
+// missed refreshes it is presumed gone and playout treats the empty
+// buffer as usual.
+constexpr int kMaxComfortNoiseFrames = 3 * Config::AUDIO_DTX_SID_INTERVAL_MS / Config::AUDIO_FRAME_MS;
+// Published while nothing is playing.
+constexpr qint64 kNoPlayout = std::numeric_limits<qint64>::min();
+// Smoothing of the published playout origin (per pulled frame). The
+// device takes audio in bursts; this averages them out.
+constexpr double kOriginSmoothing = 1.0 / 64.0;
+// Besides the drift, playout leans gently towards the target level: one
+// frame off target shifts the ratio by this much, up to kMaxLevelPpm.
+constexpr double kLevelPpmPerFrame = 50.0;
+constexpr double kMaxLevelPpm = 200.0;
+}
+
+JitterBuffer::JitterBuffer(int capacityFrames)
+    : ring(capacityFrames)
+    , playoutOriginNs(kNoPlayout)
+    , transits(kDelayWindow, 0)
+    , delayScratch(kDelayWindow, 0)
+{
+    playoutClock.start();
+}
+
+void JitterBuffer::notePacketArrival(quint32 timestamp)
+{
+    if (!arrivalClock.isValid()) {
+        arrivalClock.start();
+    }
+    const qint64 arrival = arrivalClock.nsecsElapsed() * (Config::AUDIO_SAMPLE_RATE / 1000) / 1000000;
+
+    // Unwrap the 32-bit sample clock; reordered packets step backwards.
+    if (!haveTimestamp) {
+        extendedTimestamp = timestamp;
+        haveTimestamp = true;
+    } else {
+        extendedTimestamp += qint32(timestamp - lastTimestamp);
+    }
+    lastTimestamp = timestamp;
+
+    transits[transitPos] = arrival - extendedTimestamp;
+    transitPos = (transitPos + 1) % kDelayWindow;
+    transitCount = qMin(transitCount + 1, kDelayWindow);
+
+    // Delay of each packet relative to the fastest one in the window; the
+    // sender and receiver clocks share no origin, so only differences
+    // count.
+    const qint64 fastest = *std::min_element(transits.constBegin(), transits.constBegin() + transitCount);
+    for (int i = 0; i < transitCount; ++i) {
+        delayScratch[i] = transits[i] - fastest;
+    }
+    const int rank = (transitCount * 95) / 100;
+    std::nth_element(delayScratch.begin(), delayScratch.begin() + rank, delayScratch.begin() + transitCount);
+    delayP95Samples = delayScratch[rank];
+
+    // A buffer one frame deeper than the delay percentile absorbs it.
+    const int frames = 1 + int(delayP95Samples / kFrame);
+    target.store(qBound(kMinTargetFrames, frames, kMaxTargetFrames), std::memory_order_relaxed);
+
+    // Drift: how far the sender is ahead of where playout is right now.
+    const quint32 epoch = playoutEpoch.load(std::memory_order_acquire);
+    if (epoch != driftEpoch) {
+        driftEpoch = epoch;
+        drift.startSegment();
+    }
+    const qint64 origin = playoutOriginNs.load(std::memory_order_acquire);
+    if (origin != kNoPlayout) {
+        const qint64 position =
+            (playoutClock.nsecsElapsed() - origin) * (Config::AUDIO_SAMPLE_RATE / 1000) / 1000000;
+        drift.addPacket(extendedTimestamp, position);
+        if (drift.isValid()) {
+            driftEstimatePpm.store(drift.ppm(), std::memory_order_relaxed);
+        }
+    }
+}
+
+bool JitterBuffer::push(quint32 seq, const QByteArray &pcm)
+{
+    // Every sender frames audio into 20 ms packets; anything longer is cut
+    // to one frame.
+    const int samples = qMin(int(pcm.size() / int(sizeof(qint16))), kFrame);
+    if (samples <= 0) {
+        return false;
+    }
+
+    Slot *slot = ring.beginWrite();
+    if (!slot) {
+        trimmedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    memcpy(slot->samples, pcm.constData(), size_t(samples) * sizeof(qint16));
+    slot->count = samples;
+    slot->seq = seq;
+    slot->generation = generation.load(std::memory_order_relaxed);
+    slot->comfortNoise = false;
+    ring.commitWrite();
+    return true;
+}
+
+bool JitterBuffer::pushComfortNoise(quint32 seq, const QByteArray &descriptor)
+{
+    ComfortNoise::Parameters noise;
+    if (!ComfortNoise::decode(reinterpret_cast<const uchar *>(descriptor.constData()), int(descriptor.size()), noise)) {
+        return false;
+    }
+
+    Slot *slot = ring.beginWrite();
+    if (!slot) {
+        trimmedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    slot->count = 0;
+    slot->seq = seq;
+    slot->generation = generation.load(std::memory_order_relaxed);
+    slot->comfortNoise = true;
+    slot->noise = noise;
+    ring.commitWrite();
+    return true;
+}
+
+void JitterBuffer::reset()
+{
+    haveTimestamp = false;
+    transitPos = 0;
+    transitCount = 0;
+    delayP95Samples = 0;
+    arrivalClock.invalidate();
+    drift.reset();
+    driftEstimatePpm.store(0.0, std::memory_order_relaxed);
+    target.store(2, std::memory_order_relaxed);
+
+    plcFrames.store(0, std::memory_order_relaxed);
+    lossEventCount.store(0, std::memory_order_relaxed);
+    underrunCount.store(0, std::memory_order_relaxed);
+    trimmedCount.store(0, std::memory_order_relaxed);
+    accelerateOps.store(0, std::memory_order_relaxed);
+    expandOps.store(0, std::memory_order_relaxed);
+    comfortNoiseCount.store(0, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+bool JitterBuffer::appendNextFrame()
+{
+    Slot *slot = ring.front();
+    if (!slot) {
+        return false;
+    }
+
+    qint16 *dst = pending + pendingCount;
+    qint32 gap = havePlayed ? qint32(slot->seq - lastPlayedSeq) - 1 : 0;
+    if (gap > kMaxConcealedGap) {
+        lossEventCount.fetch_add(1, std::memory_order_relaxed);
+        lastPlayedSeq = slot->seq - 1;
+        gap = 0;
+    }
+
+    if (gap > 0) {
+        // Missing frame: conceal it and keep the real one for the next
+        // call, one concealed frame per lost sequence number.
+        if (!plc.isConcealing()) {
+            lossEventCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        plc.conceal(dst, kFrame);
+        pendingCount += kFrame;
+        plcFrames.fetch_add(1, std::memory_order_relaxed);
+        ++lastPlayedSeq;
+        return true;
+    }
+
+    if (slot->comfortNoise) {
+        comfortNoise.setParameters(slot->noise);
+        inComfortNoise = true;
+        comfortNoiseSinceUpdate = 0;
+        appendComfortNoise();
+    } else {
+        const int count = slot->count;
+        memcpy(dst, slot->samples, size_t(count) * sizeof(qint16));
+        plc.processReceived(dst, count);
+        pendingCount += count;
+        inComfortNoise = false;
+    }
+    lastPlayedSeq = slot->seq;
+    havePlayed = true;
+    dryFrames = 0;
+    ring.popFront();
+    return true;
+}
+
+void JitterBuffer::appendComfortNoise()
+{
+    qint16 *dst = pending + pendingCount;
+    comfortNoise.generate(dst, kFrame);
+    // Keeps the concealer's history current, so a loss right at the start
+    // of the next talkspurt continues the noise rather than old speech.
+    plc.processReceived(dst, kFrame);
+    pendingCount += kFrame;
+    ++comfortNoiseSinceUpdate;
+    comfortNoiseCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+int JitterBuffer::pullFrame(qint16 *out)
+{
+    const quint32 currentGeneration = generation.load(std::memory_order_acquire);
+    if (currentGeneration != playGeneration) {
+        playGeneration = currentGeneration;
+        playing = false;
+        havePlayed = false;
+        dryFrames = 0;
+        pendingCount = 0;
+        plc.reset();
+        comfortNoise.reset();
+        inComfortNoise = false;
+        restartPlayout();
+    }
+
+    // Frames queued before the last reset().
+    while (Slot *stale = ring.front()) {
+        if (stale->generation == playGeneration) {
+            break;
+        }
+        ring.popFront();
+    }
+
+    const int targetFrames = target.load(std::memory_order_relaxed);
+    if (!playing) {
+        if (ring.size() < targetFrames) {
+            return 0;
+        }
+        playing = true;
+        filteredLevel = double(ring.size() * kFrame);
+        restartPlayout();
+    }
+
+    while (ring.size() > targetFrames + kHardTrimFrames) {
+        // Not a loss: skip the sequence number so no concealment follows.
+        lastPlayedSeq = ring.front()->seq;
+        ring.popFront();
+        trimmedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (pendingCount < kWanted) {
+        const int level = ring.size() * kFrame + pendingCount;
+        filteredLevel += (level - filteredLevel) * kLevelSmoothing;
+    }
+
+    if (comfortNoiseSinceUpdate >= kMaxComfortNoiseFrames) {
+        inComfortNoise = false;
+    }
+    const Slot *next = ring.front();
+    if (pendingCount < kWanted && inComfortNoise && !(next && next->comfortNoise) && ring.size() < targetFrames) {
+        // The sender is between talkspurts. Keep its background noise
+        // going, without stretching, until the next talkspurt has built
+        // up the cushion.
+        appendComfortNoise();
+    } else if (pendingCount < kWanted) {
+        if (!appendNextFrame() && pendingCount == 0) {
+            underrunCount.fetch_add(1, std::memory_order_relaxed);
+            if (!havePlayed || dryFrames >= kMaxDryConcealFrames) {
+                // Nothing for a while: rebuild the cushion before playing
+                // again. The concealer fades the restart back in.
+                playing = false;
+                dryFrames = 0;
+                playoutOriginNs.store(kNoPlayout, std::memory_order_release);
+                return 0;
+            }
+            // Late rather than lost, probably: bridge the gap without
+            // consuming a sequence number.
+            ++dryFrames;
+            plc.conceal(pending, kFrame);
+            pendingCount = kFrame;
+            plcFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const int threshold = targetFrames * kFrame;
+        if (filteredLevel > threshold + kFrame) {
+            // Running long: fetch a second frame and cut a pitch period
+            // out of the combined block.
+            appendNextFrame();
+            const int n = TimeStretch::accelerate(pending, pendingCount, stretched);
+            if (n > 0) {
+                filteredLevel -= pendingCount - n;
+                memcpy(pending, stretched, size_t(n) * sizeof(qint16));
+                pendingCount = n;
+                accelerateOps.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else if (filteredLevel < threshold - kFrame) {
+            // Running short: stretch what we have by a pitch period so the
+            // network gets more time to deliver the next frame.
+            const int n = TimeStretch::expand(pending, pendingCount, stretched, int(std::size(stretched)));
+            if (n > 0) {
+                filteredLevel += n - pendingCount;
+                memcpy(pending, stretched, size_t(n) * sizeof(qint16));
+                pendingCount = n;
+                expandOps.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Clock drift: consume input slightly faster or slower than real
+    // time, plus a gentle pull towards the target level.
+    const double levelPpm = qBound(-kMaxLevelPpm,
+                                   (filteredLevel - targetFrames * kFrame) / kFrame * kLevelPpmPerFrame,
+                                   kMaxLevelPpm);
+    corrector.setRatio(1.0 + (driftPpm() + levelPpm) * 1e-6);
+
+    int consumed = 0;
+    const int count = corrector.process(pending, pendingCount, out, kFrame, consumed);
+    pendingCount -= consumed;
+    memmove(pending, pending + consumed, size_t(pendingCount) * sizeof(qint16));
+    publishPlayoutPosition(count);
+    return count;
+}
+
+void JitterBuffer::restartPlayout()
+{
+    corrector.reset();
+    playedSamples = 0;
+    originNs = 0.0;
+    playoutOriginNs.store(kNoPlayout, std::memory_order_release);
+    playoutEpoch.fetch_add(1, std::memory_order_release);
+}
+
+void JitterBuffer::publishPlayoutPosition(int played)
+{
+    playedSamples += played;
+    const double origin = double(playoutClock.nsecsElapsed())
+                          - double(playedSamples) * 1e9 / Config::AUDIO_SAMPLE_RATE;
+    originNs = playoutOriginNs.load(std::memory_order_relaxed) == kNoPlayout
+                   ? origin
+                   : originNs + (origin - originNs) * kOriginSmoothing;
+    playoutOriginNs.store(qint64(originNs), std::memory_order_release);
+}
@@ -0,0 +1,145 @@
+#ifndef JITTERBUFFER_H
+#define JITTERBUFFER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+
+#include "audio/AudioEngine.h"
+#include "audio/ClockDrift.h"
+#include "audio/ComfortNoise.h"
+#include "audio/PacketLossConcealer.h"
+#include "common/Config.h"
+#include "common/SpscRing.h"
+
+// Adaptive playout buffer between the network receive path and the audio
+// device, modelled on WebRTC's NetEQ.
+//
+// The receive side reports every packet's sender timestamp. The target
+// depth follows the 95th percentile of packet delay relative to the
+// fastest recent packet, so it tracks the actual network jitter. The
+// playback side steers the buffered amount towards that target by time
+// stretching: it removes a pitch period (accelerate) when the buffer runs
+// long and inserts one (expand) when it runs short. Whole frames are
+// never dropped or repeated for this. Missing frames, and short gaps
+// where nothing has arrived in time, are filled by pitch-synchronous
+// concealment.
+//
+// Comfort-noise descriptors from a sender in DTX take their sequence
+// number in the ring like frames. From one of those until the next
+// talkspurt has filled the buffer to its target, playout generates
+// matching background noise; the empty buffer in between is expected and
+// neither concealed nor counted as an underrun.
+//
+// The sender's capture clock and the local playback clock never run at
+// quite the same rate. The receive side estimates the difference from
+// sender timestamps against the playout position the playback side
+// publishes, and playout is resampled by that ratio, so the buffer does
+// not slowly fill or drain over a long meeting. Time stretching is left
+// to absorb jitter.
+//
+// The two sides only share a lock-free ring and a few atomics, so
+// playout never waits on the receive thread.
+class JitterBuffer : public AudioPlaybackSource
+{
+public:
+    explicit JitterBuffer(int capacityFrames = 16);
+
+    // Receive side. notePacketArrival() is called for every packet as it
+    // arrives (in any order); push() for decoded frames in sequence order.
+    void notePacketArrival(quint32 timestamp);
+    bool push(quint32 seq, const QByteArray &pcm);
+    bool pushComfortNoise(quint32 seq, const QByteArray &descriptor);
+    // Drops everything queued; the playback side restarts with prefill.
+    void reset();
+
+    int depth() const { return ring.size(); }
+    int targetFrames() const { return target.load(std::memory_order_relaxed); }
+    double delayPercentileMs() const { return delayP95Samples / double(Config::AUDIO_SAMPLE_RATE / 1000); }
+    quint64 plcCount() const { return plcFrames.load(std::memory_order_relaxed); }
+    quint64 lossEvents() const { return lossEventCount.load(std::memory_order_relaxed); }
+    quint64 underruns() const { return underrunCount.load(std::memory_order_relaxed); }
+    quint64 trimmedFrames() const { return trimmedCount.load(std::memory_order_relaxed); }
+    quint64 accelerateCount() const { return accelerateOps.load(std::memory_order_relaxed); }
+    quint64 expandCount() const { return expandOps.load(std::memory_order_relaxed); }
+    quint64 comfortNoiseFrames() const { return comfortNoiseCount.load(std::memory_order_relaxed); }
+    // Estimated sender clock rate relative to playout; 0 until known.
+    double driftPpm() const { return driftEstimatePpm.load(std::memory_order_relaxed); }
+
+    // Playback side.
+    int pullFrame(qint16 *out) override;
+
+private:
+    struct Slot
+    {
+        qint16 samples[Config::AUDIO_FRAME_SAMPLES];
+        int count;
+        quint32 seq;
+        quint32 generation;
+        bool comfortNoise;
+        ComfortNoise::Parameters noise;
+    };
+
+    bool appendNextFrame();
+    void appendComfortNoise();
+    void restartPlayout();
+    void publishPlayoutPosition(int played);
+
+    SpscRing<Slot> ring;
+    std::atomic<quint32> generation{0};
+    std::atomic<int> target{2};
+    std::atomic<quint64> plcFrames{0};
+    std::atomic<quint64> lossEventCount{0};
+    std::atomic<quint64> underrunCount{0};
+    std::atomic<quint64> trimmedCount{0};
+    std::atomic<quint64> accelerateOps{0};
+    std::atomic<quint64> expandOps{0};
+    std::atomic<quint64> comfortNoiseCount{0};
+
+    // Playout position, published by the playback side as the time at
+    // which its first sample would have played (smoothed); the epoch
+    // changes whenever playout restarts.
+    QElapsedTimer playoutClock;
+    std::atomic<qint64> playoutOriginNs;
+    std::atomic<quint32> playoutEpoch{0};
+    std::atomic<double> driftEstimatePpm{0.0};
+
+    // Owned by the receive side: delay statistics over a sliding window.
+    QElapsedTimer arrivalClock;
+    bool haveTimestamp = false;
+    quint32 lastTimestamp = 0;
+    qint64 extendedTimestamp = 0;
+    QVector<qint64> transits;
+    QVector<qint64> delayScratch;
+    int transitPos = 0;
+    int transitCount = 0;
+    qint64 delayP95Samples = 0;
+    ClockDrift::Estimator drift;
+    quint32 driftEpoch = 0;
+
+    // Owned by the playback side.
+    quint32 playGeneration = 0;
+    bool playing = false;
+    quint32 lastPlayedSeq = 0;
+    bool havePlayed = false;
+    PacketLossConcealer plc;
+    ComfortNoise::Generator comfortNoise;
+    // Between talkspurts of a sender in DTX.
+    bool inComfortNoise = false;
+    int comfortNoiseSinceUpdate = 0;
+    // Consecutive pulls concealed because nothing had arrived yet.
+    int dryFrames = 0;
+    // Decoded audio waiting to be played, stretched in place.
+    qint16 pending[Config::AUDIO_FRAME_SAMPLES * 4];
+    qint16 stretched[Config::AUDIO_FRAME_SAMPLES * 4];
+    int pendingCount = 0;
+    // Smoothed buffer level in samples, as seen by the playback side.
+    double filteredLevel = 0.0;
+    ClockDrift::Corrector corrector;
+    qint64 playedSamples = 0;
+    double originNs = 0.0;
+};
+
+#endif // JITTERBUFFER_H
@@ -0,0 +1,420 @@
+#include "MeetingRecorder.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSemaphore>
+#include <QThread>
+#include <QtEndian>
+#include <cstring>
+
+#include "AudioCodec.h"
+#include "common/Logger.h"
+
+namespace {
+// Two seconds of frames; the writer normally drains every kPollMs.
+constexpr int kRingFrames = 2000 / Config::AUDIO_FRAME_MS;
+constexpr int kPollMs = 100;
+// Encoded output goes to disk in blocks of about this size.
+constexpr int kWriteBlockBytes = 64 * 1024;
+constexpr int kWavHeaderBytes = 44;
+
+// How frames become bytes. addFrame() appends to the output buffer;
+// flush() moves anything held back into it, and patch() fixes up what is
+// already on disk once the buffer has been written.
+class RecordingFormat
+{
+public:
+    virtual ~RecordingFormat() = default;
+
+    virtual void begin(QByteArray &out) = 0;
+    virtual void addFrame(const qint16 *samples, QByteArray &out) = 0;
+    virtual void flush(QByteArray &out, bool last) = 0;
+    virtual void patch(QFile &file) { Q_UNUSED(file); }
+};
+
+// Plain 16-bit PCM WAV. The header's sizes are rewritten at every
+// checkpoint.
+class WavFormat : public RecordingFormat
+{
+public:
+    void begin(QByteArray &out) override
+    {
+        dataBytes = 0;
+        const int offset = out.size();
+        out.resize(offset + kWavHeaderBytes);
+        writeHeader(reinterpret_cast<uchar *>(out.data() + offset));
+    }
+
+    void addFrame(const qint16 *samples, QByteArray &out) override
+    {
+        out.append(reinterpret_cast<const char *>(samples), Config::AUDIO_FRAME_BYTES);
+        dataBytes += Config::AUDIO_FRAME_BYTES;
+    }
+
+    void flush(QByteArray &out, bool last) override
+    {
+        Q_UNUSED(out);
+        Q_UNUSED(last);
+    }
+
+    void patch(QFile &file) override
+    {
+        uchar header[kWavHeaderBytes];
+        writeHeader(header);
+        const qint64 end = file.pos();
+        file.seek(0);
+        file.write(reinterpret_cast<const char *>(header), kWavHeaderBytes);
+        file.seek(end);
+    }
+
+private:
+    void writeHeader(uchar *out) const
+    {
+        memcpy(out, "RIFF", 4);
+        qToLittleEndian<quint32>(quint32(dataBytes + kWavHeaderBytes - 8), out + 4);
+        memcpy(out + 8, "WAVEfmt ", 8);
+        qToLittleEndian<quint32>(16, out + 16);
+        qToLittleEndian<quint16>(1, out + 20); // PCM
+        qToLittleEndian<quint16>(quint16(Config::AUDIO_CHANNELS), out + 22);
+        qToLittleEndian<quint32>(quint32(Config::AUDIO_SAMPLE_RATE), out + 24);
+        qToLittleEndian<quint32>(quint32(Config::AUDIO_SAMPLE_RATE * Config::AUDIO_CHANNELS * 2), out + 28);
+        qToLittleEndian<quint16>(quint16(Config::AUDIO_CHANNELS * 2), out + 32);
+        qToLittleEndian<quint16>(16, out + 34);
+        memcpy(out + 36, "data", 4);
+        qToLittleEndian<quint32>(quint32(dataBytes), out + 40);
+    }
+
+    qint64 dataBytes = 0;
+};
+
+#ifdef USE_OPUS
+// Opus in Ogg (RFC 7845). Pages are self-contained, so a file cut off
+// after any complete page plays up to that point.
+class OggOpusFormat : public RecordingFormat
+{
+public:
+    OggOpusFormat()
+        : encoder(AudioCodec::create(AudioCodec::Type::Opus, Config::RECORDING_OPUS_BITRATE))
+        , serial(QRandomGenerator::global()->generate())
+    {
+    }
+
+    ~OggOpusFormat() override { delete encoder; }
+
+    bool isValid() const { return encoder != nullptr; }
+
+    void begin(QByteArray &out) override
+    {
+        uchar head[19];
+        memcpy(head, "OpusHead", 8);
+        head[8] = 1;
+        head[9] = uchar(Config::AUDIO_CHANNELS);
+        qToLittleEndian<quint16>(kPreSkip, head + 10);
+        qToLittleEndian<quint32>(quint32(Config::AUDIO_SAMPLE_RATE), head + 12);
+        qToLittleEndian<qint16>(0, head + 16); // output gain
+        head[18] = 0;                            // mono/stereo mapping
+        addPacket(head, int(sizeof(head)));
+        emitPage(out, kBeginOfStream);
+
+        static const char vendor[] = "LanMeeting";
+        uchar tags[8 + 4 + sizeof(vendor) - 1 + 4];
+        memcpy(tags, "OpusTags", 8);
+        qToLittleEndian<quint32>(quint32(sizeof(vendor) - 1), tags + 8);
+        memcpy(tags + 12, vendor, sizeof(vendor) - 1);
+        qToLittleEndian<quint32>(0, tags + 12 + sizeof(vendor) - 1);
+        addPacket(tags, int(sizeof(tags)));
+        emitPage(out, 0);
+    }
+
+    void addFrame(const qint16 *samples, QByteArray &out) override
+    {
+        // A refused frame becomes an empty packet, which players conceal,
+        // so the timeline stays intact.
+        const int bytes = encoder->encodeFrame(samples, Config::AUDIO_FRAME_SAMPLES, packet, int(sizeof(packet)));
+        granule += kGranulePerFrame;
+        addPacket(packet, qMax(0, bytes));
+        if (++pagePackets >= kPacketsPerPage || segments.size() > kMaxSegments - kMaxPacketSegments) {
+            emitPage(out, 0);
+        }
+    }
+
+    void flush(QByteArray &out, bool last) override
+    {
+        if (pagePackets > 0 || last) {
+            emitPage(out, last ? kEndOfStream : 0);
+        }
+    }
+
+private:
+    // Encoder lookahead at 48 kHz, which libopus has outside its
+    // low-delay mode; players drop this much from the start.
+    static constexpr quint16 kPreSkip = 312;
+    // Granule positions always count 48 kHz samples.
+    static constexpr qint64 kGranulePerFrame = 48 * Config::AUDIO_FRAME_MS;
+    // One second per page keeps the container overhead around 1%.
+    static constexpr int kPacketsPerPage = 1000 / Config::AUDIO_FRAME_MS;
+    static constexpr int kMaxSegments = 255;
+    static constexpr int kMaxPacketBytes = 1275;
+    static constexpr int kMaxPacketSegments = kMaxPacketBytes / 255 + 1;
+    static constexpr uchar kBeginOfStream = 0x02;
+    static constexpr uchar kEndOfStream = 0x04;
+
+    void addPacket(const uchar *data, int size)
+    {
+        // Lacing: 255-byte segments, ended by a shorter one (maybe 0).
+        for (int left = size; ; left -= 255) {
+            segments.append(char(qMin(left, 255)));
+            if (left < 255) {
+                break;
+            }
+        }
+        body.append(reinterpret_cast<const char *>(data), size);
+    }
+
+    void emitPage(QByteArray &out, uchar flags)
+    {
+        const int offset = out.size();
+        out.resize(offset + 27 + segments.size() + body.size());
+        uchar *page = reinterpret_cast<uchar *>(out.data() + offset);
+        memcpy(page, "OggS", 4);
+        page[4] = 0;
+        page[5] = flags;
+        // Header pages carry granule 0.
+        qToLittleEndian<qint64>(granule, page + 6);
+        qToLittleEndian<quint32>(serial, page + 14);
+        qToLittleEndian<quint32>(pageSequence++, page + 18);
+        qToLittleEndian<quint32>(0, page + 22);
+        page[26] = uchar(segments.size());
+        memcpy(page + 27, segments.constData(), size_t(segments.size()));
+        memcpy(page + 27 + segments.size(), body.constData(), size_t(body.size()));
+        qToLittleEndian<quint32>(crc(page, 27 + segments.size() + body.size()), page + 22);
+
+        segments.resize(0);
+        body.resize(0);
+        pagePackets = 0;
+    }
+
+    // CRC-32 as Ogg defines it: polynomial 0x04c11db7, MSB first, no
+    // reflection and no final xor.
+    static quint32 crc(const uchar *data, int size)
+    {
+        static const quint32 *table = []() {
+            static quint32 values[256];
+            for (quint32 i = 0; i < 256; ++i) {
+                quint32 r = i << 24;
+                for (int bit = 0; bit < 8; ++bit) {
+                    r = (r & 0x80000000u) ? (r << 1) ^ 0x04c11db7u : r << 1;
+                }
+                values[i] = r;
+            }
+            return values;
+        }();
+        quint32 value = 0;
+        for (int i = 0; i < size; ++i) {
+            value = (value << 8) ^ table[((value >> 24) ^ data[i]) & 0xFF];
+        }
+        return value;
+    }
+
+    AudioCodec *encoder;
+    quint32 serial;
+    quint32 pageSequence = 0;
+    qint64 granule = 0;
+    int pagePackets = 0;
+    QByteArray segments;
+    QByteArray body;
+    uchar packet[kMaxPacketBytes];
+};
+#endif // USE_OPUS
+
+RecordingFormat *createFormat()
+{
+#ifdef USE_OPUS
+    auto *opus = new OggOpusFormat;
+    if (opus->isValid()) {
+        return opus;
+    }
+    delete opus;
+    LOG_WARN(QStringLiteral("MeetingRecorder: Opus encoder unavailable, recording WAV"));
+#endif
+    return new WavFormat;
+}
+} // namespace
+
+// Drains the ring, encodes and writes. Runs at low priority: it only has
+// to keep up on average, and the ring absorbs seconds of delay.
+class RecorderThread : public QThread
+{
+public:
+    RecorderThread(SpscRing<MeetingRecorder::Frame> &ringValue, QFile *fileValue, RecordingFormat *formatValue)
+        : ring(ringValue)
+        , file(fileValue)
+        , format(formatValue)
+        , writeFailed(false)
+    {
+        setObjectName(QStringLiteral("RecorderThread"));
+        buffer.reserve(kWriteBlockBytes * 2);
+    }
+
+    ~RecorderThread() override
+    {
+        requestStop();
+        wait();
+        delete format;
+    }
+
+    void requestStop()
+    {
+        stopRequested.store(true);
+        wakeup.release();
+    }
+
+protected:
+    void run() override
+    {
+        format->begin(buffer);
+        QElapsedTimer sinceCheckpoint;
+        sinceCheckpoint.start();
+
+        while (true) {
+            // Checked before draining, so that every frame pushed before
+            // the stop request is still written.
+            const bool stopping = stopRequested.load();
+            while (MeetingRecorder::Frame *frame = ring.front()) {
+                format->addFrame(frame->samples, buffer);
+                ring.popFront();
+            }
+            if (stopping) {
+                break;
+            }
+
+            if (buffer.size() >= kWriteBlockBytes) {
+                writeBuffer();
+            }
+            if (sinceCheckpoint.hasExpired(Config::RECORDING_CHECKPOINT_MS)) {
+                checkpoint(false);
+                sinceCheckpoint.restart();
+            }
+            wakeup.tryAcquire(1, kPollMs);
+        }
+        checkpoint(true);
+    }
+
+private:
+    void writeBuffer()
+    {
+        if (buffer.isEmpty()) {
+            return;
+        }
+        if (file->write(buffer) != buffer.size() && !writeFailed) {
+            writeFailed = true;
+            LOG_WARN(QStringLiteral("MeetingRecorder: failed to write %1 - %2")
+                         .arg(file->fileName())
+                         .arg(file->errorString()));
+        }
+        buffer.resize(0);
+    }
+
+    void checkpoint(bool last)
+    {
+        format->flush(buffer, last);
+        writeBuffer();
+        format->patch(*file);
+        file->flush();
+    }
+
+    SpscRing<MeetingRecorder::Frame> &ring;
+    QFile *file;
+    RecordingFormat *format;
+    QByteArray buffer;
+    QSemaphore wakeup;
+    std::atomic<bool> stopRequested{false};
+    bool writeFailed;
+};
+
+MeetingRecorder::MeetingRecorder()
+    : ring(kRingFrames)
+    , thread(nullptr)
+    , file(nullptr)
+    , finishedBytes(0)
+    , recording(false)
+    , dropped(0)
+{
+}
+
+MeetingRecorder::~MeetingRecorder()
+{
+    stop();
+}
+
+QString MeetingRecorder::fileExtension()
+{
+#ifdef USE_OPUS
+    if (AudioCodec::isSupported(AudioCodec::Type::Opus)) {
+        return QStringLiteral("opus");
+    }
+#endif
+    return QStringLiteral("wav");
+}
+
+bool MeetingRecorder::start(const QString &path)
+{
+    if (thread) {
+        return false;
+    }
+
+    file = new QFile(path);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        LOG_WARN(QStringLiteral("MeetingRecorder: cannot open %1 - %2").arg(path).arg(file->errorString()));
+        delete file;
+        file = nullptr;
+        return false;
+    }
+
+    // Nothing consumes the ring between recordings.
+    ring.discardAll();
+    dropped.store(0);
+    finishedBytes = 0;
+    thread = new RecorderThread(ring, file, createFormat());
+    thread->start(QThread::LowPriority);
+    recording.store(true);
+    return true;
+}
+
+void MeetingRecorder::stop()
+{
+    if (!thread) {
+        return;
+    }
+
+    recording.store(false);
+    thread->requestStop();
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+
+    finishedBytes = file->size();
+    file->close();
+    LOG_INFO(QStringLiteral("MeetingRecorder: finished %1 (%2 KiB, %3 frames dropped)")
+                 .arg(file->fileName())
+                 .arg(finishedBytes / 1024)
+                 .arg(static_cast<qulonglong>(dropped.load())));
+    delete file;
+    file = nullptr;
+}
+
+void MeetingRecorder::push(const qint16 *samples)
+{
+    if (!recording.load(std::memory_order_relaxed)) {
+        return;
+    }
+    Frame *slot = ring.beginWrite();
+    if (!slot) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    memcpy(slot->samples, samples, sizeof(slot->samples));
+    ring.commitWrite();
+}
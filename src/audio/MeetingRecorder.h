@@ -0,0 +1,65 @@
+#ifndef MEETINGRECORDER_H
+#define MEETINGRECORDER_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+#include "common/Config.h"
+#include "common/SpscRing.h"
+
+class QFile;
+class RecorderThread;
+
+// Records the meeting to a compressed file without touching the audio
+// path.
+//
+// push() is called once per mixed frame on the mixer thread and only
+// copies the frame into a preallocated lock-free ring. A writer thread
+// drains the ring, encodes Ogg/Opus (WAV when the build has no Opus),
+// collects the output and writes it in large blocks. Every
+// Config::RECORDING_CHECKPOINT_MS the file is brought to a playable
+// state (complete Ogg pages, or a WAV header with the current sizes),
+// so a crash loses at most one checkpoint interval.
+class MeetingRecorder
+{
+public:
+    struct Frame
+    {
+        qint16 samples[Config::AUDIO_FRAME_SAMPLES];
+    };
+
+    MeetingRecorder();
+    ~MeetingRecorder();
+
+    MeetingRecorder(const MeetingRecorder &) = delete;
+    MeetingRecorder &operator=(const MeetingRecorder &) = delete;
+
+    // "opus" or "wav", whichever this build writes.
+    static QString fileExtension();
+
+    bool start(const QString &path);
+    // Writes out what is queued, finalises the file and waits for the
+    // writer thread.
+    void stop();
+    bool isRecording() const { return recording.load(std::memory_order_relaxed); }
+
+    // One Config::AUDIO_FRAME_SAMPLES frame; one producer thread at a
+    // time. Never blocks: the frame is dropped if the writer has fallen
+    // far behind.
+    void push(const qint16 *samples);
+
+    quint64 droppedFrames() const { return dropped.load(std::memory_order_relaxed); }
+    // Size of the finished file; valid after stop().
+    qint64 fileSize() const { return finishedBytes; }
+
+private:
+    SpscRing<Frame> ring;
+    RecorderThread *thread;
+    QFile *file;
+    qint64 finishedBytes;
+    std::atomic<bool> recording;
+    std::atomic<quint64> dropped;
+};
+
+#endif // MEETINGRECORDER_H
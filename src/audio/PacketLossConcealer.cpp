@@ -0,0 +1,174 @@
+#include "PacketLossConcealer.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr int kSamplesPerMs = Config::AUDIO_SAMPLE_RATE / 1000;
+// Full level for the first 10 ms, then a linear fade to silence at 60 ms.
+constexpr int kFadeStart = kSamplesPerMs * 10;
+constexpr int kFadeEnd = kSamplesPerMs * 60;
+// Samples compared for each candidate pitch lag.
+constexpr int kCorrLength = kSamplesPerMs * 5;
+// Coarse pitch search runs on every 4th sample and lag.
+constexpr int kDecimation = 4;
+// Stop counting once the output is silent anyway.
+constexpr int kMaxLostSamples = Config::AUDIO_SAMPLE_RATE;
+
+double correlation(const qint16 *a, const qint16 *b, int length, int step)
+{
+    double cross = 0.0;
+    double energyA = 0.0;
+    double energyB = 0.0;
+    for (int i = 0; i < length; i += step) {
+        cross += double(a[i]) * b[i];
+        energyA += double(a[i]) * a[i];
+        energyB += double(b[i]) * b[i];
+    }
+    if (energyA <= 0.0 || energyB <= 0.0) {
+        return 0.0;
+    }
+    return cross / std::sqrt(energyA * energyB);
+}
+
+int periodsFor(int lostSamples)
+{
+    if (lostSamples < kSamplesPerMs * 10) {
+        return 1;
+    }
+    return lostSamples < kSamplesPerMs * 20 ? 2 : 3;
+}
+} // namespace
+
+PacketLossConcealer::PacketLossConcealer()
+{
+    reset();
+}
+
+void PacketLossConcealer::reset()
+{
+    memset(history, 0, sizeof(history));
+    historyCount = 0;
+    lostSamples = 0;
+    pitch = kMaxPitch;
+    periods = 0;
+    loopLength = 0;
+    loopPos = 0;
+}
+
+void PacketLossConcealer::appendHistory(const qint16 *samples, int count)
+{
+    if (count >= kHistorySamples) {
+        memcpy(history, samples + count - kHistorySamples, sizeof(history));
+    } else {
+        memmove(history, history + count, size_t(kHistorySamples - count) * sizeof(qint16));
+        memcpy(history + kHistorySamples - count, samples, size_t(count) * sizeof(qint16));
+    }
+    historyCount = qMin(historyCount + count, kHistorySamples);
+}
+
+int PacketLossConcealer::estimatePitch() const
+{
+    // Compare the most recent samples with the same stretch one candidate
+    // period earlier.
+    const qint16 *recent = history + kHistorySamples - kCorrLength;
+
+    int bestLag = kMaxPitch;
+    double best = -1.0;
+    for (int lag = kMinPitch; lag <= kMaxPitch; lag += kDecimation) {
+        const double c = correlation(recent, recent - lag, kCorrLength, kDecimation);
+        if (c > best) {
+            best = c;
+            bestLag = lag;
+        }
+    }
+
+    const int from = qMax(kMinPitch, bestLag - kDecimation + 1);
+    const int to = qMin(kMaxPitch, bestLag + kDecimation - 1);
+    best = -1.0;
+    for (int lag = from; lag <= to; ++lag) {
+        const double c = correlation(recent, recent - lag, kCorrLength, 1);
+        if (c > best) {
+            best = c;
+            bestLag = lag;
+        }
+    }
+    return bestLag;
+}
+
+void PacketLossConcealer::buildLoop(int periodCount)
+{
+    periods = periodCount;
+    loopLength = pitch * periods;
+
+    // The loop replays the last loopLength samples. Its tail is faded
+    // towards the samples just before the loop start, so wrapping around
+    // continues the waveform instead of jumping.
+    const qint16 *end = history + kHistorySamples;
+    const qint16 *start = end - loopLength;
+    const int overlap = pitch / 4;
+
+    memcpy(loop, start, size_t(loopLength - overlap) * sizeof(qint16));
+    for (int j = 0; j < overlap; ++j) {
+        const qint32 tail = end[j - overlap];
+        const qint32 before = start[j - overlap];
+        loop[loopLength - overlap + j] = qint16((tail * (overlap - j) + before * j) / overlap);
+    }
+}
+
+qint16 PacketLossConcealer::nextSample()
+{
+    if (loopPos >= loopLength) {
+        loopPos = 0;
+        const int wanted = periodsFor(lostSamples);
+        if (wanted != periods) {
+            buildLoop(wanted);
+        }
+    }
+
+    const qint32 sample = loop[loopPos++];
+    qint32 scaled = sample;
+    if (lostSamples >= kFadeEnd) {
+        scaled = 0;
+    } else if (lostSamples > kFadeStart) {
+        scaled = sample * (kFadeEnd - lostSamples) / (kFadeEnd - kFadeStart);
+    }
+    lostSamples = qMin(lostSamples + 1, kMaxLostSamples);
+    return qint16(scaled);
+}
+
+void PacketLossConcealer::conceal(qint16 *out, int count)
+{
+    if (lostSamples == 0) {
+        pitch = historyCount >= kMaxPitch * kMaxPeriods ? estimatePitch() : kMaxPitch;
+        buildLoop(1);
+        loopPos = 0;
+    }
+
+    if (lostSamples >= kFadeEnd) {
+        memset(out, 0, size_t(count) * sizeof(qint16));
+        lostSamples = qMin(lostSamples + count, kMaxLostSamples);
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        out[i] = nextSample();
+    }
+}
+
+void PacketLossConcealer::processReceived(qint16 *frame, int count)
+{
+    if (lostSamples > 0) {
+        // Cross-fade from the synthetic continuation into the real signal:
+        // 4 ms, plus 4 ms per further 10 ms of loss, at most 10 ms.
+        const int extra = qMax(0, lostSamples - kFadeStart) / (kSamplesPerMs * 10);
+        const int fade = qMin(qMin(kSamplesPerMs * (4 + 4 * extra), kSamplesPerMs * 10), count);
+        for (int j = 0; j < fade; ++j) {
+            const qint32 synthetic = nextSample();
+            frame[j] = qint16((synthetic * (fade - j) + qint32(frame[j]) * j) / fade);
+        }
+        lostSamples = 0;
+    }
+
+    appendHistory(frame, count);
+}
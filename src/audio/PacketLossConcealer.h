@@ -0,0 +1,62 @@
+#ifndef PACKETLOSSCONCEALER_H
+#define PACKETLOSSCONCEALER_H
+
+#include <QtGlobal>
+
+#include "common/Config.h"
+
+// Pitch-synchronous packet loss concealment, after ITU-T G.711 Appendix I.
+//
+// Keeps a short history of played audio. When a frame is missing it
+// estimates the pitch period of the history and synthesises a
+// continuation by cycling through the last one, two and then three pitch
+// periods (more periods as the loss grows longer, which avoids a buzzy
+// repeated cycle). Loop seams are overlap-added. After 10 ms the output
+// fades out linearly and reaches silence at 60 ms. The first real frame
+// after a loss is cross-faded with the continuation.
+//
+// Not thread-safe; used from whichever thread plays the audio.
+class PacketLossConcealer
+{
+public:
+    PacketLossConcealer();
+
+    void reset();
+
+    // Feeds a received frame. Modified in place when it follows concealed
+    // audio, so that playback cross-fades back into the real signal.
+    void processReceived(qint16 *frame, int count);
+
+    // Writes count samples of concealment for missing audio.
+    void conceal(qint16 *out, int count);
+
+    bool isConcealing() const { return lostSamples > 0; }
+    int pitchLag() const { return pitch; }
+
+private:
+    // Pitch search range: 2.5 ms (400 Hz) to 15 ms (~67 Hz).
+    static constexpr int kMinPitch = Config::AUDIO_SAMPLE_RATE / 400;
+    static constexpr int kMaxPitch = Config::AUDIO_SAMPLE_RATE * 15 / 1000;
+    static constexpr int kMaxPeriods = 3;
+    // Room for three of the longest periods, the seam overlap and 5 ms of
+    // slack for the pitch search window.
+    static constexpr int kHistorySamples = kMaxPitch * kMaxPeriods + kMaxPitch / 4 + Config::AUDIO_SAMPLE_RATE / 200;
+
+    void appendHistory(const qint16 *samples, int count);
+    int estimatePitch() const;
+    void buildLoop(int periods);
+    qint16 nextSample();
+
+    qint16 history[kHistorySamples];
+    int historyCount;
+
+    // Concealment state.
+    int lostSamples;
+    int pitch;
+    int periods;
+    qint16 loop[kMaxPitch * kMaxPeriods];
+    int loopLength;
+    int loopPos;
+};
+
+#endif // PACKETLOSSCONCEALER_H
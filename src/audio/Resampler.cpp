@@ -0,0 +1,134 @@
+#include "Resampler.h"
+
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include "AudioDsp.h"
+
+namespace {
+// Filter length, in zero crossings of the sinc on each side at the lower
+// of the two rates. 24 gives a ~1.7 kHz transition band at 48 <-> 16 kHz.
+constexpr int kZeroCrossings = 24;
+// Cutoff as a fraction of the lower Nyquist frequency; the transition
+// band is centred here so that the stop band starts close to Nyquist.
+constexpr double kCutoff = 0.9;
+// Kaiser window shape, about 80 dB of stop-band attenuation.
+constexpr double kKaiserBeta = 8.0;
+constexpr double kPi = 3.14159265358979323846;
+
+// Zeroth-order modified Bessel function of the first kind.
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+} // namespace
+
+Resampler::Resampler(int inputRate, int outputRate, int maxInput)
+    : m_inputRate(qMax(1, inputRate))
+    , m_outputRate(qMax(1, outputRate))
+    , m_maxInput(qMax(1, maxInput))
+    , m_buffered(0)
+    , m_position(0)
+{
+    const int divisor = std::gcd(m_inputRate, m_outputRate);
+    m_up = m_outputRate / divisor;
+    m_down = m_inputRate / divisor;
+
+    // Prototype low-pass at inputRate * m_up, where one sample at the
+    // lower rate spans qMax(m_up, m_down) prototype samples.
+    const int factor = qMax(m_up, m_down);
+    const double cutoff = 0.5 * kCutoff / factor;
+    m_taps = (2 * kZeroCrossings * factor + m_up - 1) / m_up;
+    const int length = m_taps * m_up;
+    const double centre = 0.5 * (length - 1);
+    const double windowNorm = besselI0(kKaiserBeta);
+
+    QVector<double> prototype(length);
+    for (int n = 0; n < length; ++n) {
+        const double t = n - centre;
+        const double sinc = t == 0.0 ? 2.0 * cutoff : std::sin(2.0 * kPi * cutoff * t) / (kPi * t);
+        const double r = t / centre;
+        prototype[n] = sinc * besselI0(kKaiserBeta * std::sqrt(qMax(0.0, 1.0 - r * r))) / windowNorm;
+    }
+
+    // Each phase is normalised to unity DC gain on its own, which also
+    // makes up for the energy spread across m_up phases, then quantised.
+    // Rounding leftovers go to the largest tap so every phase sums to
+    // exactly 1.0 in Q15.
+    m_phases.resize(m_up * m_taps);
+    for (int phase = 0; phase < m_up; ++phase) {
+        double sum = 0.0;
+        for (int k = 0; k < m_taps; ++k) {
+            sum += prototype[phase + k * m_up];
+        }
+        qint16 *taps = m_phases.data() + phase * m_taps;
+        int total = 0;
+        int largest = 0;
+        for (int k = 0; k < m_taps; ++k) {
+            const double value = prototype[phase + k * m_up] / sum * 32768.0;
+            taps[m_taps - 1 - k] = qint16(qBound(-32767, int(std::lround(value)), 32767));
+            total += taps[m_taps - 1 - k];
+            if (std::abs(taps[m_taps - 1 - k]) > std::abs(taps[largest])) {
+                largest = m_taps - 1 - k;
+            }
+        }
+        taps[largest] = qint16(qBound(-32767, taps[largest] + 32768 - total, 32767));
+    }
+
+    m_buffer.resize(m_taps - 1 + m_maxInput);
+    reset();
+}
+
+void Resampler::reset()
+{
+    m_buffer.fill(0);
+    m_buffered = m_taps - 1;
+    m_position = 0;
+}
+
+int Resampler::process(const qint16 *in, int count, qint16 *out, int maxOut)
+{
+    count = qBound(0, count, m_maxInput);
+    memcpy(m_buffer.data() + m_buffered, in, size_t(count) * sizeof(qint16));
+    m_buffered += count;
+
+    // An output sample is ready once its newest input sample is here.
+    const int available = m_buffered - (m_taps - 1);
+    const qint16 *history = m_buffer.constData();
+    int produced = 0;
+    while (produced < maxOut) {
+        const qint64 index = m_position / m_up;
+        if (index >= available) {
+            break;
+        }
+        const qint16 *taps = m_phases.constData() + int(m_position % m_up) * m_taps;
+        const qint32 acc = AudioDsp::dotProduct(history + index, taps, m_taps);
+        out[produced++] = qint16(qBound(-32768, (acc + (1 << 14)) >> 15, 32767));
+        m_position += m_down;
+    }
+    if (m_position / m_up < available) {
+        // Out of room: drop the input that was not converted.
+        m_position = qint64(available) * m_up;
+    }
+
+    const int consumed = int(qMin<qint64>(m_position / m_up, available));
+    memmove(m_buffer.data(), m_buffer.constData() + consumed, size_t(m_buffered - consumed) * sizeof(qint16));
+    m_buffered -= consumed;
+    m_position -= qint64(consumed) * m_up;
+    return produced;
+}
+
+int Resampler::maxOutputFor(int count) const
+{
+    return int((qint64(count) * m_up + m_down - 1) / m_down) + 1;
+}
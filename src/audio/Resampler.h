@@ -0,0 +1,54 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// Streaming polyphase resampler for int16 mono PCM between rates with a
+// small rational ratio (48 kHz <-> 16/24 kHz in practice).
+//
+// One Kaiser-windowed sinc low-pass is designed for the lower of the two
+// rates and split into one Q15 filter per output phase, so each output
+// sample costs a single dot product over the input history (the
+// vectorised AudioDsp::dotProduct). State carries across calls, so a
+// stream can be fed in blocks of any size without seams.
+class Resampler
+{
+public:
+    // maxInput bounds the samples passed to one process() call; all
+    // storage is allocated here, none while processing.
+    Resampler(int inputRate, int outputRate, int maxInput);
+
+    void reset();
+
+    // Converts count input samples and writes at most maxOut output
+    // samples. Returns how many were written. Input that would produce
+    // more than maxOut samples is dropped.
+    int process(const qint16 *in, int count, qint16 *out, int maxOut);
+
+    // Output samples produced for count input samples, rounded up.
+    int maxOutputFor(int count) const;
+    int inputRate() const { return m_inputRate; }
+    int outputRate() const { return m_outputRate; }
+    int tapsPerPhase() const { return m_taps; }
+
+private:
+    int m_inputRate;
+    int m_outputRate;
+    // Output = input * m_up / m_down.
+    int m_up;
+    int m_down;
+    int m_taps;
+    int m_maxInput;
+    // m_up filters of m_taps coefficients each, time-reversed so that a
+    // phase lines up with the input history oldest first.
+    QVector<qint16> m_phases;
+    // m_taps - 1 samples of history followed by the current input.
+    QVector<qint16> m_buffer;
+    int m_buffered;
+    // Position of the next output sample, in input samples * m_up from
+    // the first sample after the history.
+    qint64 m_position;
+};
+
+#endif // RESAMPLER_H
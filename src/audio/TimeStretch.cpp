@@ -0,0 +1,137 @@
+#include "TimeStretch.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "common/Config.h"
+
+namespace TimeStretch {
+
+namespace {
+
+constexpr int kSamplesPerMs = Config::AUDIO_SAMPLE_RATE / 1000;
+// Pitch search range: 2.5 ms (400 Hz) to 12 ms (~83 Hz).
+constexpr int kMinLag = kSamplesPerMs * 5 / 2;
+constexpr int kMaxLag = kSamplesPerMs * 12;
+// Length of the segments compared for each candidate lag.
+constexpr int kCorrLength = kSamplesPerMs * 5;
+// The coarse search runs on a 4x decimated signal.
+constexpr int kDecimation = 4;
+// Normalised correlation above which a block counts as periodic.
+constexpr double kVoicedCorrelation = 0.8;
+// Mean absolute amplitude below which a block is treated as silence and
+// stretched regardless of periodicity.
+constexpr double kQuietMeanAbs = 64.0;
+
+double correlation(const qint16 *x, int lag, int length, int step)
+{
+    double cross = 0.0;
+    double energyA = 0.0;
+    double energyB = 0.0;
+    for (int i = 0; i < length; i += step) {
+        const double a = x[i];
+        const double b = x[i + lag];
+        cross += a * b;
+        energyA += a * a;
+        energyB += b * b;
+    }
+    if (energyA <= 0.0 || energyB <= 0.0) {
+        return 0.0;
+    }
+    return cross / std::sqrt(energyA * energyB);
+}
+
+// Returns the pitch lag to cut or insert, or 0 when the block should not
+// be stretched. Segments x[0, lag) and x[lag, 2 * lag) must both fit.
+int findLag(const qint16 *x, int count)
+{
+    const int maxLag = qMin(kMaxLag, count / 2);
+    if (maxLag < kMinLag) {
+        return 0;
+    }
+
+    double meanAbs = 0.0;
+    for (int i = 0; i < 2 * maxLag; ++i) {
+        meanAbs += std::abs(int(x[i]));
+    }
+    meanAbs /= 2 * maxLag;
+    if (meanAbs < kQuietMeanAbs) {
+        // Silence: take out as much as possible in one go.
+        return maxLag;
+    }
+
+    const int corrLength = qMin(kCorrLength, count - maxLag);
+
+    // Coarse search on every kDecimation-th sample and lag, then refine
+    // around the best candidate at full resolution.
+    int bestLag = 0;
+    double best = -1.0;
+    for (int lag = kMinLag; lag <= maxLag; lag += kDecimation) {
+        const double c = correlation(x, lag, corrLength, kDecimation);
+        if (c > best) {
+            best = c;
+            bestLag = lag;
+        }
+    }
+
+    const int from = qMax(kMinLag, bestLag - kDecimation + 1);
+    const int to = qMin(maxLag, bestLag + kDecimation - 1);
+    best = -1.0;
+    for (int lag = from; lag <= to; ++lag) {
+        const double c = correlation(x, lag, corrLength, 1);
+        if (c > best) {
+            best = c;
+            bestLag = lag;
+        }
+    }
+
+    return best >= kVoicedCorrelation ? bestLag : 0;
+}
+
+// out[i] fades from a[i] to b[i] over length samples.
+void crossFade(const qint16 *a, const qint16 *b, qint16 *out, int length)
+{
+    for (int i = 0; i < length; ++i) {
+        const qint32 mixed = (qint32(a[i]) * (length - i) + qint32(b[i]) * i) / length;
+        out[i] = qint16(mixed);
+    }
+}
+
+} // namespace
+
+int accelerate(const qint16 *in, int count, qint16 *out)
+{
+    if (count < kMinBlockSamples) {
+        return 0;
+    }
+    const int lag = findLag(in, count);
+    if (lag <= 0) {
+        return 0;
+    }
+
+    // [x0 -> x1 cross-fade][rest from 2 * lag]: one period shorter, and
+    // both joins land on the original waveform.
+    crossFade(in, in + lag, out, lag);
+    memcpy(out + lag, in + 2 * lag, size_t(count - 2 * lag) * sizeof(qint16));
+    return count - lag;
+}
+
+int expand(const qint16 *in, int count, qint16 *out, int maxOut)
+{
+    if (count < kMinBlockSamples) {
+        return 0;
+    }
+    const int lag = findLag(in, count);
+    if (lag <= 0 || count + lag > maxOut) {
+        return 0;
+    }
+
+    // [x0][x1 -> x0 cross-fade][x1 and the rest]: the second period is
+    // played twice, blending back into the first so the seam is smooth.
+    memcpy(out, in, size_t(lag) * sizeof(qint16));
+    crossFade(in + lag, in, out + lag, lag);
+    memcpy(out + 2 * lag, in + lag, size_t(count - lag) * sizeof(qint16));
+    return count + lag;
+}
+
+} // namespace TimeStretch
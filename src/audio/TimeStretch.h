@@ -0,0 +1,27 @@
+#ifndef TIMESTRETCH_H
+#define TIMESTRETCH_H
+
+#include <QtGlobal>
+
+// Pitch-synchronous time stretching for speech (WSOLA).
+//
+// Both operations look for the pitch period of the block and cross-fade
+// two adjacent periods, so a whole period is removed or inserted without
+// a discontinuity. Blocks that are neither clearly periodic nor quiet are
+// left alone, since stretching noise-like audio this way is audible.
+namespace TimeStretch {
+
+// Shortest block worth passing in; shorter blocks are always rejected.
+constexpr int kMinBlockSamples = 480;
+
+// Removes one pitch period. Returns the output length (shorter than
+// count), or 0 if the block was not suitable and out is untouched.
+int accelerate(const qint16 *in, int count, qint16 *out);
+
+// Inserts one pitch period. out needs room for maxOut samples. Returns
+// the output length (longer than count), or 0 if nothing was done.
+int expand(const qint16 *in, int count, qint16 *out, int maxOut);
+
+} // namespace TimeStretch
+
+#endif // TIMESTRETCH_H
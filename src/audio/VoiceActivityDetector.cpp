@@ -0,0 +1,94 @@
+#include "VoiceActivityDetector.h"
+
+#include <cmath>
+
+#include "common/Config.h"
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kFullScale = 32768.0;
+
+// Speech band edges for the spectral feature.
+constexpr double kBandLowHz = 200.0;
+constexpr double kBandHighHz = 4000.0;
+const double kHighPassCoeff = 1.0 / (1.0 + 2.0 * kPi * kBandLowHz / Config::AUDIO_SAMPLE_RATE);
+const double kLowPassCoeff = 1.0 - 1.0 / (1.0 + 2.0 * kPi * kBandHighHz / Config::AUDIO_SAMPLE_RATE);
+
+// Frames quieter than this are never speech, whatever the noise floor.
+constexpr double kMinSpeechDb = -55.0;
+// Margins over the noise floor for speech-shaped and for any frames.
+constexpr double kSpeechMarginDb = 6.0;
+constexpr double kLoudMarginDb = 15.0;
+// Share of energy in the speech band that makes a frame speech-shaped.
+constexpr double kSpeechBandRatio = 0.45;
+// The floor follows quieter frames quickly and louder ones slowly, so it
+// tracks the minimum of the background. It still creeps up during
+// activity so that a new, steady noise source stops counting as speech
+// after about 15 s.
+constexpr double kFloorFallRate = 0.3;
+constexpr double kFloorRiseDb = 0.05;
+constexpr double kFloorRiseActiveDb = 0.02;
+constexpr double kFloorMinDb = -90.0;
+// Transmission continues for 200 ms after the last speech frame.
+constexpr int kHangoverFrames = 200 / Config::AUDIO_FRAME_MS;
+}
+
+VoiceActivityDetector::VoiceActivityDetector()
+{
+    reset();
+}
+
+void VoiceActivityDetector::reset()
+{
+    noiseFloor = kFloorMinDb;
+    haveFloor = false;
+    hangover = 0;
+    highPassIn = 0.0;
+    highPassOut = 0.0;
+    lowPassOut = 0.0;
+}
+
+bool VoiceActivityDetector::process(const qint16 *samples, int count)
+{
+    if (count <= 0) {
+        return isActive();
+    }
+
+    double total = 0.0;
+    double band = 0.0;
+    for (int i = 0; i < count; ++i) {
+        const double x = samples[i];
+        highPassOut = kHighPassCoeff * (highPassOut + x - highPassIn);
+        highPassIn = x;
+        lowPassOut += kLowPassCoeff * (highPassOut - lowPassOut);
+        total += x * x;
+        band += lowPassOut * lowPassOut;
+    }
+
+    const double energyDb = 10.0 * std::log10(total / count / (kFullScale * kFullScale) + 1e-12);
+    const double bandRatio = total > 0.0 ? band / total : 0.0;
+
+    if (!haveFloor) {
+        noiseFloor = qMax(energyDb, kFloorMinDb);
+        haveFloor = true;
+    }
+
+    const double aboveFloor = energyDb - noiseFloor;
+    const bool speech = energyDb > kMinSpeechDb
+                        && ((aboveFloor > kSpeechMarginDb && bandRatio > kSpeechBandRatio)
+                            || aboveFloor > kLoudMarginDb);
+
+    if (energyDb < noiseFloor) {
+        noiseFloor += (energyDb - noiseFloor) * kFloorFallRate;
+    } else {
+        noiseFloor += qMin(aboveFloor, speech ? kFloorRiseActiveDb : kFloorRiseDb);
+    }
+    noiseFloor = qMax(noiseFloor, kFloorMinDb);
+
+    if (speech) {
+        hangover = kHangoverFrames + 1;
+    } else if (hangover > 0) {
+        --hangover;
+    }
+    return hangover > 0;
+}
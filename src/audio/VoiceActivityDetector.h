@@ -0,0 +1,41 @@
+#ifndef VOICEACTIVITYDETECTOR_H
+#define VOICEACTIVITYDETECTOR_H
+
+#include <QtGlobal>
+
+// Frame-level voice activity detection for discontinuous transmission.
+//
+// Two cheap features per 20 ms frame: the frame energy relative to a
+// tracked background noise floor, and the share of that energy in the
+// speech band (roughly 200 Hz - 4 kHz, split off with one-pole filters).
+// Hum and hiss sit mostly outside the band, so a frame counts as speech
+// when it is moderately above the floor and speech-shaped, or well
+// above the floor whatever its shape. A hangover keeps the detector
+// active briefly after speech so word endings are not clipped.
+//
+// Not thread-safe; used from the capture thread.
+class VoiceActivityDetector
+{
+public:
+    VoiceActivityDetector();
+
+    void reset();
+
+    // Classifies one frame. Returns true while it should be transmitted:
+    // during speech and for the hangover after it.
+    bool process(const qint16 *samples, int count);
+
+    bool isActive() const { return hangover > 0; }
+    double noiseFloorDb() const { return noiseFloor; }
+
+private:
+    double noiseFloor;
+    bool haveFloor;
+    int hangover;
+    // Filter states carried across frames.
+    double highPassIn;
+    double highPassOut;
+    double lowPassOut;
+};
+
+#endif // VOICEACTIVITYDETECTOR_H
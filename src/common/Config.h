@@ -10,15 +10,78 @@ constexpr quint16 AUDIO_PORT_SEND   = 6000;
 constexpr quint16 AUDIO_PORT_RECV   = 6001;
 constexpr quint16 VIDEO_PORT_SEND   = 7000;
 constexpr quint16 VIDEO_PORT_RECV   = 7001;
+constexpr quint16 VIDEO_PORT_FORWARD = 7002;
 constexpr quint16 SCREEN_PORT_SEND  = 7100;
 constexpr quint16 SCREEN_PORT_RECV  = 7101;
 
 constexpr const char *DEFAULT_ROOM_ID = "default";
 
+// Audio stream format shared by transport, mixing and the DSP chain
+// (mono int16, 20 ms frames). The sample rate is a build-time mode
+// (cmake -DAUDIO_SAMPLE_RATE=16000|24000|48000): speech-only meetings run
+// at 16 kHz for a third of the bandwidth and mixing work. Every peer of
+// a meeting must be built with the same mode.
+#ifndef LANMEETING_AUDIO_SAMPLE_RATE
+#define LANMEETING_AUDIO_SAMPLE_RATE 48000
+#endif
+constexpr int AUDIO_SAMPLE_RATE   = LANMEETING_AUDIO_SAMPLE_RATE;
+constexpr int AUDIO_CHANNELS      = 1;
+constexpr int AUDIO_FRAME_MS      = 20;
+constexpr int AUDIO_FRAME_SAMPLES = AUDIO_SAMPLE_RATE / 1000 * AUDIO_FRAME_MS;
+constexpr int AUDIO_FRAME_BYTES   = AUDIO_FRAME_SAMPLES * AUDIO_CHANNELS * 2;
+static_assert(AUDIO_SAMPLE_RATE == 16000 || AUDIO_SAMPLE_RATE == 24000 || AUDIO_SAMPLE_RATE == 48000,
+              "AUDIO_SAMPLE_RATE must be 16000, 24000 or 48000");
+
+// The sound devices always run at 48 kHz; AudioEngine resamples to and
+// from the stream rate when the two differ.
+constexpr int AUDIO_DEVICE_SAMPLE_RATE   = 48000;
+constexpr int AUDIO_DEVICE_FRAME_SAMPLES = AUDIO_DEVICE_SAMPLE_RATE / 1000 * AUDIO_FRAME_MS;
+
+// Target bitrate for compressed audio codecs (bits per second). Speech
+// at 24 kbit/s is close to transparent with Opus and keeps a 10-person
+// meeting well under 1 Mbit/s on the host.
+constexpr int AUDIO_CODEC_BITRATE = 24000;
+
+// Requested playback device buffer. The sink pulls audio on its own clock
+// and this is the most it holds ahead of the speaker, so it bounds output
+// latency; too small and slow machines start to crackle.
+constexpr int AUDIO_PLAYBACK_BUFFER_MS = 40;
+
+// Discontinuous transmission: peers on the versioned packet format stop
+// sending while their microphone only picks up background noise, and
+// refresh the receiver's comfort noise with a descriptor this often.
+constexpr bool AUDIO_DTX_ENABLED = true;
+constexpr int AUDIO_DTX_SID_INTERVAL_MS = 400;
+
+// The host mixes only this many of the loudest sources per frame; the
+// rest are not decoded. Three covers a conversation with interruptions.
+constexpr int AUDIO_MIX_MAX_SPEAKERS = 3;
+
+// Redundant audio: receivers report their packet loss this often, and
+// senders repeat up to this many earlier frames in each packet when the
+// link is lossy (0 turns redundancy off).
+constexpr int AUDIO_LOSS_REPORT_INTERVAL_MS = 1000;
+constexpr int AUDIO_REDUNDANCY_MAX_DEPTH = 2;
+
+// Meeting recordings: Opus bitrate (when built with Opus; plain WAV
+// otherwise) and how often the file on disk is brought to a playable
+// state, which bounds what a crash can lose.
+constexpr int RECORDING_OPUS_BITRATE = 32000;
+constexpr int RECORDING_CHECKPOINT_MS = 5000;
+
 // Video sending interval (camera). Slightly reduced from 25 FPS
 // to ease CPU and bandwidth pressure while keeping motion smooth.
 constexpr int VIDEO_SEND_INTERVAL_MS = 66; // ~15 FPS
 
+// Largest H.264 payload per datagram. Leaves room for the packet header,
+// UDP/IP and a tunnel or two under a 1500-byte MTU, so nothing relies on
+// IP fragmentation.
+constexpr int VIDEO_MAX_PAYLOAD_BYTES = 1200;
+
+// Frame rate a host asks of guests shown as grid tiles. The active
+// speaker and a maximized tile are asked for full rate and size.
+constexpr int VIDEO_TILE_MAX_FPS = 12;
+
 // Screen sharing capture / send parameters.
 // Keep FPS modest so that CPU and bandwidth usage remain bounded.
 constexpr int SCREEN_SHARE_FPS = 6; // ~5–8 FPS range
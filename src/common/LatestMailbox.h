@@ -0,0 +1,65 @@
+#ifndef LATESTMAILBOX_H
+#define LATESTMAILBOX_H
+
+#include <QMutex>
+#include <QtGlobal>
+#include <utility>
+
+// Single-slot hand-over of the newest item from one stage to the next.
+//
+// put() replaces an item the consumer has not taken yet, so a consumer
+// that falls behind skips items instead of queueing them; the replaced
+// item is released outside the lock, never copied. Meant for video
+// frames, where only the latest one is worth working on.
+template<typename T>
+class LatestMailbox
+{
+public:
+    LatestMailbox() = default;
+
+    LatestMailbox(const LatestMailbox &) = delete;
+    LatestMailbox &operator=(const LatestMailbox &) = delete;
+
+    // Returns true when the slot was empty, i.e. the consumer has no
+    // wake-up pending and needs one.
+    bool put(T item)
+    {
+        bool wasEmpty = false;
+        {
+            QMutexLocker locker(&mutex);
+            wasEmpty = !full;
+            if (full) {
+                ++dropped;
+            }
+            std::swap(slot, item);
+            full = true;
+        }
+        return wasEmpty;
+    }
+
+    bool take(T &out)
+    {
+        QMutexLocker locker(&mutex);
+        if (!full) {
+            return false;
+        }
+        out = std::move(slot);
+        slot = T();
+        full = false;
+        return true;
+    }
+
+    quint64 droppedCount() const
+    {
+        QMutexLocker locker(&mutex);
+        return dropped;
+    }
+
+private:
+    mutable QMutex mutex;
+    T slot{};
+    bool full = false;
+    quint64 dropped = 0;
+};
+
+#endif // LATESTMAILBOX_H
@@ -0,0 +1,106 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free single-producer/single-consumer queue.
+//
+// All slots are allocated up front. The producer only advances the head
+// and the consumer only advances the tail, so neither side ever blocks or
+// allocates; slots are filled and drained in place to avoid copies of
+// large frames. Exactly one thread may act as producer and one as
+// consumer at any time.
+template<typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(int capacity)
+        : m_slots(roundUpPowerOfTwo(capacity))
+        , m_mask(m_slots.size() - 1)
+    {
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    int capacity() const { return int(m_slots.size()); }
+
+    // Approximate when called concurrently with the other side.
+    int size() const
+    {
+        return int(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+    }
+    bool isEmpty() const { return size() == 0; }
+
+    // Producer side: returns the next free slot, or nullptr when full.
+    // The slot becomes visible to the consumer on commitWrite().
+    T *beginWrite()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == m_slots.size()) {
+            return nullptr;
+        }
+        return &m_slots[head & m_mask];
+    }
+
+    void commitWrite() { m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    bool push(const T &value)
+    {
+        T *slot = beginWrite();
+        if (!slot) {
+            return false;
+        }
+        *slot = value;
+        commitWrite();
+        return true;
+    }
+
+    // Consumer side: returns the oldest slot, or nullptr when empty. The
+    // slot stays valid until popFront().
+    T *front()
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_slots[tail & m_mask];
+    }
+
+    void popFront() { m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    bool pop(T &out)
+    {
+        T *slot = front();
+        if (!slot) {
+            return false;
+        }
+        out = *slot;
+        popFront();
+        return true;
+    }
+
+    // Consumer side: drops everything currently queued.
+    void discardAll() { m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+    static size_t roundUpPowerOfTwo(int capacity)
+    {
+        size_t size = 2;
+        while (size < size_t(capacity > 0 ? capacity : 1)) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<T> m_slots;
+    const size_t m_mask;
+    // Kept on separate cache lines so producer and consumer do not
+    // invalidate each other on every operation.
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+#endif // SPSCRING_H
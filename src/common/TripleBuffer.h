@@ -0,0 +1,58 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Lock-free hand-over of the latest value of a small struct from one
+// writer thread to one reader thread (stats snapshots and the like).
+//
+// Three slots: the writer fills its own, then swaps it with the shared
+// middle one; the reader swaps the middle one for its own whenever it
+// holds something newer. Neither side waits, and the reader always gets
+// the most recent complete value; intermediate ones are simply dropped.
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // Writer side: fill the slot, then publish it.
+    T &writeSlot() { return m_slots[m_back]; }
+
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    void write(const T &value)
+    {
+        writeSlot() = value;
+        publish();
+    }
+
+    // Reader side: the latest published value (or the previous one when
+    // nothing new was published since).
+    const T &read()
+    {
+        if (m_middle.load(std::memory_order_relaxed) & kFresh) {
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & kIndexMask;
+        }
+        return m_slots[m_front];
+    }
+
+private:
+    static constexpr int kFresh = 4;
+    static constexpr int kIndexMask = 3;
+
+    T m_slots[3] = {};
+    // Slot index, plus kFresh when the writer published since the last read.
+    alignas(64) std::atomic<int> m_middle{1};
+    // Owned by the writer and the reader respectively.
+    alignas(64) int m_back = 0;
+    alignas(64) int m_front = 2;
+};
+
+#endif // TRIPLEBUFFER_H
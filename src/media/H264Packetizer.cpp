@@ -0,0 +1,367 @@
+#include "H264Packetizer.h"
+
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// RFC 6184 NAL unit types.
+constexpr quint8 kNalTypeMask = 0x1F;
+constexpr quint8 kNalIdr = 5;
+constexpr quint8 kNalStapA = 24;
+constexpr quint8 kNalFuA = 28;
+constexpr quint8 kFuStart = 0x80;
+constexpr quint8 kFuEnd = 0x40;
+constexpr int kFuHeaderSize = 2;
+
+const char kStartCode[4] = {0, 0, 0, 1};
+
+// Access units still being assembled; beyond this the oldest is given up.
+constexpr int kMaxPendingFrames = 8;
+// A timestamp this far behind the last delivered one means the sender
+// restarted its clock rather than a very late packet.
+constexpr qint32 kRestartGap = H264Packet::kClockRate * 10;
+
+bool timestampBefore(quint32 a, quint32 b)
+{
+    return qint32(a - b) < 0;
+}
+
+// Finds the next Annex-B start code at or after `from`. Returns the
+// offset of the first byte after it, or -1, and the offset where the
+// start code itself begins.
+int nextStartCode(const uchar *data, int size, int from, int &codeBegin)
+{
+    for (int i = from; i + 2 < size; ++i) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            codeBegin = (i > from && data[i - 1] == 0) ? i - 1 : i;
+            return i + 3;
+        }
+    }
+    codeBegin = size;
+    return -1;
+}
+} // namespace
+
+namespace H264Packet {
+
+bool parse(const QByteArray &datagram, Header &outHeader, const char *&payload, int &payloadSize)
+{
+    if (!isPacketized(datagram)) {
+        return false;
+    }
+    const uchar *in = reinterpret_cast<const uchar *>(datagram.constData());
+    outHeader.flags = in[1];
+    outHeader.seq = qFromBigEndian<quint16>(in + 2);
+    outHeader.timestamp = qFromBigEndian<quint32>(in + 4);
+    payload = datagram.constData() + kHeaderSize;
+    payloadSize = datagram.size() - kHeaderSize;
+    return true;
+}
+
+} // namespace H264Packet
+
+H264Packetizer::H264Packetizer(int maxPayloadValue)
+    : maxPayload(qMax(kFuHeaderSize + 1, maxPayloadValue))
+    , nextSeq(0)
+    , packets(0)
+{
+}
+
+void H264Packetizer::reset()
+{
+    nextSeq = 0;
+}
+
+void H264Packetizer::appendPacket(QVector<QByteArray> &out,
+                                  quint8 flags,
+                                  quint32 timestamp,
+                                  const char *prefix,
+                                  int prefixSize,
+                                  const char *data,
+                                  int size)
+{
+    QByteArray packet(H264Packet::kHeaderSize + prefixSize + size, Qt::Uninitialized);
+    uchar *p = reinterpret_cast<uchar *>(packet.data());
+    p[0] = H264Packet::kMarker;
+    p[1] = flags;
+    qToBigEndian<quint16>(nextSeq++, p + 2);
+    qToBigEndian<quint32>(timestamp, p + 4);
+    if (prefixSize > 0) {
+        memcpy(p + H264Packet::kHeaderSize, prefix, size_t(prefixSize));
+    }
+    memcpy(p + H264Packet::kHeaderSize + prefixSize, data, size_t(size));
+    out.append(packet);
+    ++packets;
+}
+
+bool H264Packetizer::packetize(const QByteArray &accessUnit, quint32 timestamp, QVector<QByteArray> &out)
+{
+    const uchar *data = reinterpret_cast<const uchar *>(accessUnit.constData());
+    const int size = accessUnit.size();
+
+    // Collect the NAL units first: the flags of each packet depend on
+    // whether it is the first or last of the access unit, and on whether
+    // any NAL unit is an IDR slice.
+    struct Nal
+    {
+        int offset;
+        int size;
+    };
+    QVector<Nal> nals;
+    bool keyframe = false;
+    int codeBegin = 0;
+    int begin = nextStartCode(data, size, 0, codeBegin);
+    while (begin >= 0) {
+        int nextCode = 0;
+        const int next = nextStartCode(data, size, begin, nextCode);
+        int end = nextCode;
+        // Trailing zero bytes belong to the next start code.
+        while (end > begin && data[end - 1] == 0) {
+            --end;
+        }
+        if (end > begin) {
+            nals.append({begin, end - begin});
+            keyframe = keyframe || (data[begin] & kNalTypeMask) == kNalIdr;
+        }
+        begin = next;
+    }
+    if (nals.isEmpty()) {
+        return false;
+    }
+
+    const quint8 keyFlag = keyframe ? H264Packet::kFlagKeyframe : 0;
+    bool first = true;
+    for (int n = 0; n < nals.size(); ++n) {
+        const char *nal = accessUnit.constData() + nals[n].offset;
+        const int nalSize = nals[n].size;
+        const bool lastNal = n + 1 == nals.size();
+
+        if (nalSize <= maxPayload) {
+            const quint8 flags = keyFlag | (first ? H264Packet::kFlagStart : 0)
+                                 | (lastNal ? H264Packet::kFlagEnd : 0);
+            appendPacket(out, flags, timestamp, nullptr, 0, nal, nalSize);
+            first = false;
+            continue;
+        }
+
+        // FU-A: the NAL header is folded into the FU indicator (F and NRI
+        // bits) and FU header (type), and the body is split.
+        const quint8 nalHeader = quint8(nal[0]);
+        const int chunk = maxPayload - kFuHeaderSize;
+        for (int offset = 1; offset < nalSize; offset += chunk) {
+            const int take = qMin(chunk, nalSize - offset);
+            const bool lastFragment = offset + take >= nalSize;
+            char fu[kFuHeaderSize];
+            fu[0] = char((nalHeader & 0xE0) | kNalFuA);
+            fu[1] = char((nalHeader & kNalTypeMask) | (offset == 1 ? kFuStart : 0) | (lastFragment ? kFuEnd : 0));
+            const quint8 flags = keyFlag | (first ? H264Packet::kFlagStart : 0)
+                                 | (lastNal && lastFragment ? H264Packet::kFlagEnd : 0);
+            appendPacket(out, flags, timestamp, fu, kFuHeaderSize, nal + offset, take);
+            first = false;
+        }
+    }
+    return true;
+}
+
+H264Depacketizer::H264Depacketizer()
+{
+    reset();
+    completed = 0;
+    lost = 0;
+    skipped = 0;
+    malformed = 0;
+}
+
+void H264Depacketizer::reset()
+{
+    pending.clear();
+    haveDelivered = false;
+    lastTimestamp = 0;
+    lastEndSeq = 0;
+    // Nothing can be decoded before the first IDR picture.
+    needKeyframe = true;
+}
+
+bool H264Depacketizer::push(const QByteArray &datagram, QByteArray &accessUnit)
+{
+    H264Packet::Header header;
+    const char *payload = nullptr;
+    int payloadSize = 0;
+    if (!H264Packet::parse(datagram, header, payload, payloadSize)) {
+        ++malformed;
+        return false;
+    }
+    if (haveDelivered && !timestampBefore(lastTimestamp, header.timestamp)) {
+        if (qint32(lastTimestamp - header.timestamp) < kRestartGap) {
+            // Part of an access unit that was already delivered or given up.
+            return false;
+        }
+        reset();
+    }
+
+    Assembly *assembly = nullptr;
+    for (Assembly &candidate : pending) {
+        if (candidate.timestamp == header.timestamp) {
+            assembly = &candidate;
+            break;
+        }
+    }
+    if (!assembly) {
+        if (pending.size() >= kMaxPendingFrames) {
+            const auto oldest = std::min_element(pending.begin(), pending.end(), [](const Assembly &a, const Assembly &b) {
+                return timestampBefore(a.timestamp, b.timestamp);
+            });
+            pending.erase(oldest);
+            ++lost;
+            needKeyframe = true;
+        }
+        pending.append(Assembly());
+        assembly = &pending.last();
+        assembly->timestamp = header.timestamp;
+    }
+
+    for (const Fragment &fragment : std::as_const(assembly->fragments)) {
+        if (fragment.seq == header.seq) {
+            return false;
+        }
+    }
+    Fragment fragment;
+    fragment.seq = header.seq;
+    fragment.payload = QByteArray(payload, payloadSize);
+    assembly->fragments.append(fragment);
+    if (header.flags & H264Packet::kFlagStart) {
+        assembly->haveStart = true;
+        assembly->startSeq = header.seq;
+    }
+    if (header.flags & H264Packet::kFlagEnd) {
+        assembly->haveEnd = true;
+        assembly->endSeq = header.seq;
+    }
+    assembly->keyframe = assembly->keyframe || (header.flags & H264Packet::kFlagKeyframe);
+
+    if (!isComplete(*assembly)) {
+        return false;
+    }
+
+    // Anything older that is still incomplete will not be decodable
+    // after this one; a sequence gap means whole access units vanished.
+    const quint64 lostBefore = lost;
+    dropOlderThan(assembly->timestamp);
+    for (Assembly &candidate : pending) {
+        if (candidate.timestamp == header.timestamp) {
+            assembly = &candidate;
+            break;
+        }
+    }
+    if (haveDelivered && quint16(assembly->startSeq - lastEndSeq) != 1) {
+        needKeyframe = true;
+        if (lost == lostBefore) {
+            ++lost;
+        }
+    }
+    haveDelivered = true;
+    lastTimestamp = assembly->timestamp;
+    lastEndSeq = assembly->endSeq;
+
+    Assembly done = *assembly;
+    pending.erase(pending.begin() + (assembly - pending.data()));
+
+    if (done.keyframe) {
+        needKeyframe = false;
+    }
+    if (needKeyframe) {
+        ++skipped;
+        return false;
+    }
+    if (!assemble(done, accessUnit)) {
+        ++malformed;
+        ++lost;
+        needKeyframe = true;
+        return false;
+    }
+    ++completed;
+    return true;
+}
+
+bool H264Depacketizer::isComplete(const Assembly &assembly) const
+{
+    if (!assembly.haveStart || !assembly.haveEnd) {
+        return false;
+    }
+    return assembly.fragments.size() == int(quint16(assembly.endSeq - assembly.startSeq)) + 1;
+}
+
+void H264Depacketizer::dropOlderThan(quint32 timestamp)
+{
+    for (int i = pending.size() - 1; i >= 0; --i) {
+        if (timestampBefore(pending[i].timestamp, timestamp)) {
+            pending.removeAt(i);
+            ++lost;
+            needKeyframe = true;
+        }
+    }
+}
+
+bool H264Depacketizer::assemble(Assembly &assembly, QByteArray &accessUnit)
+{
+    const quint16 startSeq = assembly.startSeq;
+    std::sort(assembly.fragments.begin(), assembly.fragments.end(), [startSeq](const Fragment &a, const Fragment &b) {
+        return quint16(a.seq - startSeq) < quint16(b.seq - startSeq);
+    });
+
+    accessUnit.clear();
+    bool inFragmentedNal = false;
+    for (const Fragment &fragment : std::as_const(assembly.fragments)) {
+        const uchar *p = reinterpret_cast<const uchar *>(fragment.payload.constData());
+        const int size = fragment.payload.size();
+        if (size < 1) {
+            return false;
+        }
+        const quint8 type = p[0] & kNalTypeMask;
+
+        if (type == kNalFuA) {
+            if (size < kFuHeaderSize) {
+                return false;
+            }
+            const bool start = (p[1] & kFuStart) != 0;
+            if (start == inFragmentedNal) {
+                // A fragment went missing inside the NAL unit, or a new one
+                // started before the previous one ended.
+                return false;
+            }
+            if (start) {
+                accessUnit.append(kStartCode, sizeof(kStartCode));
+                accessUnit.append(char((p[0] & 0xE0) | (p[1] & kNalTypeMask)));
+            }
+            accessUnit.append(reinterpret_cast<const char *>(p + kFuHeaderSize), size - kFuHeaderSize);
+            inFragmentedNal = (p[1] & kFuEnd) == 0;
+            continue;
+        }
+        if (inFragmentedNal) {
+            return false;
+        }
+
+        if (type == kNalStapA) {
+            // Not produced by H264Packetizer, but cheap to accept.
+            int offset = 1;
+            while (offset + 2 <= size) {
+                const int nalSize = qFromBigEndian<quint16>(p + offset);
+                offset += 2;
+                if (nalSize == 0 || offset + nalSize > size) {
+                    return false;
+                }
+                accessUnit.append(kStartCode, sizeof(kStartCode));
+                accessUnit.append(reinterpret_cast<const char *>(p + offset), nalSize);
+                offset += nalSize;
+            }
+            continue;
+        }
+        if (type == 0 || type > 23) {
+            return false;
+        }
+        accessUnit.append(kStartCode, sizeof(kStartCode));
+        accessUnit.append(fragment.payload);
+    }
+    return !inFragmentedNal && !accessUnit.isEmpty();
+}
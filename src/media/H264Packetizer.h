@@ -0,0 +1,139 @@
+#ifndef H264PACKETIZER_H
+#define H264PACKETIZER_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+// Wire format of H.264 video datagrams, after RFC 6184.
+//
+// Each encoded access unit (an Annex-B byte stream from the encoder) is
+// split into its NAL units, and each NAL unit goes out either whole
+// (single NAL unit packet) or, when larger than the payload budget, as
+// FU-A fragments. Every datagram carries a small header:
+//
+//   marker (1) + flags (1) + sequence (2) + timestamp (4) + payload
+//
+// The sequence number counts datagrams, so the receiver sees any loss;
+// the timestamp is a 90 kHz clock shared by all packets of one access
+// unit. Flags mark the first and the last packet of an access unit (the
+// latter is RTP's marker bit) and access units holding an IDR picture.
+// Multi-byte fields are big-endian.
+//
+// Older peers send each access unit as one bare Annex-B or JPEG
+// datagram; neither can start with the marker byte, so both formats can
+// share a port.
+namespace H264Packet {
+
+constexpr quint8 kMarker = 0xB2;
+constexpr int kHeaderSize = 1 + 1 + 2 + 4;
+constexpr quint8 kFlagStart = 0x01;
+constexpr quint8 kFlagEnd = 0x02;
+constexpr quint8 kFlagKeyframe = 0x04;
+constexpr int kClockRate = 90000;
+
+struct Header
+{
+    quint8 flags = 0;
+    quint16 seq = 0;
+    quint32 timestamp = 0;
+};
+
+inline bool isPacketized(const QByteArray &datagram)
+{
+    return datagram.size() > kHeaderSize && quint8(datagram.at(0)) == kMarker;
+}
+
+bool parse(const QByteArray &datagram, Header &outHeader, const char *&payload, int &payloadSize);
+
+} // namespace H264Packet
+
+// Splits access units into datagrams. Owns the outgoing sequence number.
+class H264Packetizer
+{
+public:
+    // maxPayload is the budget for the RTP payload of one datagram,
+    // excluding H264Packet::kHeaderSize.
+    explicit H264Packetizer(int maxPayload);
+
+    void reset();
+
+    // Appends the datagrams for one Annex-B access unit to `out`.
+    // Returns false when the input holds no NAL unit.
+    bool packetize(const QByteArray &accessUnit, quint32 timestamp, QVector<QByteArray> &out);
+
+    quint64 sentPackets() const { return packets; }
+
+private:
+    void appendPacket(QVector<QByteArray> &out,
+                      quint8 flags,
+                      quint32 timestamp,
+                      const char *prefix,
+                      int prefixSize,
+                      const char *data,
+                      int size);
+
+    int maxPayload;
+    quint16 nextSeq;
+    quint64 packets;
+};
+
+// Rebuilds access units from datagrams that may arrive reordered or not
+// at all. Only complete access units are handed out, in timestamp
+// order. Once anything is lost, the decoder's references are broken, so
+// everything up to the next IDR access unit is dropped instead of being
+// decoded into corrupt pictures.
+class H264Depacketizer
+{
+public:
+    H264Depacketizer();
+
+    void reset();
+
+    // Takes one packetized datagram. Returns true and fills `accessUnit`
+    // (Annex-B, ready for the decoder) when it completed one.
+    bool push(const QByteArray &datagram, QByteArray &accessUnit);
+
+    bool waitingForKeyframe() const { return needKeyframe; }
+    quint64 completedFrames() const { return completed; }
+    // Access units that were incomplete or arrived with a gap before
+    // them.
+    quint64 lostFrames() const { return lost; }
+    // Complete access units dropped while waiting for a keyframe.
+    quint64 skippedFrames() const { return skipped; }
+    quint64 malformedPackets() const { return malformed; }
+
+private:
+    struct Fragment
+    {
+        quint16 seq = 0;
+        QByteArray payload;
+    };
+
+    struct Assembly
+    {
+        quint32 timestamp = 0;
+        bool haveStart = false;
+        bool haveEnd = false;
+        bool keyframe = false;
+        quint16 startSeq = 0;
+        quint16 endSeq = 0;
+        QVector<Fragment> fragments;
+    };
+
+    bool isComplete(const Assembly &assembly) const;
+    bool assemble(Assembly &assembly, QByteArray &accessUnit);
+    void dropOlderThan(quint32 timestamp);
+
+    QVector<Assembly> pending;
+    bool haveDelivered;
+    quint32 lastTimestamp;
+    quint16 lastEndSeq;
+    bool needKeyframe;
+    quint64 completed;
+    quint64 lost;
+    quint64 skipped;
+    quint64 malformed;
+};
+
+#endif // H264PACKETIZER_H
@@ -0,0 +1,649 @@
+#include "HostVideoReceiver.h"
+
+#include <QHostAddress>
+#include <QMutexLocker>
+#include <QSet>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVector>
+#include <QtEndian>
+#include <cstring>
+
+#ifdef USE_FFMPEG_H264
+#include "VideoDecoder.h"
+#include "VideoFrameConverter.h"
+#endif
+
+#include "H264Packetizer.h"
+#include "common/LatestMailbox.h"
+#include "common/Logger.h"
+
+namespace {
+
+// Access units queued for one stream beyond which its decoder has fallen
+// hopelessly behind: the backlog is dropped and decoding resumes at the
+// next keyframe.
+constexpr int kMaxQueuedUnits = 8;
+constexpr qint64 kStatsIntervalMs = 10000;
+// How long relayed video from a participant that left is ignored: long
+// enough for what the host relayed before it heard of the departure.
+constexpr qint64 kDepartedHoldMs = 2000;
+
+bool isJpeg(const QByteArray &datagram)
+{
+    return datagram.size() > 2 && quint8(datagram.at(0)) == 0xFF && quint8(datagram.at(1)) == 0xD8;
+}
+
+} // namespace
+
+namespace VideoRelay {
+
+QByteArray wrap(quint32 sourceIpv4, const QByteArray &datagram)
+{
+    QByteArray relayed(kHeaderSize + datagram.size(), Qt::Uninitialized);
+    uchar *p = reinterpret_cast<uchar *>(relayed.data());
+    p[0] = kMarker;
+    qToBigEndian<quint32>(sourceIpv4, p + 1);
+    memcpy(p + kHeaderSize, datagram.constData(), size_t(datagram.size()));
+    return relayed;
+}
+
+bool unwrap(const QByteArray &datagram, QString &sourceIp, QByteArray &payload)
+{
+    if (datagram.size() <= kHeaderSize || quint8(datagram.at(0)) != kMarker) {
+        return false;
+    }
+    const uchar *p = reinterpret_cast<const uchar *>(datagram.constData());
+    sourceIp = QHostAddress(qFromBigEndian<quint32>(p + 1)).toString();
+    payload = datagram.mid(kHeaderSize);
+    return true;
+}
+
+} // namespace VideoRelay
+
+// One sender's video. Datagrams come in on the receive thread; decoding
+// runs in pool jobs, at most one at a time per stream.
+class HostVideoStream
+{
+public:
+    explicit HostVideoStream(const QString &idValue)
+        : id(idValue)
+        , scheduled(false)
+#ifdef USE_FFMPEG_H264
+        , decoder(nullptr)
+        , decoderFailed(false)
+        , decoded(av_frame_alloc())
+        , latest(av_frame_alloc())
+#endif
+    {
+    }
+
+    ~HostVideoStream()
+    {
+#ifdef USE_FFMPEG_H264
+        delete decoder;
+        av_frame_free(&decoded);
+        av_frame_free(&latest);
+#endif
+    }
+
+    HostVideoStream(const HostVideoStream &) = delete;
+    HostVideoStream &operator=(const HostVideoStream &) = delete;
+
+    // Receive thread. Returns true when the stream needs a decode job.
+    bool pushDatagram(const QByteArray &datagram, qint64 nowNs)
+    {
+        Unit unit;
+        unit.readyNs = nowNs;
+        if (H264Packet::isPacketized(datagram)) {
+            if (!depacketizer.push(datagram, unit.data)) {
+                return false;
+            }
+        } else {
+            // Older guests send a whole JPEG picture or access unit.
+            unit.data = datagram;
+            unit.jpeg = isJpeg(datagram);
+        }
+
+        QMutexLocker locker(&mutex);
+        if (unit.jpeg) {
+            // JPEG pictures stand alone; only the newest one is worth decoding.
+            for (int i = queue.size() - 1; i >= 0; --i) {
+                if (queue[i].jpeg) {
+                    queue.removeAt(i);
+                    ++dropped;
+                }
+            }
+        } else if (queue.size() >= kMaxQueuedUnits) {
+            // Later pictures reference the ones dropped here, so everything
+            // up to the next keyframe goes as well.
+            dropped += quint64(queue.size()) + 1;
+            queue.clear();
+            depacketizer.reset();
+            return false;
+        }
+        queue.append(unit);
+        if (scheduled) {
+            return false;
+        }
+        scheduled = true;
+        return true;
+    }
+
+    // Decode thread. Runs until the queue is empty.
+    void decodePending(HostVideoReceiver *owner)
+    {
+        QVector<Unit> units;
+        for (;;) {
+            QSize target;
+            {
+                QMutexLocker locker(&mutex);
+                if (queue.isEmpty()) {
+                    scheduled = false;
+                    return;
+                }
+                units.swap(queue);
+                target = tileSize;
+            }
+
+            // Every access unit is decoded, since later ones reference it,
+            // but only the newest picture is converted.
+            const Unit *newestJpeg = nullptr;
+#ifdef USE_FFMPEG_H264
+            qint64 pictureReadyNs = -1;
+#endif
+            for (const Unit &unit : std::as_const(units)) {
+                if (unit.jpeg) {
+                    newestJpeg = &unit;
+                    continue;
+                }
+#ifdef USE_FFMPEG_H264
+                if (decodeAccessUnit(unit.data)) {
+                    pictureReadyNs = unit.readyNs;
+                }
+#else
+                ++decodeErrors;
+#endif
+            }
+#ifdef USE_FFMPEG_H264
+            if (pictureReadyNs >= 0) {
+                publish(scaler.toImage(latest, target), pictureReadyNs, owner);
+            }
+#endif
+            if (newestJpeg) {
+                publish(decodeJpeg(newestJpeg->data, target), newestJpeg->readyNs, owner);
+            }
+            units.clear();
+        }
+    }
+
+    void setTileSize(const QSize &size)
+    {
+        QMutexLocker locker(&mutex);
+        tileSize = size;
+    }
+
+    // Receive thread. Starts a new latency window.
+    HostVideoReceiver::StreamStats takeStats()
+    {
+        HostVideoReceiver::StreamStats stats;
+        stats.id = id;
+        stats.frames = frames.load(std::memory_order_relaxed);
+        stats.presented = presented.load(std::memory_order_relaxed);
+        stats.lost = depacketizer.lostFrames();
+        stats.skipped = depacketizer.skippedFrames();
+        stats.dropped = dropped.load(std::memory_order_relaxed) + images.droppedCount();
+        stats.decodeErrors = decodeErrors.load(std::memory_order_relaxed);
+        const quint64 count = latencyCount.exchange(0, std::memory_order_relaxed);
+        const qint64 totalNs = latencyTotalNs.exchange(0, std::memory_order_relaxed);
+        const qint64 maxNs = latencyMaxNs.exchange(0, std::memory_order_relaxed);
+        if (count > 0) {
+            stats.avgDecodeMs = double(totalNs) / 1e6 / double(count);
+            stats.maxDecodeMs = double(maxNs) / 1e6;
+        }
+        return stats;
+    }
+
+    const QString id;
+    LatestMailbox<QImage> images;
+
+private:
+    struct Unit
+    {
+        QByteArray data;
+        bool jpeg = false;
+        // When the access unit was complete.
+        qint64 readyNs = 0;
+    };
+
+#ifdef USE_FFMPEG_H264
+    bool decodeAccessUnit(const QByteArray &accessUnit)
+    {
+        if (!decoder && !decoderFailed) {
+            decoder = new VideoDecoder();
+            if (!decoder->init()) {
+                LOG_WARN(QStringLiteral("HostVideoReceiver: failed to initialize H.264 decoder for %1").arg(id));
+                delete decoder;
+                decoder = nullptr;
+                decoderFailed = true;
+            }
+        }
+        // A failed decode clears its output frame, so decode into a
+        // scratch frame and keep the last good picture in `latest`.
+        if (!decoder || !decoder->decodePacket(accessUnit, decoded)) {
+            ++decodeErrors;
+            return false;
+        }
+        av_frame_unref(latest);
+        av_frame_move_ref(latest, decoded);
+        ++frames;
+        return true;
+    }
+#endif
+
+    QImage decodeJpeg(const QByteArray &data, const QSize &target)
+    {
+        QImage image;
+        if (!image.loadFromData(data, "JPG")) {
+            return QImage();
+        }
+        ++frames;
+        if (target.isEmpty()) {
+            return image;
+        }
+        const QSize fit = image.size().scaled(target, Qt::KeepAspectRatio).boundedTo(image.size());
+        if (fit == image.size()) {
+            return image;
+        }
+        return image.scaled(fit, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    void publish(QImage image, qint64 readyNs, HostVideoReceiver *owner)
+    {
+        if (image.isNull()) {
+            ++decodeErrors;
+            return;
+        }
+        const qint64 latencyNs = owner->clock.nsecsElapsed() - readyNs;
+        latencyTotalNs.fetch_add(latencyNs, std::memory_order_relaxed);
+        latencyCount.fetch_add(1, std::memory_order_relaxed);
+        qint64 maxNs = latencyMaxNs.load(std::memory_order_relaxed);
+        while (latencyNs > maxNs && !latencyMaxNs.compare_exchange_weak(maxNs, latencyNs, std::memory_order_relaxed)) {
+        }
+
+        ++presented;
+        if (images.put(std::move(image))) {
+            emit owner->frameReady(id);
+        }
+    }
+
+    // Guards queue, scheduled and tileSize.
+    QMutex mutex;
+    QVector<Unit> queue;
+    // A decode job is queued or running.
+    bool scheduled;
+    QSize tileSize;
+
+    // Receive thread only.
+    H264Depacketizer depacketizer;
+
+#ifdef USE_FFMPEG_H264
+    // Decode job only.
+    VideoDecoder *decoder;
+    bool decoderFailed;
+    DecodedFrameScaler scaler;
+    AVFrame *decoded;
+    AVFrame *latest;
+#endif
+
+    std::atomic<quint64> frames{0};
+    std::atomic<quint64> presented{0};
+    std::atomic<quint64> dropped{0};
+    std::atomic<quint64> decodeErrors{0};
+    std::atomic<qint64> latencyTotalNs{0};
+    std::atomic<qint64> latencyMaxNs{0};
+    std::atomic<quint64> latencyCount{0};
+};
+
+class HostVideoReceiverWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HostVideoReceiverWorker(HostVideoReceiver *ownerValue)
+        : owner(ownerValue)
+        , socket(nullptr)
+        , statsTimer(nullptr)
+        , forwardPort(0)
+        , forwardedPackets(0)
+    {
+    }
+
+    bool start(quint16 listenPort, quint16 forwardPortValue)
+    {
+        stop();
+        forwardPort = forwardPortValue;
+
+        socket = new QUdpSocket(this);
+        if (!socket->bind(QHostAddress::AnyIPv4, listenPort)) {
+            LOG_WARN(QStringLiteral("HostVideoReceiver: failed to bind UDP port %1: %2")
+                         .arg(listenPort)
+                         .arg(socket->errorString()));
+            delete socket;
+            socket = nullptr;
+            return false;
+        }
+        connect(socket, &QUdpSocket::readyRead, this, &HostVideoReceiverWorker::onReadyRead);
+
+        statsTimer = new QTimer(this);
+        statsTimer->setInterval(int(kStatsIntervalMs));
+        connect(statsTimer, &QTimer::timeout, this, &HostVideoReceiverWorker::reportStats);
+        statsTimer->start();
+        return true;
+    }
+
+    void stop()
+    {
+        if (statsTimer) {
+            statsTimer->stop();
+            delete statsTimer;
+            statsTimer = nullptr;
+        }
+        if (socket) {
+            socket->close();
+            delete socket;
+            socket = nullptr;
+        }
+        forwardPort = 0;
+        participants.clear();
+        departed.clear();
+        recipients.clear();
+        routes.clear();
+    }
+
+    void addParticipant(const QString &ip)
+    {
+        participants.insert(ip);
+    }
+
+    void removeParticipant(const QString &ip)
+    {
+        participants.remove(ip);
+        departed.insert(ip, owner->clock.elapsed());
+        {
+            // A running decode job keeps its stream alive until it returns.
+            QMutexLocker locker(&owner->streamsMutex);
+            owner->streams.remove(ip);
+        }
+        recipients.remove(ip);
+        updateRoutes();
+    }
+
+    void addRecipient(const QString &ip)
+    {
+        if (!recipients.contains(ip)) {
+            recipients.insert(ip, QStringList());
+            updateRoutes();
+        }
+    }
+
+    void setSubscriptions(const QString &ip, const QStringList &sources)
+    {
+        auto it = recipients.find(ip);
+        if (it != recipients.end() && *it != sources) {
+            *it = sources;
+            updateRoutes();
+        }
+    }
+
+signals:
+    void streamStatsUpdated(const QList<HostVideoReceiver::StreamStats> &stats);
+
+private slots:
+    void onReadyRead()
+    {
+        while (socket && socket->hasPendingDatagrams()) {
+            const qint64 pendingSize = socket->pendingDatagramSize();
+            if (pendingSize <= 0) {
+                break;
+            }
+            QByteArray datagram(int(pendingSize), Qt::Uninitialized);
+            QHostAddress senderAddr;
+            const qint64 read = socket->readDatagram(datagram.data(), datagram.size(), &senderAddr);
+            if (read <= 0) {
+                LOG_WARN(QStringLiteral("HostVideoReceiver: failed to read UDP datagram - %1").arg(socket->errorString()));
+                continue;
+            }
+            datagram.resize(int(read));
+
+            QString senderIp = senderAddr.toString();
+            if (!participants.contains(senderIp)) {
+                // Not in the meeting, or already gone: late datagrams from
+                // a departed guest must not bring its stream back.
+                continue;
+            }
+            if (forwardPort != 0) {
+                forward(senderIp, senderAddr, datagram);
+            } else {
+                QByteArray payload;
+                if (VideoRelay::unwrap(datagram, senderIp, payload)) {
+                    auto gone = departed.find(senderIp);
+                    if (gone != departed.end()) {
+                        if (owner->clock.elapsed() - gone.value() < kDepartedHoldMs) {
+                            continue;
+                        }
+                        departed.erase(gone);
+                    }
+                    datagram = payload;
+                }
+            }
+
+            QSharedPointer<HostVideoStream> stream;
+            {
+                QMutexLocker locker(&owner->streamsMutex);
+                QSharedPointer<HostVideoStream> &slot = owner->streams[senderIp];
+                if (!slot) {
+                    slot.reset(new HostVideoStream(senderIp));
+                    LOG_INFO(QStringLiteral("HostVideoReceiver: new video stream from %1").arg(senderIp));
+                }
+                stream = slot;
+            }
+
+            if (stream->pushDatagram(datagram, owner->clock.nsecsElapsed())) {
+                HostVideoReceiver *target = owner;
+                owner->decodePool.start([stream, target]() { stream->decodePending(target); });
+            }
+        }
+    }
+
+    void reportStats()
+    {
+        QList<QSharedPointer<HostVideoStream>> current;
+        {
+            QMutexLocker locker(&owner->streamsMutex);
+            current = owner->streams.values();
+        }
+
+        QList<HostVideoReceiver::StreamStats> stats;
+        for (const QSharedPointer<HostVideoStream> &stream : std::as_const(current)) {
+            const HostVideoReceiver::StreamStats entry = stream->takeStats();
+            stats.append(entry);
+            LOG_INFO(QStringLiteral("HostVideoReceiver stream %1: frames=%2 presented=%3 lost=%4 skipped=%5 "
+                                    "dropped=%6 decodeErrors=%7 decodeMs(avg/max)=%8/%9")
+                         .arg(entry.id)
+                         .arg(static_cast<qulonglong>(entry.frames))
+                         .arg(static_cast<qulonglong>(entry.presented))
+                         .arg(static_cast<qulonglong>(entry.lost))
+                         .arg(static_cast<qulonglong>(entry.skipped))
+                         .arg(static_cast<qulonglong>(entry.dropped))
+                         .arg(static_cast<qulonglong>(entry.decodeErrors))
+                         .arg(entry.avgDecodeMs, 0, 'f', 1)
+                         .arg(entry.maxDecodeMs, 0, 'f', 1));
+        }
+        if (forwardedPackets > 0) {
+            LOG_INFO(QStringLiteral("HostVideoReceiver: forwarded %1 packets to %2 recipients")
+                         .arg(static_cast<qulonglong>(forwardedPackets))
+                         .arg(recipients.size()));
+            forwardedPackets = 0;
+        }
+        if (!stats.isEmpty()) {
+            emit streamStatsUpdated(stats);
+        }
+    }
+
+private:
+    // Copies a guest's datagram to everyone subscribed to it. Only
+    // recipients have routes, so nothing else is ever relayed.
+    void forward(const QString &senderIp, const QHostAddress &senderAddr, const QByteArray &datagram)
+    {
+        const auto route = routes.constFind(senderIp);
+        if (route == routes.constEnd() || route->isEmpty()) {
+            return;
+        }
+        const QByteArray relayed = VideoRelay::wrap(senderAddr.toIPv4Address(), datagram);
+        for (const QHostAddress &recipient : *route) {
+            if (socket->writeDatagram(relayed, recipient, forwardPort) == relayed.size()) {
+                ++forwardedPackets;
+            }
+        }
+    }
+
+    // Rebuilds the per-sender recipient lists from the subscriptions.
+    // Runs only when membership or a subscription changes, so forwarding
+    // a datagram stays a lookup and a copy.
+    void updateRoutes()
+    {
+        routes.clear();
+        for (auto source = recipients.constBegin(); source != recipients.constEnd(); ++source) {
+            QVector<QHostAddress> &targets = routes[source.key()];
+            for (auto it = recipients.constBegin(); it != recipients.constEnd(); ++it) {
+                if (it.key() == source.key() || (!it->isEmpty() && !it->contains(source.key()))) {
+                    continue;
+                }
+                targets.append(QHostAddress(it.key()));
+            }
+        }
+    }
+
+    HostVideoReceiver *owner;
+    QUdpSocket *socket;
+    QTimer *statsTimer;
+
+    // Addresses video is accepted from.
+    QSet<QString> participants;
+    // Relayed sources removed recently -> when, on owner->clock.
+    QHash<QString, qint64> departed;
+
+    // Forwarding state; 0 means this receiver does not forward.
+    quint16 forwardPort;
+    quint64 forwardedPackets;
+    // Recipient -> its subscription list (empty: every other guest).
+    QHash<QString, QStringList> recipients;
+    // Sender -> recipients its datagrams are copied to.
+    QHash<QString, QVector<QHostAddress>> routes;
+};
+
+HostVideoReceiver::HostVideoReceiver(QObject *parent)
+    : QObject(parent)
+    , recvThread()
+    , worker(new HostVideoReceiverWorker(this))
+    , running(false)
+{
+    clock.start();
+    // Streams decode in parallel, one pool thread each at most.
+    decodePool.setMaxThreadCount(QThread::idealThreadCount());
+
+    worker->moveToThread(&recvThread);
+    recvThread.setObjectName(QStringLiteral("HostVideoRecvThread"));
+    connect(&recvThread, &QThread::finished, worker, &QObject::deleteLater);
+
+    connect(worker,
+            &HostVideoReceiverWorker::streamStatsUpdated,
+            this,
+            &HostVideoReceiver::streamStatsUpdated,
+            Qt::QueuedConnection);
+
+    recvThread.start(QThread::HighPriority);
+}
+
+HostVideoReceiver::~HostVideoReceiver()
+{
+    stop();
+    if (recvThread.isRunning()) {
+        recvThread.quit();
+        recvThread.wait();
+    }
+}
+
+bool HostVideoReceiver::start(quint16 listenPort, quint16 forwardPort)
+{
+    bool ok = false;
+    HostVideoReceiverWorker *target = worker;
+    QMetaObject::invokeMethod(
+        worker,
+        [target, listenPort, forwardPort, &ok]() { ok = target->start(listenPort, forwardPort); },
+        Qt::BlockingQueuedConnection);
+    running = ok;
+    return ok;
+}
+
+void HostVideoReceiver::stop()
+{
+    if (!running) {
+        return;
+    }
+    HostVideoReceiverWorker *target = worker;
+    QMetaObject::invokeMethod(worker, [target]() { target->stop(); }, Qt::BlockingQueuedConnection);
+    decodePool.waitForDone();
+    {
+        QMutexLocker locker(&streamsMutex);
+        streams.clear();
+    }
+    running = false;
+}
+
+void HostVideoReceiver::setTileSize(const QString &ip, const QSize &size)
+{
+    if (const QSharedPointer<HostVideoStream> target = stream(ip)) {
+        target->setTileSize(size);
+    }
+}
+
+void HostVideoReceiver::addParticipant(const QString &ip)
+{
+    HostVideoReceiverWorker *target = worker;
+    QMetaObject::invokeMethod(worker, [target, ip]() { target->addParticipant(ip); }, Qt::QueuedConnection);
+}
+
+void HostVideoReceiver::removeParticipant(const QString &ip)
+{
+    HostVideoReceiverWorker *target = worker;
+    QMetaObject::invokeMethod(worker, [target, ip]() { target->removeParticipant(ip); }, Qt::QueuedConnection);
+}
+
+void HostVideoReceiver::addRecipient(const QString &ip)
+{
+    HostVideoReceiverWorker *target = worker;
+    QMetaObject::invokeMethod(worker, [target, ip]() { target->addRecipient(ip); }, Qt::QueuedConnection);
+}
+
+void HostVideoReceiver::setSubscriptions(const QString &ip, const QStringList &sources)
+{
+    HostVideoReceiverWorker *target = worker;
+    QMetaObject::invokeMethod(
+        worker, [target, ip, sources]() { target->setSubscriptions(ip, sources); }, Qt::QueuedConnection);
+}
+
+bool HostVideoReceiver::takeFrame(const QString &ip, QImage &image)
+{
+    const QSharedPointer<HostVideoStream> target = stream(ip);
+    return target && target->images.take(image);
+}
+
+QSharedPointer<HostVideoStream> HostVideoReceiver::stream(const QString &ip) const
+{
+    QMutexLocker locker(&streamsMutex);
+    return streams.value(ip);
+}
+
+#include "HostVideoReceiver.moc"
@@ -0,0 +1,131 @@
+#ifndef HOSTVIDEORECEIVER_H
+#define HOSTVIDEORECEIVER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+
+class HostVideoReceiverWorker;
+class HostVideoStream;
+
+// Guest video the host relays to other guests. The original datagram
+// (H.264 packet, JPEG or bare access unit) goes out unchanged behind a
+// small header naming the guest it came from:
+//
+//   marker (1) + source IPv4 (4, big-endian) + original datagram
+//
+// The marker differs from the first byte of every other video format.
+namespace VideoRelay {
+
+constexpr quint8 kMarker = 0xB3;
+constexpr int kHeaderSize = 1 + 4;
+
+QByteArray wrap(quint32 sourceIpv4, const QByteArray &datagram);
+// Returns false when `datagram` is not a relayed one.
+bool unwrap(const QByteArray &datagram, QString &sourceIp, QByteArray &payload);
+
+} // namespace VideoRelay
+
+// Host-side receiver for every guest's camera video.
+//
+// All guests send to one UDP port. A receive thread demultiplexes the
+// datagrams by sender IP into streams, and every stream has its own
+// H264Depacketizer, VideoDecoder and cached scaler (older guests send
+// JPEG, which is decoded the same way). Decoding runs on a thread pool
+// sized to the core count. A stream never has more than one decode job
+// in flight, so its pictures stay in order, while different senders
+// decode in parallel. Each picture is converted straight to its tile's
+// size and left in a per-sender latest-frame mailbox; frameReady() tells
+// the GUI, which collects it with takeFrame().
+//
+// With a forward port, the host also works as a selective forwarding
+// unit: every datagram from a guest is copied, without being decoded
+// again, to each recipient whose subscription includes that guest.
+// Only recipients are relayed, and never back to themselves. Guests run
+// the same class without forwarding on the forward port, where the streams
+// are keyed by the relayed source instead of the host's address.
+class HostVideoReceiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct StreamStats
+    {
+        QString id;
+        // Pictures decoded, and those converted and handed to the GUI.
+        quint64 frames = 0;
+        quint64 presented = 0;
+        // Access units the network lost, and complete ones discarded
+        // while waiting for a keyframe.
+        quint64 lost = 0;
+        quint64 skipped = 0;
+        // Dropped because the decode backlog overflowed, or replaced in
+        // the mailbox before the GUI painted them.
+        quint64 dropped = 0;
+        quint64 decodeErrors = 0;
+        // Since the last report: from a complete access unit to an image
+        // ready for painting.
+        double avgDecodeMs = 0.0;
+        double maxDecodeMs = 0.0;
+    };
+
+    explicit HostVideoReceiver(QObject *parent = nullptr);
+    ~HostVideoReceiver() override;
+
+    // forwardPort 0 turns forwarding off.
+    bool start(quint16 listenPort, quint16 forwardPort = 0);
+    // Waits for the receive thread and for running decode jobs.
+    void stop();
+    bool isRunning() const { return running.load(); }
+
+    // Size the sender's pictures are converted to, in device pixels.
+    void setTileSize(const QString &ip, const QSize &size);
+    // Video is accepted only from participants added here; datagrams
+    // from any other address never create a stream.
+    void addParticipant(const QString &ip);
+    // Forgets the participant both as a sender and as a recipient.
+    void removeParticipant(const QString &ip);
+    // Relays `ip`'s video to the other recipients, and theirs to it.
+    void addRecipient(const QString &ip);
+    // Guests whose video `ip` wants relayed. An empty list means every
+    // other guest.
+    void setSubscriptions(const QString &ip, const QStringList &sources);
+    // The newest picture of the sender, if there is one the GUI has not
+    // taken yet.
+    bool takeFrame(const QString &ip, QImage &image);
+
+signals:
+    // The sender's mailbox went from empty to full. Emitted from a
+    // decode thread.
+    void frameReady(const QString &ip);
+    void streamStatsUpdated(const QList<HostVideoReceiver::StreamStats> &stats);
+
+private:
+    friend class HostVideoReceiverWorker;
+    friend class HostVideoStream;
+
+    QSharedPointer<HostVideoStream> stream(const QString &ip) const;
+
+    QThread recvThread;
+    HostVideoReceiverWorker *worker;
+    QThreadPool decodePool;
+    // Timestamps for the decode latency; read from every thread.
+    QElapsedTimer clock;
+    // Written by the receive thread, read by the GUI.
+    mutable QMutex streamsMutex;
+    QHash<QString, QSharedPointer<HostVideoStream>> streams;
+    std::atomic<bool> running;
+};
+
+#endif // HOSTVIDEORECEIVER_H
@@ -10,13 +10,6 @@
 #include <QImage>
 #include <QSize>
 
-#ifdef USE_FFMPEG_H264
-extern "C" {
-#include <libavutil/frame.h>
-#include <libavutil/pixfmt.h>
-}
-#endif
-
 class MediaEngine : public QObject
 {
     Q_OBJECT
@@ -30,10 +23,11 @@ public:
 
     QImage convertFrame(const QVideoFrame &frame);
     QImage getCurrentFrame();
-
-#ifdef USE_FFMPEG_H264
-    bool prepareFrameForEncode(int targetWidth, int targetHeight, AVPixelFormat pixelFormat, AVFrame *&outFrame);
-#endif
+    // Size of the latest camera frame, without converting it.
+    QSize currentFrameSize() const;
+    // The latest camera frame itself; a shallow, thread-safe handle that
+    // can be mapped on another thread (see VideoFrameConverter).
+    QVideoFrame currentVideoFrame() const;
 
 private:
     QCamera *camera;
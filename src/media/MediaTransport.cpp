@@ -4,16 +4,25 @@
 #include <QHostAddress>
 #include <QImage>
 #include <QPixmap>
+#include <QRandomGenerator>
+#include <QThread>
 #include <QVBoxLayout>
 
 #ifdef USE_FFMPEG_H264
-extern "C" {
-#include <libswscale/swscale.h>
-}
+#include <atomic>
+#include <utility>
+
+#include "H264Packetizer.h"
+#include "VideoDecoder.h"
+#include "VideoEncoder.h"
+#include "VideoFrameConverter.h"
 #endif
 
 #include "MediaEngine.h"
+#include "common/Config.h"
+#include "common/LatestMailbox.h"
 #include "common/Logger.h"
+#include "common/TripleBuffer.h"
 
 namespace {
 constexpr double kTargetFrameIntervalMs = 1000.0 / 24.0;
@@ -53,6 +62,509 @@ QSize calculateEncodeSize(const QSize &source, const QSize &bound)
 #endif
 } // namespace
 
+#ifdef USE_FFMPEG_H264
+namespace {
+const QSize kEncodeBound(960, 540);
+const QSize kFallbackEncodeBound(720, 404);
+
+// Owns one AVFrame. Moving it hands over the frame; nothing is copied.
+class FrameHandle
+{
+public:
+    FrameHandle() = default;
+    explicit FrameHandle(AVFrame *frame)
+        : ptr(frame)
+    {
+    }
+    ~FrameHandle() { av_frame_free(&ptr); }
+
+    FrameHandle(FrameHandle &&other) noexcept
+        : ptr(other.ptr)
+    {
+        other.ptr = nullptr;
+    }
+    FrameHandle &operator=(FrameHandle &&other) noexcept
+    {
+        std::swap(ptr, other.ptr);
+        return *this;
+    }
+    FrameHandle(const FrameHandle &) = delete;
+    FrameHandle &operator=(const FrameHandle &) = delete;
+
+    AVFrame *get() const { return ptr; }
+
+private:
+    AVFrame *ptr = nullptr;
+};
+
+struct CapturedFrame
+{
+    QVideoFrame frame;
+    qint64 captureMs = 0;
+};
+
+struct ConvertedFrame
+{
+    FrameHandle frame;
+    qint64 captureMs = 0;
+};
+} // namespace
+
+class VideoConvertWorker;
+class VideoEncodeWorker;
+class VideoSendWorker;
+
+// Outgoing H.264 video, off the GUI thread, in three stages:
+//
+//   GUI tick -> [captured] -> convert -> [converted] -> encode -> send
+//
+// Each stage has its own thread, so converting frame N+1 overlaps with
+// encoding frame N, and sending never waits for either. The two
+// mailboxes are LatestMailbox slots, so when the encoder is slower than
+// the camera the frames in between are dropped at the mailbox rather
+// than delaying every later frame. Encoded packets reach the send
+// thread through a queued signal and are never dropped.
+//
+// Every frame is encoded once and the send stage writes its packets to
+// each destination, so a new receiver costs a keyframe, not an encoder.
+class VideoSendPipeline
+{
+public:
+    // Takes ownership of the (initialised) encoder.
+    VideoSendPipeline(VideoEncoder *encoder, const QStringList &destinations, quint16 remotePort);
+    ~VideoSendPipeline();
+
+    VideoSendPipeline(const VideoSendPipeline &) = delete;
+    VideoSendPipeline &operator=(const VideoSendPipeline &) = delete;
+
+    // Called on the GUI thread; never blocks on the encoder.
+    void submit(const QVideoFrame &frame, qint64 captureMs);
+    // Takes effect from the next packet on; call requestKeyframe() after
+    // adding a receiver so that it can start decoding.
+    void setDestinations(const QStringList &ips);
+    void requestKeyframe();
+    // Bounds the encoded size below the regular bound; an invalid size
+    // removes the limit. The encoder reopens at the new size with the
+    // next frame.
+    void setEncodeLimit(const QSize &limit);
+    QSize encodeBound() const;
+
+    LatestMailbox<CapturedFrame> captured;
+    LatestMailbox<ConvertedFrame> converted;
+    // Set by the encode stage when the encoder asks for a smaller bound,
+    // read by the convert stage.
+    std::atomic<bool> fallbackActive{false};
+    // Set on the GUI thread, consumed by the encode stage.
+    std::atomic<bool> keyframeRequested{false};
+    // Receiver-requested limit, written on the GUI thread; 0 = none.
+    std::atomic<int> limitWidth{0};
+    std::atomic<int> limitHeight{0};
+    std::atomic<quint64> encodedFrames{0};
+    std::atomic<quint64> sentPackets{0};
+
+    VideoConvertWorker *convertWorker;
+    VideoEncodeWorker *encodeWorker;
+    VideoSendWorker *sendWorker;
+
+private:
+    QThread convertThread;
+    QThread encodeThread;
+    QThread sendThread;
+};
+
+class VideoConvertWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit VideoConvertWorker(VideoSendPipeline *pipelineValue)
+        : pipeline(pipelineValue)
+    {
+    }
+
+public slots:
+    void process();
+
+private:
+    VideoSendPipeline *pipeline;
+    VideoFrameConverter converter;
+};
+
+class VideoEncodeWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    VideoEncodeWorker(VideoSendPipeline *pipelineValue, VideoEncoder *encoderValue)
+        : pipeline(pipelineValue)
+        , encoder(encoderValue)
+        , packetizer(Config::VIDEO_MAX_PAYLOAD_BYTES)
+        // Random per session, so a restarted sender is not taken for a late one.
+        , timestampBase(QRandomGenerator::global()->generate())
+    {
+    }
+    ~VideoEncodeWorker() override { delete encoder; }
+
+public slots:
+    void process();
+
+signals:
+    void packetsReady(const QVector<QByteArray> &datagrams);
+
+private:
+    VideoSendPipeline *pipeline;
+    VideoEncoder *encoder;
+    H264Packetizer packetizer;
+    quint32 timestampBase;
+};
+
+class VideoSendWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    VideoSendWorker(VideoSendPipeline *pipelineValue, const QStringList &ips, quint16 remotePortValue)
+        : pipeline(pipelineValue)
+        , socket(nullptr)
+        , remotePort(remotePortValue)
+    {
+        setDestinations(ips);
+    }
+
+public slots:
+    void sendPackets(const QVector<QByteArray> &datagrams);
+    void setDestinations(const QStringList &ips);
+
+private:
+    struct Destination
+    {
+        QString ip;
+        QHostAddress address;
+    };
+
+    VideoSendPipeline *pipeline;
+    // Created on first use so that it lives on the send thread.
+    QUdpSocket *socket;
+    QVector<Destination> destinations;
+    quint16 remotePort;
+};
+
+VideoSendPipeline::VideoSendPipeline(VideoEncoder *encoder, const QStringList &destinations, quint16 remotePort)
+    : convertWorker(new VideoConvertWorker(this))
+    , encodeWorker(new VideoEncodeWorker(this, encoder))
+    , sendWorker(new VideoSendWorker(this, destinations, remotePort))
+{
+    convertThread.setObjectName(QStringLiteral("VideoConvert"));
+    encodeThread.setObjectName(QStringLiteral("VideoEncode"));
+    sendThread.setObjectName(QStringLiteral("VideoSend"));
+
+    convertWorker->moveToThread(&convertThread);
+    encodeWorker->moveToThread(&encodeThread);
+    sendWorker->moveToThread(&sendThread);
+    QObject::connect(&convertThread, &QThread::finished, convertWorker, &QObject::deleteLater);
+    QObject::connect(&encodeThread, &QThread::finished, encodeWorker, &QObject::deleteLater);
+    QObject::connect(&sendThread, &QThread::finished, sendWorker, &QObject::deleteLater);
+    QObject::connect(encodeWorker, &VideoEncodeWorker::packetsReady, sendWorker, &VideoSendWorker::sendPackets);
+
+    sendThread.start(QThread::HighPriority);
+    encodeThread.start();
+    convertThread.start();
+}
+
+VideoSendPipeline::~VideoSendPipeline()
+{
+    // Upstream first, so no stage is handed work after its thread ended.
+    convertThread.quit();
+    convertThread.wait();
+    encodeThread.quit();
+    encodeThread.wait();
+    sendThread.quit();
+    sendThread.wait();
+}
+
+void VideoSendPipeline::submit(const QVideoFrame &frame, qint64 captureMs)
+{
+    CapturedFrame item;
+    item.frame = frame;
+    item.captureMs = captureMs;
+    if (captured.put(std::move(item))) {
+        QMetaObject::invokeMethod(convertWorker, &VideoConvertWorker::process, Qt::QueuedConnection);
+    }
+}
+
+void VideoSendPipeline::setDestinations(const QStringList &ips)
+{
+    // Queued on the send thread ahead of any packet encoded after this,
+    // so a keyframe requested next reaches the new destinations.
+    VideoSendWorker *worker = sendWorker;
+    QMetaObject::invokeMethod(worker, [worker, ips]() { worker->setDestinations(ips); }, Qt::QueuedConnection);
+}
+
+void VideoSendPipeline::requestKeyframe()
+{
+    keyframeRequested.store(true, std::memory_order_relaxed);
+}
+
+void VideoSendPipeline::setEncodeLimit(const QSize &limit)
+{
+    limitWidth.store(limit.isValid() ? limit.width() : 0, std::memory_order_relaxed);
+    limitHeight.store(limit.isValid() ? limit.height() : 0, std::memory_order_relaxed);
+}
+
+QSize VideoSendPipeline::encodeBound() const
+{
+    const QSize bound = fallbackActive.load(std::memory_order_relaxed) ? kFallbackEncodeBound : kEncodeBound;
+    const QSize limit(limitWidth.load(std::memory_order_relaxed), limitHeight.load(std::memory_order_relaxed));
+    return limit.isEmpty() ? bound : bound.boundedTo(limit);
+}
+
+void VideoConvertWorker::process()
+{
+    CapturedFrame input;
+    if (!pipeline->captured.take(input)) {
+        return;
+    }
+
+    const QSize encodeSize = calculateEncodeSize(input.frame.size(), pipeline->encodeBound());
+    AVFrame *yuvFrame = nullptr;
+    if (!converter.convert(input.frame, encodeSize.width(), encodeSize.height(), AV_PIX_FMT_YUV420P, yuvFrame)
+        || !yuvFrame) {
+        return;
+    }
+
+    ConvertedFrame output;
+    output.frame = FrameHandle(yuvFrame);
+    output.captureMs = input.captureMs;
+    if (pipeline->converted.put(std::move(output))) {
+        QMetaObject::invokeMethod(pipeline->encodeWorker, &VideoEncodeWorker::process, Qt::QueuedConnection);
+    }
+}
+
+void VideoEncodeWorker::process()
+{
+    ConvertedFrame input;
+    if (!pipeline->converted.take(input)) {
+        return;
+    }
+
+    if (pipeline->keyframeRequested.exchange(false, std::memory_order_relaxed)) {
+        encoder->requestKeyframe();
+    }
+
+    // encodeFrame() reopens the encoder itself when the size changed.
+    QByteArray packet;
+    if (!encoder->encodeFrame(input.frame.get(), packet) || packet.isEmpty()) {
+        LOG_WARN(QStringLiteral("MediaTransport: encoder produced empty packet"));
+    } else {
+        pipeline->encodedFrames.fetch_add(1, std::memory_order_relaxed);
+        QVector<QByteArray> datagrams;
+        // The timestamp follows capture time, not encode time, so the
+        // receiver's pacing is unaffected by encoder jitter.
+        const quint32 timestamp = timestampBase + quint32(input.captureMs * (H264Packet::kClockRate / 1000));
+        if (packetizer.packetize(packet, timestamp, datagrams)) {
+            emit packetsReady(datagrams);
+        } else {
+            LOG_WARN(QStringLiteral("MediaTransport: encoder output holds no NAL unit (size=%1)").arg(packet.size()));
+        }
+    }
+
+    if (encoder->fallbackRequested()) {
+        pipeline->fallbackActive.store(true, std::memory_order_relaxed);
+        encoder->clearFallbackRequest();
+        LOG_WARN(QStringLiteral("MediaTransport: switching to 720p fallback encode bound (%1x%2) after sustained load")
+                     .arg(kFallbackEncodeBound.width())
+                     .arg(kFallbackEncodeBound.height()));
+    }
+}
+
+void VideoSendWorker::sendPackets(const QVector<QByteArray> &datagrams)
+{
+    if (!socket) {
+        socket = new QUdpSocket(this);
+    }
+    for (const Destination &destination : std::as_const(destinations)) {
+        for (const QByteArray &datagram : datagrams) {
+            if (socket->writeDatagram(datagram, destination.address, remotePort) < 0) {
+                LOG_WARN(QStringLiteral("MediaTransport: failed to send H.264 packet to %1:%2 - %3")
+                             .arg(destination.ip)
+                             .arg(remotePort)
+                             .arg(socket->errorString()));
+                break;
+            }
+            pipeline->sentPackets.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void VideoSendWorker::setDestinations(const QStringList &ips)
+{
+    destinations.clear();
+    for (const QString &ip : ips) {
+        destinations.append({ip, QHostAddress(ip)});
+    }
+}
+
+struct ReceiveStats
+{
+    quint64 frames = 0;
+    quint64 lost = 0;
+    quint64 skipped = 0;
+    quint64 malformed = 0;
+    quint64 presented = 0;
+    bool waitingForKeyframe = true;
+};
+
+class VideoDecodeWorker;
+
+// Incoming H.264 video, off the GUI thread. The GUI hands over the
+// datagrams of each readyRead in one batch; the decode thread
+// reassembles and decodes every access unit (the decoder needs them all
+// as references), then converts only the newest picture, straight from
+// YUV to the size it will be painted at, with one cached swscale
+// context. The GUI thread is left with a QPixmap::fromImage per shown
+// frame, and a GUI that falls behind skips frames in the image mailbox.
+class VideoReceivePipeline
+{
+public:
+    // Takes ownership of the (initialised) decoder.
+    explicit VideoReceivePipeline(VideoDecoder *decoder);
+    ~VideoReceivePipeline();
+
+    VideoReceivePipeline(const VideoReceivePipeline &) = delete;
+    VideoReceivePipeline &operator=(const VideoReceivePipeline &) = delete;
+
+    // targetSize is the tile size in device pixels.
+    void submit(const QVector<QByteArray> &datagrams, const QSize &targetSize);
+
+    LatestMailbox<QImage> images;
+    TripleBuffer<ReceiveStats> stats;
+
+    VideoDecodeWorker *decodeWorker;
+
+private:
+    QThread decodeThread;
+};
+
+class VideoDecodeWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    VideoDecodeWorker(VideoReceivePipeline *pipelineValue, VideoDecoder *decoderValue)
+        : pipeline(pipelineValue)
+        , decoder(decoderValue)
+        , decoded(av_frame_alloc())
+        , latest(av_frame_alloc())
+        , presented(0)
+    {
+    }
+    ~VideoDecodeWorker() override
+    {
+        av_frame_free(&decoded);
+        av_frame_free(&latest);
+        delete decoder;
+    }
+
+public slots:
+    void decodeDatagrams(const QVector<QByteArray> &datagrams, const QSize &targetSize);
+
+signals:
+    // The image mailbox went from empty to full.
+    void frameReady();
+
+private:
+    bool decode(const QByteArray &accessUnit);
+    void present(const QSize &targetSize);
+
+    VideoReceivePipeline *pipeline;
+    VideoDecoder *decoder;
+    H264Depacketizer depacketizer;
+    DecodedFrameScaler scaler;
+    AVFrame *decoded;
+    AVFrame *latest;
+    quint64 presented;
+};
+
+VideoReceivePipeline::VideoReceivePipeline(VideoDecoder *decoder)
+    : decodeWorker(new VideoDecodeWorker(this, decoder))
+{
+    decodeThread.setObjectName(QStringLiteral("VideoDecode"));
+    decodeWorker->moveToThread(&decodeThread);
+    QObject::connect(&decodeThread, &QThread::finished, decodeWorker, &QObject::deleteLater);
+    decodeThread.start();
+}
+
+VideoReceivePipeline::~VideoReceivePipeline()
+{
+    decodeThread.quit();
+    decodeThread.wait();
+}
+
+void VideoReceivePipeline::submit(const QVector<QByteArray> &datagrams, const QSize &targetSize)
+{
+    VideoDecodeWorker *worker = decodeWorker;
+    QMetaObject::invokeMethod(
+        worker, [worker, datagrams, targetSize]() { worker->decodeDatagrams(datagrams, targetSize); }, Qt::QueuedConnection);
+}
+
+void VideoDecodeWorker::decodeDatagrams(const QVector<QByteArray> &datagrams, const QSize &targetSize)
+{
+    bool haveNew = false;
+    for (const QByteArray &datagram : datagrams) {
+        if (H264Packet::isPacketized(datagram)) {
+            QByteArray accessUnit;
+            if (depacketizer.push(datagram, accessUnit)) {
+                haveNew = decode(accessUnit) || haveNew;
+            }
+        } else {
+            // Older senders put a whole access unit in each datagram.
+            haveNew = decode(datagram) || haveNew;
+        }
+    }
+    if (haveNew) {
+        present(targetSize);
+    }
+
+    ReceiveStats &snapshot = pipeline->stats.writeSlot();
+    snapshot.frames = depacketizer.completedFrames();
+    snapshot.lost = depacketizer.lostFrames();
+    snapshot.skipped = depacketizer.skippedFrames();
+    snapshot.malformed = depacketizer.malformedPackets();
+    snapshot.presented = presented;
+    snapshot.waitingForKeyframe = depacketizer.waitingForKeyframe();
+    pipeline->stats.publish();
+}
+
+bool VideoDecodeWorker::decode(const QByteArray &accessUnit)
+{
+    // A failed decode clears its output frame, so decode into a scratch
+    // frame and keep the last good picture in `latest`.
+    if (!decoder->decodePacket(accessUnit, decoded)) {
+        LOG_WARN(QStringLiteral("MediaTransport: failed to decode H.264 packet (size=%1)").arg(accessUnit.size()));
+        return false;
+    }
+    av_frame_unref(latest);
+    av_frame_move_ref(latest, decoded);
+    return true;
+}
+
+void VideoDecodeWorker::present(const QSize &targetSize)
+{
+    QImage image = scaler.toImage(latest, targetSize);
+    if (image.isNull()) {
+        LOG_WARN(QStringLiteral("MediaTransport: failed to convert decoded frame to %1x%2")
+                     .arg(targetSize.width())
+                     .arg(targetSize.height()));
+        return;
+    }
+
+    ++presented;
+    if (pipeline->images.put(std::move(image))) {
+        emit frameReady();
+    }
+}
+#endif
+
 MediaTransport::MediaTransport(MediaEngine *engine, QObject *parent)
     : QObject(parent)
     , udpSendSocket(new QUdpSocket(this))
@@ -60,20 +572,17 @@ MediaTransport::MediaTransport(MediaEngine *engine, QObject *parent)
     , sendTimer(new QTimer(this))
     , sendClock()
     , lastSendMs(0)
-    , remoteIp()
+    , encodeLimit()
+    , maxSendFps(0)
+    , destinations()
     , localPort(0)
     , remotePort(0)
     , remoteVideoLabel(new QLabel)
     , remoteVideoWidget(new QWidget)
     , media(engine)
 #ifdef USE_FFMPEG_H264
-    , encoder(nullptr)
-    , decoder(nullptr)
-    , videoWidth(0)
-    , videoHeight(0)
-    , activeEncodeBound(960, 540)
-    , fallbackEncodeBound(720, 404)
-    , fallbackActive(false)
+    , sendPipeline(nullptr)
+    , receivePipeline(nullptr)
 #endif
 {
     // Enforce ~24 FPS pacing for outgoing video.
@@ -101,8 +610,8 @@ bool MediaTransport::startTransport(quint16 localPortValue, const QString &remot
     stopTransport();
 
     localPort = localPortValue;
-    remoteIp = remoteIpValue;
     remotePort = remotePortValue;
+    destinations = {remoteIpValue};
     lastSendMs = 0;
     sendClock.invalidate();
     sendClock.start();
@@ -117,30 +626,19 @@ bool MediaTransport::startTransport(quint16 localPortValue, const QString &remot
     connect(udpRecvSocket, &QUdpSocket::readyRead, this, &MediaTransport::onReadyRead);
 
 #ifdef USE_FFMPEG_H264
-    fallbackActive = false;
     if (media) {
-        const QImage frame = media->getCurrentFrame();
-        const QSize sourceSize = frame.isNull() ? QSize(640, 480) : frame.size();
-        const QSize encodeSize = calculateEncodeSize(sourceSize, activeEncodeBound);
-        videoWidth = encodeSize.width();
-        videoHeight = encodeSize.height();
-
-        if (!encoder) {
-            encoder = new VideoEncoder();
-            if (!encoder->init(videoWidth, videoHeight, AV_PIX_FMT_YUV420P)) {
-                LOG_WARN(QStringLiteral("MediaTransport: failed to initialize H.264 encoder, falling back to JPEG transport"));
-                delete encoder;
-                encoder = nullptr;
-            }
-        }
-
-        if (!decoder) {
-            decoder = new VideoDecoder();
-            if (!decoder->init()) {
-                LOG_WARN(QStringLiteral("MediaTransport: failed to initialize H.264 decoder, falling back to JPEG transport"));
-                delete decoder;
-                decoder = nullptr;
-            }
+        startSendPipeline();
+
+        auto *decoder = new VideoDecoder();
+        if (decoder->init()) {
+            receivePipeline = new VideoReceivePipeline(decoder);
+            connect(receivePipeline->decodeWorker,
+                    &VideoDecodeWorker::frameReady,
+                    this,
+                    &MediaTransport::onRemoteFrameReady);
+        } else {
+            LOG_WARN(QStringLiteral("MediaTransport: failed to initialize H.264 decoder, falling back to JPEG transport"));
+            delete decoder;
         }
     }
 #endif
@@ -164,29 +662,15 @@ bool MediaTransport::startSendOnly(const QString &remoteIpValue, quint16 remoteP
     stopTransport();
 
     localPort = 0;
-    remoteIp = remoteIpValue;
     remotePort = remotePortValue;
+    destinations = {remoteIpValue};
     lastSendMs = 0;
     sendClock.invalidate();
     sendClock.start();
 
 #ifdef USE_FFMPEG_H264
-    fallbackActive = false;
     if (media) {
-        const QImage frame = media->getCurrentFrame();
-        const QSize sourceSize = frame.isNull() ? QSize(640, 480) : frame.size();
-        const QSize encodeSize = calculateEncodeSize(sourceSize, activeEncodeBound);
-        videoWidth = encodeSize.width();
-        videoHeight = encodeSize.height();
-
-        if (!encoder) {
-            encoder = new VideoEncoder();
-            if (!encoder->init(videoWidth, videoHeight, AV_PIX_FMT_YUV420P)) {
-                LOG_WARN(QStringLiteral("MediaTransport: failed to initialize H.264 encoder for send-only mode, falling back to JPEG transport"));
-                delete encoder;
-                encoder = nullptr;
-            }
-        }
+        startSendPipeline();
     }
 #endif
 
@@ -211,20 +695,19 @@ void MediaTransport::stopTransport()
     udpRecvSocket->disconnect(this);
 
 #ifdef USE_FFMPEG_H264
-    delete encoder;
-    encoder = nullptr;
-    delete decoder;
-    decoder = nullptr;
-    videoWidth = 0;
-    videoHeight = 0;
-    activeEncodeBound = QSize(960, 540);
-    fallbackActive = false;
+    // Joins the pipeline threads; frames still in the mailboxes are dropped.
+    delete sendPipeline;
+    sendPipeline = nullptr;
+    delete receivePipeline;
+    receivePipeline = nullptr;
 #endif
 
     // 重置端口与地址，避免下次启动时误用旧状态。
     localPort = 0;
     remotePort = 0;
-    remoteIp.clear();
+    destinations.clear();
+    encodeLimit = QSize();
+    maxSendFps = 0;
 
     // 恢复远端视频区域的占位画面，避免停会/断线后停留在最后一帧。
     if (remoteVideoLabel) {
@@ -233,6 +716,38 @@ void MediaTransport::stopTransport()
     }
 }
 
+void MediaTransport::setDestinations(const QSet<QString> &ips)
+{
+    if (!sendTimer->isActive()) {
+        return;
+    }
+    const bool added = !(ips - destinations).isEmpty();
+    destinations = ips;
+#ifdef USE_FFMPEG_H264
+    if (sendPipeline) {
+        sendPipeline->setDestinations(destinations.values());
+        // Newcomers cannot decode until the next IDR picture; do not make
+        // them wait for the regular one.
+        if (added) {
+            sendPipeline->requestKeyframe();
+        }
+    }
+#else
+    Q_UNUSED(added);
+#endif
+}
+
+void MediaTransport::setEncodeLimit(const QSize &maxSize, int maxFps)
+{
+    encodeLimit = maxSize;
+    maxSendFps = qMax(0, maxFps);
+#ifdef USE_FFMPEG_H264
+    if (sendPipeline) {
+        sendPipeline->setEncodeLimit(encodeLimit);
+    }
+#endif
+}
+
 QWidget *MediaTransport::getRemoteVideoWidget()
 {
     return remoteVideoWidget;
@@ -242,15 +757,36 @@ void MediaTransport::logDiagnostics() const
 {
     LOG_INFO(QStringLiteral("VideoNet diag: localPort=%1 remote=%2:%3 recvOpen=%4 sendOpen=%5")
                  .arg(localPort)
-                 .arg(remoteIp)
+                 .arg(QStringList(destinations.values()).join(QLatin1Char(',')))
                  .arg(remotePort)
                  .arg(udpRecvSocket && udpRecvSocket->isOpen())
                  .arg(udpSendSocket && udpSendSocket->isOpen()));
+#ifdef USE_FFMPEG_H264
+    if (sendPipeline) {
+        LOG_INFO(QStringLiteral("VideoNet h264 send: encoded=%1 sentPackets=%2 droppedBeforeConvert=%3 droppedBeforeEncode=%4 fallback=%5")
+                     .arg(sendPipeline->encodedFrames.load(std::memory_order_relaxed))
+                     .arg(sendPipeline->sentPackets.load(std::memory_order_relaxed))
+                     .arg(sendPipeline->captured.droppedCount())
+                     .arg(sendPipeline->converted.droppedCount())
+                     .arg(sendPipeline->fallbackActive.load(std::memory_order_relaxed)));
+    }
+    if (receivePipeline) {
+        const ReceiveStats &stats = receivePipeline->stats.read();
+        LOG_INFO(QStringLiteral("VideoNet h264 recv: frames=%1 presented=%2 lost=%3 skipped=%4 malformed=%5 waitingKeyframe=%6 droppedBeforePaint=%7")
+                     .arg(stats.frames)
+                     .arg(stats.presented)
+                     .arg(stats.lost)
+                     .arg(stats.skipped)
+                     .arg(stats.malformed)
+                     .arg(stats.waitingForKeyframe)
+                     .arg(receivePipeline->images.droppedCount()));
+    }
+#endif
 }
 
 void MediaTransport::onSendTimer()
 {
-    if (!media || remoteIp.isEmpty() || remotePort == 0) {
+    if (!media || destinations.isEmpty() || remotePort == 0) {
         return;
     }
 
@@ -259,69 +795,32 @@ void MediaTransport::onSendTimer()
     }
 
     const qint64 nowMs = sendClock.elapsed();
-    const qint64 minIntervalMs = static_cast<qint64>(kTargetFrameIntervalMs);
-    const qint64 lateIntervalMs = static_cast<qint64>(kTargetFrameIntervalMs * 1.5);
-    if (lastSendMs > 0) {
-        const qint64 delta = nowMs - lastSendMs;
-        if (delta < minIntervalMs) {
-            return;
-        }
-        if (delta > lateIntervalMs) {
-            lastSendMs = nowMs;
-            return;
-        }
+    qint64 minIntervalMs = static_cast<qint64>(kTargetFrameIntervalMs);
+    if (maxSendFps > 0) {
+        minIntervalMs = qMax(minIntervalMs, qint64(1000 / maxSendFps));
     }
-    lastSendMs = nowMs;
-
-    const QImage frame = media->getCurrentFrame();
-    if (frame.isNull()) {
+    if (lastSendMs > 0 && nowMs - lastSendMs < minIntervalMs) {
         return;
     }
+    lastSendMs = nowMs;
 
 #ifdef USE_FFMPEG_H264
-    if (encoder && videoWidth > 0 && videoHeight > 0) {
-        const QSize sourceSize = frame.size().isValid() ? frame.size() : QSize(videoWidth, videoHeight);
-        const QSize bound = fallbackActive ? fallbackEncodeBound : activeEncodeBound;
-        const QSize encodeSize = calculateEncodeSize(sourceSize, bound);
-        AVFrame *yuvFrame = nullptr;
-        if (!media->prepareFrameForEncode(encodeSize.width(), encodeSize.height(), AV_PIX_FMT_YUV420P, yuvFrame) || !yuvFrame) {
-            return;
-        }
-
-        if (yuvFrame->width != videoWidth || yuvFrame->height != videoHeight) {
-            videoWidth = yuvFrame->width;
-            videoHeight = yuvFrame->height;
-            encoder->reinit(videoWidth, videoHeight, AV_PIX_FMT_YUV420P);
+    if (sendPipeline) {
+        // Only hands the frame over; a late tick still sends its frame,
+        // and a slow encoder drops frames at the mailbox instead.
+        const QVideoFrame frame = media->currentVideoFrame();
+        if (frame.isValid()) {
+            sendPipeline->submit(frame, nowMs);
         }
-
-        QByteArray packet;
-        const bool encoded = encoder->encodeFrame(yuvFrame, packet);
-        av_frame_free(&yuvFrame);
-
-        if (encoded && !packet.isEmpty()) {
-            const qint64 written = udpSendSocket->writeDatagram(packet, QHostAddress(remoteIp), remotePort);
-            if (written < 0) {
-                LOG_WARN(QStringLiteral("MediaTransport: failed to send H.264 packet to %1:%2 - %3")
-                             .arg(remoteIp)
-                             .arg(remotePort)
-                             .arg(udpSendSocket->errorString()));
-            }
-        } else {
-            LOG_WARN(QStringLiteral("MediaTransport: encoder produced empty packet"));
-        }
-
-        if (encoder->fallbackRequested()) {
-            fallbackActive = true;
-            encoder->clearFallbackRequest();
-            LOG_WARN(QStringLiteral("MediaTransport: switching to 720p fallback encode bound (%1x%2) after sustained load")
-                         .arg(fallbackEncodeBound.width())
-                         .arg(fallbackEncodeBound.height()));
-        }
-
         return;
     }
 #endif
 
+    const QImage frame = media->getCurrentFrame();
+    if (frame.isNull()) {
+        return;
+    }
+
     QByteArray buffer;
     QBuffer qBuffer(&buffer);
     qBuffer.open(QIODevice::WriteOnly);
@@ -330,18 +829,23 @@ void MediaTransport::onSendTimer()
     }
 
     if (!buffer.isEmpty()) {
-        const qint64 written = udpSendSocket->writeDatagram(buffer, QHostAddress(remoteIp), remotePort);
-        if (written < 0) {
-            LOG_WARN(QStringLiteral("MediaTransport: failed to send JPEG frame to %1:%2 - %3")
-                         .arg(remoteIp)
-                         .arg(remotePort)
-                         .arg(udpSendSocket->errorString()));
+        for (const QString &ip : std::as_const(destinations)) {
+            const qint64 written = udpSendSocket->writeDatagram(buffer, QHostAddress(ip), remotePort);
+            if (written < 0) {
+                LOG_WARN(QStringLiteral("MediaTransport: failed to send JPEG frame to %1:%2 - %3")
+                             .arg(ip)
+                             .arg(remotePort)
+                             .arg(udpSendSocket->errorString()));
+            }
         }
     }
 }
 
 void MediaTransport::onReadyRead()
 {
+#ifdef USE_FFMPEG_H264
+    QVector<QByteArray> h264Datagrams;
+#endif
     while (udpRecvSocket->hasPendingDatagrams()) {
         QByteArray datagram;
         const qint64 pendingSize = udpRecvSocket->pendingDatagramSize();
@@ -369,67 +873,8 @@ void MediaTransport::onReadyRead()
         }
 
 #ifdef USE_FFMPEG_H264
-        if (decoder && !datagram.isEmpty()) {
-            AVFrame *frame = av_frame_alloc();
-            if (!frame) {
-                continue;
-            }
-
-            if (decoder->decodePacket(datagram, frame)) {
-                SwsContext *swsCtx = sws_getContext(frame->width,
-                                                    frame->height,
-                                                    static_cast<AVPixelFormat>(frame->format),
-                                                    frame->width,
-                                                    frame->height,
-                                                    AV_PIX_FMT_RGBA,
-                                                    SWS_BILINEAR,
-                                                    nullptr,
-                                                    nullptr,
-                                                    nullptr);
-                if (swsCtx) {
-                    QImage image(frame->width, frame->height, QImage::Format_RGBA8888);
-
-                    uint8_t *dstData[4] = { image.bits(), nullptr, nullptr, nullptr };
-                    int dstLinesize[4] = { frame->width * 4, 0, 0, 0 };
-
-                    sws_scale(swsCtx,
-                              frame->data,
-                              frame->linesize,
-                              0,
-                              frame->height,
-                              dstData,
-                              dstLinesize);
-
-                    sws_freeContext(swsCtx);
-
-                    if (!image.isNull()) {
-                        const QSize target = remoteVideoLabel->size();
-                        const QSize native = image.size();
-                        QSize scaledSize = native;
-                        if (!target.isEmpty() && native.isValid()) {
-                            QSize fit = native.scaled(target, Qt::KeepAspectRatio);
-                            const double scaleFactor = qMin(1.0,
-                                                            qMin(double(fit.width()) / double(native.width()),
-                                                                 double(fit.height()) / double(native.height())));
-                            scaledSize = QSize(int(native.width() * scaleFactor),
-                                               int(native.height() * scaleFactor));
-                        }
-                        QPixmap pix = QPixmap::fromImage(image).scaled(scaledSize,
-                                                                       Qt::KeepAspectRatio,
-                                                                       Qt::SmoothTransformation);
-                        remoteVideoLabel->setPixmap(pix);
-                        emit remoteFrameReceived();
-                    } else {
-                        LOG_WARN(QStringLiteral("MediaTransport: decoded frame produced null image"));
-                    }
-                } else {
-                    LOG_WARN(QStringLiteral("MediaTransport: failed to create sws context for decoded frame"));
-                }
-            } else {
-                LOG_WARN(QStringLiteral("MediaTransport: failed to decode H.264 packet (size=%1)").arg(datagram.size()));
-            }
-
-            av_frame_free(&frame);
+        if (receivePipeline) {
+            h264Datagrams.append(datagram);
             continue;
         }
 #endif
@@ -459,4 +904,47 @@ void MediaTransport::onReadyRead()
             emit remoteFrameReceived();
         }
     }
+
+#ifdef USE_FFMPEG_H264
+    if (!h264Datagrams.isEmpty()) {
+        // Decoded pictures are converted straight to the label's size in
+        // device pixels.
+        const qreal dpr = remoteVideoLabel->devicePixelRatioF();
+        const QSize target = remoteVideoLabel->size() * dpr;
+        receivePipeline->submit(h264Datagrams, target);
+    }
+#endif
 }
+
+#ifdef USE_FFMPEG_H264
+void MediaTransport::startSendPipeline()
+{
+    const QSize frameSize = media->currentFrameSize();
+    const QSize sourceSize = frameSize.isValid() ? frameSize : QSize(640, 480);
+    const QSize bound = encodeLimit.isEmpty() ? kEncodeBound : kEncodeBound.boundedTo(encodeLimit);
+    const QSize encodeSize = calculateEncodeSize(sourceSize, bound);
+
+    auto *encoder = new VideoEncoder();
+    if (!encoder->init(encodeSize.width(), encodeSize.height(), AV_PIX_FMT_YUV420P)) {
+        LOG_WARN(QStringLiteral("MediaTransport: failed to initialize H.264 encoder, falling back to JPEG transport"));
+        delete encoder;
+        return;
+    }
+    sendPipeline = new VideoSendPipeline(encoder, destinations.values(), remotePort);
+    sendPipeline->setEncodeLimit(encodeLimit);
+}
+
+void MediaTransport::onRemoteFrameReady()
+{
+    QImage image;
+    if (!receivePipeline || !receivePipeline->images.take(image)) {
+        return;
+    }
+    // Already at the label's size; only the upload to a pixmap is left.
+    image.setDevicePixelRatio(remoteVideoLabel->devicePixelRatioF());
+    remoteVideoLabel->setPixmap(QPixmap::fromImage(std::move(image)));
+    emit remoteFrameReceived();
+}
+#endif
+
+#include "MediaTransport.moc"
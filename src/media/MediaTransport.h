@@ -4,17 +4,15 @@
 #include <QObject>
 #include <QUdpSocket>
 #include <QTimer>
+#include <QSet>
 #include <QString>
 #include <QLabel>
 #include <QElapsedTimer>
 #include <QSize>
 
-#ifdef USE_FFMPEG_H264
-#include "media/VideoEncoder.h"
-#include "media/VideoDecoder.h"
-#endif
-
 class MediaEngine;
+class VideoReceivePipeline;
+class VideoSendPipeline;
 
 class MediaTransport : public QObject
 {
@@ -28,6 +26,16 @@ public:
     // Send-only mode: used when we only need to push local video to a remote
     // endpoint without receiving remote video on this transport instance.
     bool startSendOnly(const QString &remoteIp, quint16 remotePort);
+    // Replaces the set of peers outgoing video is sent to, without
+    // restarting the encoder: every frame is encoded once and sent to all
+    // of them, and peers new to the set get a keyframe right away.
+    // Only while the transport is running.
+    void setDestinations(const QSet<QString> &ips);
+    // Caps outgoing video at what the receiver will display: frames are
+    // encoded no larger than maxSize and sent no faster than maxFps. An
+    // invalid size or 0 fps lifts that part of the cap. Cleared by
+    // stopTransport().
+    void setEncodeLimit(const QSize &maxSize, int maxFps);
     void stopTransport();
     void logDiagnostics() const;
 
@@ -41,15 +49,26 @@ signals:
 private slots:
     void onSendTimer();
     void onReadyRead();
+#ifdef USE_FFMPEG_H264
+    void onRemoteFrameReady();
+#endif
 
 private:
+#ifdef USE_FFMPEG_H264
+    // Starts the encode threads; leaves sendPipeline null (JPEG) when no
+    // H.264 encoder can be opened.
+    void startSendPipeline();
+#endif
+
     QUdpSocket *udpSendSocket;
     QUdpSocket *udpRecvSocket;
     QTimer *sendTimer;
     QElapsedTimer sendClock;
     qint64 lastSendMs;
+    QSize encodeLimit;
+    int maxSendFps;
 
-    QString remoteIp;
+    QSet<QString> destinations;
     quint16 localPort;
     quint16 remotePort;
 
@@ -59,13 +78,11 @@ private:
     MediaEngine *media;
 
 #ifdef USE_FFMPEG_H264
-    VideoEncoder *encoder;
-    VideoDecoder *decoder;
-    int videoWidth;
-    int videoHeight;
-    QSize activeEncodeBound;
-    QSize fallbackEncodeBound;
-    bool fallbackActive;
+    // Converts, encodes, packetizes and sends camera frames off the GUI
+    // thread; see MediaTransport.cpp.
+    VideoSendPipeline *sendPipeline;
+    // Reassembles, decodes and scales remote video off the GUI thread.
+    VideoReceivePipeline *receivePipeline;
 #endif
 };
 
@@ -14,6 +14,7 @@ VideoEncoder::VideoEncoder()
     , height(0)
     , pixFmt(AV_PIX_FMT_YUV420P)
     , ptsCounter(0)
+    , forceKeyframe(false)
     , preset("medium")
     , crfValue(22)
     , targetFrameIntervalMs(1000.0 / 24.0)
@@ -71,6 +72,9 @@ bool VideoEncoder::encodeFrame(AVFrame *frame, QByteArray &outPacket)
 
     if (frame) {
         frame->pts = ptsCounter++;
+        // The frame buffer is reused, so clear the type after a forced one.
+        frame->pict_type = forceKeyframe ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+        forceKeyframe = false;
     }
 
     QElapsedTimer encodeTimer;
@@ -100,6 +104,11 @@ bool VideoEncoder::encodeFrame(AVFrame *frame, QByteArray &outPacket)
     return !outPacket.isEmpty();
 }
 
+void VideoEncoder::requestKeyframe()
+{
+    forceKeyframe = true;
+}
+
 void VideoEncoder::flush(QList<QByteArray> &outPackets)
 {
     if (!ctx || !pkt) {
@@ -192,6 +201,8 @@ bool VideoEncoder::openContext(const std::string &presetOverride, int crfOverrid
 
     av_opt_set(newCtx->priv_data, "preset", presetToUse.c_str(), 0);
     av_opt_set(newCtx->priv_data, "tune", "zerolatency", 0);
+    // A forced I picture must be an IDR, or a new receiver cannot start on it.
+    av_opt_set(newCtx->priv_data, "forced-idr", "1", 0);
     av_opt_set_int(newCtx->priv_data, "crf", crfToUse, 0);
 
     if (avcodec_open2(newCtx, codec, nullptr) < 0) {
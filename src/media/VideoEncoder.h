@@ -24,6 +24,9 @@ public:
     bool reinit(int width, int height, AVPixelFormat pixFmt = AV_PIX_FMT_YUV420P);
     bool encodeFrame(AVFrame *frame, QByteArray &outPacket);
     void flush(QList<QByteArray> &outPackets);
+    // Makes the next encoded frame an IDR picture, e.g. for a receiver
+    // that has just joined.
+    void requestKeyframe();
 
     QSize encodeSize() const;
     bool fallbackRequested() const;
@@ -42,6 +45,7 @@ private:
     int height;
     AVPixelFormat pixFmt;
     int64_t ptsCounter;
+    bool forceKeyframe;
 
     std::string preset;
     int crfValue;
@@ -0,0 +1,290 @@
+#include "VideoFrameConverter.h"
+
+#ifdef USE_FFMPEG_H264
+
+#include <QImage>
+
+extern "C" {
+#include <libswscale/swscale.h>
+#include <libavutil/buffer.h>
+#include <libavutil/imgutils.h>
+}
+
+namespace {
+// Largest even size with the source's aspect ratio that fits the
+// requested one, never upscaling.
+QSize fitEncodeSize(const QSize &source, const QSize &requested)
+{
+    QSize target = source;
+    if (source.isValid() && requested.isValid()) {
+        target = source.scaled(requested, Qt::KeepAspectRatio);
+    }
+    target.setWidth(qMin(target.width(), source.width()));
+    target.setHeight(qMin(target.height(), source.height()));
+
+    // Ensure dimensions are even for YUV420P.
+    if (target.width() % 2 != 0) {
+        target.rwidth() -= 1;
+    }
+    if (target.height() % 2 != 0) {
+        target.rheight() -= 1;
+    }
+    return target;
+}
+
+// Byte-order names on both sides. YV12 is I420 with the chroma planes
+// swapped, which wrapFrame() undoes by swapping the pointers.
+AVPixelFormat toAvPixelFormat(QVideoFrameFormat::PixelFormat format)
+{
+    switch (format) {
+    case QVideoFrameFormat::Format_NV12:
+        return AV_PIX_FMT_NV12;
+    case QVideoFrameFormat::Format_NV21:
+        return AV_PIX_FMT_NV21;
+    case QVideoFrameFormat::Format_YUV420P:
+    case QVideoFrameFormat::Format_YV12:
+        return AV_PIX_FMT_YUV420P;
+    case QVideoFrameFormat::Format_YUV422P:
+        return AV_PIX_FMT_YUV422P;
+    case QVideoFrameFormat::Format_YUYV:
+        return AV_PIX_FMT_YUYV422;
+    case QVideoFrameFormat::Format_UYVY:
+        return AV_PIX_FMT_UYVY422;
+    case QVideoFrameFormat::Format_Y8:
+        return AV_PIX_FMT_GRAY8;
+    case QVideoFrameFormat::Format_ARGB8888:
+        return AV_PIX_FMT_ARGB;
+    case QVideoFrameFormat::Format_XRGB8888:
+        return AV_PIX_FMT_0RGB;
+    case QVideoFrameFormat::Format_BGRA8888:
+        return AV_PIX_FMT_BGRA;
+    case QVideoFrameFormat::Format_BGRX8888:
+        return AV_PIX_FMT_BGR0;
+    case QVideoFrameFormat::Format_ABGR8888:
+        return AV_PIX_FMT_ABGR;
+    case QVideoFrameFormat::Format_XBGR8888:
+        return AV_PIX_FMT_0BGR;
+    case QVideoFrameFormat::Format_RGBA8888:
+        return AV_PIX_FMT_RGBA;
+    case QVideoFrameFormat::Format_RGBX8888:
+        return AV_PIX_FMT_RGB0;
+    default:
+        return AV_PIX_FMT_NONE;
+    }
+}
+
+// Frees the AVBuffer standing for a mapped QVideoFrame.
+void releaseMappedFrame(void *opaque, uint8_t *data)
+{
+    Q_UNUSED(data);
+    QVideoFrame *frame = static_cast<QVideoFrame *>(opaque);
+    frame->unmap();
+    delete frame;
+}
+} // namespace
+
+VideoFrameConverter::VideoFrameConverter()
+    : encodeScaler(nullptr)
+    , encodeFrame(nullptr)
+{
+}
+
+VideoFrameConverter::~VideoFrameConverter()
+{
+    sws_freeContext(encodeScaler);
+    av_frame_free(&encodeFrame);
+}
+
+AVFrame *VideoFrameConverter::wrapFrame(const QVideoFrame &frame)
+{
+    const AVPixelFormat format = toAvPixelFormat(frame.pixelFormat());
+    if (format == AV_PIX_FMT_NONE) {
+        return nullptr;
+    }
+
+    // A copy shares the frame's buffer and can stay mapped for as long
+    // as the encoder holds on to the AVFrame, while the camera moves on.
+    QVideoFrame *mapped = new QVideoFrame(frame);
+    if (!mapped->map(QVideoFrame::ReadOnly)) {
+        delete mapped;
+        return nullptr;
+    }
+
+    AVFrame *wrapped = av_frame_alloc();
+    if (!wrapped) {
+        releaseMappedFrame(mapped, nullptr);
+        return nullptr;
+    }
+    wrapped->format = format;
+    wrapped->width = mapped->width();
+    wrapped->height = mapped->height();
+    for (int plane = 0; plane < mapped->planeCount() && plane < AV_NUM_DATA_POINTERS; ++plane) {
+        wrapped->data[plane] = mapped->bits(plane);
+        wrapped->linesize[plane] = mapped->bytesPerLine(plane);
+    }
+    if (frame.pixelFormat() == QVideoFrameFormat::Format_YV12) {
+        qSwap(wrapped->data[1], wrapped->data[2]);
+        qSwap(wrapped->linesize[1], wrapped->linesize[2]);
+    }
+
+    // Ties the mapping to the AVFrame's reference count: the last unref
+    // unmaps and frees the copy.
+    wrapped->buf[0] = av_buffer_create(mapped->bits(0),
+                                       size_t(mapped->mappedBytes(0)),
+                                       releaseMappedFrame,
+                                       mapped,
+                                       AV_BUFFER_FLAG_READONLY);
+    if (!wrapped->buf[0]) {
+        av_frame_free(&wrapped);
+        releaseMappedFrame(mapped, nullptr);
+        return nullptr;
+    }
+    return wrapped;
+}
+
+bool VideoFrameConverter::convert(const QVideoFrame &frame,
+                                  int targetWidth,
+                                  int targetHeight,
+                                  AVPixelFormat pixelFormat,
+                                  AVFrame *&outFrame)
+{
+    outFrame = nullptr;
+    if (targetWidth <= 0 || targetHeight <= 0 || !frame.isValid()) {
+        return false;
+    }
+
+    AVFrame *source = wrapFrame(frame);
+    QImage fallbackImage;
+    if (!source) {
+        // MJPEG and other layouts that have no planes to map.
+        fallbackImage = QVideoFrame(frame).toImage().convertToFormat(QImage::Format_RGBA8888);
+        if (fallbackImage.isNull()) {
+            return false;
+        }
+        source = av_frame_alloc();
+        if (!source) {
+            return false;
+        }
+        source->format = AV_PIX_FMT_RGBA;
+        source->width = fallbackImage.width();
+        source->height = fallbackImage.height();
+        source->data[0] = const_cast<uint8_t *>(fallbackImage.constBits());
+        source->linesize[0] = int(fallbackImage.bytesPerLine());
+    }
+
+    const QSize targetSize = fitEncodeSize(QSize(source->width, source->height), QSize(targetWidth, targetHeight));
+    if (targetSize.width() <= 0 || targetSize.height() <= 0) {
+        av_frame_free(&source);
+        return false;
+    }
+
+    if (source->buf[0] && source->format == pixelFormat && source->width == targetSize.width()
+        && source->height == targetSize.height()) {
+        // The camera already delivers what the encoder wants.
+        outFrame = source;
+        return true;
+    }
+
+    // Reuse the output buffer unless the encoder still references it.
+    if (!encodeFrame || encodeFrame->width != targetSize.width() || encodeFrame->height != targetSize.height()
+        || encodeFrame->format != pixelFormat) {
+        av_frame_free(&encodeFrame);
+        encodeFrame = av_frame_alloc();
+        if (!encodeFrame) {
+            av_frame_free(&source);
+            return false;
+        }
+        encodeFrame->format = pixelFormat;
+        encodeFrame->width = targetSize.width();
+        encodeFrame->height = targetSize.height();
+        if (av_frame_get_buffer(encodeFrame, 32) < 0) {
+            av_frame_free(&encodeFrame);
+            av_frame_free(&source);
+            return false;
+        }
+    } else if (av_frame_make_writable(encodeFrame) < 0) {
+        av_frame_free(&source);
+        return false;
+    }
+
+    encodeScaler = sws_getCachedContext(encodeScaler,
+                                        source->width,
+                                        source->height,
+                                        static_cast<AVPixelFormat>(source->format),
+                                        encodeFrame->width,
+                                        encodeFrame->height,
+                                        pixelFormat,
+                                        SWS_BILINEAR,
+                                        nullptr,
+                                        nullptr,
+                                        nullptr);
+    if (!encodeScaler) {
+        av_frame_free(&source);
+        return false;
+    }
+
+    sws_scale(encodeScaler,
+              source->data,
+              source->linesize,
+              0,
+              source->height,
+              encodeFrame->data,
+              encodeFrame->linesize);
+    av_frame_free(&source);
+
+    outFrame = av_frame_alloc();
+    if (!outFrame || av_frame_ref(outFrame, encodeFrame) < 0) {
+        av_frame_free(&outFrame);
+        return false;
+    }
+    return true;
+}
+
+DecodedFrameScaler::DecodedFrameScaler()
+    : scaler(nullptr)
+{
+}
+
+DecodedFrameScaler::~DecodedFrameScaler()
+{
+    sws_freeContext(scaler);
+}
+
+QImage DecodedFrameScaler::toImage(const AVFrame *frame, const QSize &targetSize)
+{
+    const QSize native(frame->width, frame->height);
+    QSize outSize = native;
+    if (!targetSize.isEmpty()) {
+        outSize = native.scaled(targetSize, Qt::KeepAspectRatio).boundedTo(native);
+    }
+    if (outSize.isEmpty()) {
+        return QImage();
+    }
+
+    scaler = sws_getCachedContext(scaler,
+                                  native.width(),
+                                  native.height(),
+                                  static_cast<AVPixelFormat>(frame->format),
+                                  outSize.width(),
+                                  outSize.height(),
+                                  AV_PIX_FMT_RGBA,
+                                  SWS_BILINEAR,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr);
+    if (!scaler) {
+        return QImage();
+    }
+
+    // A fresh image per frame: the previous one may still be on screen.
+    QImage image(outSize, QImage::Format_RGBA8888);
+    if (image.isNull()) {
+        return QImage();
+    }
+    uint8_t *dstData[4] = { image.bits(), nullptr, nullptr, nullptr };
+    int dstLinesize[4] = { int(image.bytesPerLine()), 0, 0, 0 };
+    sws_scale(scaler, frame->data, frame->linesize, 0, native.height(), dstData, dstLinesize);
+    return image;
+}
+
+#endif // USE_FFMPEG_H264
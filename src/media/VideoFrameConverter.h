@@ -0,0 +1,72 @@
+#pragma once
+
+#ifdef USE_FFMPEG_H264
+
+#include <QImage>
+#include <QSize>
+#include <QVideoFrame>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+struct SwsContext;
+
+// Turns camera frames into encoder input.
+//
+// Works on the camera's own planes: when they already have the requested
+// format and size they are handed out without a copy (the frame stays
+// mapped until the AVFrame is freed); otherwise one cached swscale pass
+// converts and scales them into a reused buffer. Only formats Qt cannot
+// map as planes (MJPEG) go through QImage.
+//
+// Not thread-safe; one converter per thread.
+class VideoFrameConverter
+{
+public:
+    VideoFrameConverter();
+    ~VideoFrameConverter();
+
+    VideoFrameConverter(const VideoFrameConverter &) = delete;
+    VideoFrameConverter &operator=(const VideoFrameConverter &) = delete;
+
+    // The frame in pixelFormat, scaled to fit the target size with its
+    // aspect ratio kept and never upscaled. The caller frees outFrame.
+    bool convert(const QVideoFrame &frame,
+                 int targetWidth,
+                 int targetHeight,
+                 AVPixelFormat pixelFormat,
+                 AVFrame *&outFrame);
+
+private:
+    // Maps the frame and wraps its planes; null for unsupported layouts.
+    static AVFrame *wrapFrame(const QVideoFrame &frame);
+
+    SwsContext *encodeScaler;
+    AVFrame *encodeFrame;
+};
+
+// Turns decoded pictures into images at the size they are painted at,
+// in one swscale pass with a context cached across frames.
+//
+// Not thread-safe; one scaler per stream.
+class DecodedFrameScaler
+{
+public:
+    DecodedFrameScaler();
+    ~DecodedFrameScaler();
+
+    DecodedFrameScaler(const DecodedFrameScaler &) = delete;
+    DecodedFrameScaler &operator=(const DecodedFrameScaler &) = delete;
+
+    // The frame as RGBA, fitted into targetSize with its aspect ratio
+    // kept and never upscaled; native size when targetSize is empty.
+    // Null on failure.
+    QImage toImage(const AVFrame *frame, const QSize &targetSize);
+
+private:
+    SwsContext *scaler;
+};
+
+#endif // USE_FFMPEG_H264
@@ -33,6 +33,11 @@ void ControlClient::setRoomId(const QString &roomId)
     m_roomId = trimmed.isEmpty() ? QString::fromUtf8(Config::DEFAULT_ROOM_ID) : trimmed;
 }
 
+void ControlClient::setAudioCodecs(const QStringList &codecs)
+{
+    m_audioCodecs = codecs;
+}
+
 QString ControlClient::roomId() const
 {
     return m_roomId.isEmpty() ? QString::fromUtf8(Config::DEFAULT_ROOM_ID) : m_roomId;
@@ -83,7 +88,12 @@ void ControlClient::onConnected()
     m_elapsed.start();
     m_lastPongMs = m_elapsed.elapsed();
     m_pingTimer->start();
-    const QByteArray joinLine = QByteArrayLiteral("JOIN;room=") + roomId().toUtf8() + '\n';
+    QByteArray joinLine = QByteArrayLiteral("JOIN;room=") + roomId().toUtf8();
+    if (!m_audioCodecs.isEmpty()) {
+        joinLine += QByteArrayLiteral(";codecs=") + m_audioCodecs.join(QLatin1Char(',')).toUtf8();
+        joinLine += QByteArrayLiteral(";rate=") + QByteArray::number(Config::AUDIO_SAMPLE_RATE);
+    }
+    joinLine += '\n';
     m_socket->write(joinLine);
     // Backward compatibility: also send legacy JOIN to work with older servers.
     m_socket->write("JOIN\n");
@@ -136,10 +146,58 @@ void ControlClient::onReadyRead()
                              .arg(age));
                 emit pingRoundTrip(age);
             }
+        } else if (line.startsWith(QByteArrayLiteral("AUDIO:"))) {
+            // Format: AUDIO:codec=opus;bitrate=24000;rate=48000
+            QString codec;
+            int bitrate = 0;
+            int rate = Config::AUDIO_SAMPLE_RATE;
+            const QList<QByteArray> parts = line.mid(6).split(';');
+            for (const QByteArray &part : parts) {
+                if (part.startsWith(QByteArrayLiteral("codec="))) {
+                    codec = QString::fromUtf8(part.mid(6)).trimmed();
+                } else if (part.startsWith(QByteArrayLiteral("bitrate="))) {
+                    bitrate = part.mid(8).trimmed().toInt();
+                } else if (part.startsWith(QByteArrayLiteral("rate="))) {
+                    rate = part.mid(5).trimmed().toInt();
+                }
+            }
+            if (rate != Config::AUDIO_SAMPLE_RATE) {
+                LOG_WARN(QStringLiteral("ControlClient: host streams audio at %1 Hz but this build uses %2 Hz; "
+                                        "audio will play at the wrong speed")
+                             .arg(rate)
+                             .arg(Config::AUDIO_SAMPLE_RATE));
+            }
+            if (!codec.isEmpty()) {
+                LOG_INFO(QStringLiteral("ControlClient: host selected audio codec %1 (%2 bit/s)")
+                             .arg(codec)
+                             .arg(bitrate));
+                emit audioCodecNegotiated(codec, bitrate);
+            }
+        } else if (line.startsWith(QByteArrayLiteral("VIDEO:"))) {
+            // Format: VIDEO:w=480;h=270;fps=12 (0 = no limit)
+            int width = 0;
+            int height = 0;
+            int fps = 0;
+            const QList<QByteArray> parts = line.mid(6).split(';');
+            for (const QByteArray &part : parts) {
+                if (part.startsWith(QByteArrayLiteral("w="))) {
+                    width = part.mid(2).trimmed().toInt();
+                } else if (part.startsWith(QByteArrayLiteral("h="))) {
+                    height = part.mid(2).trimmed().toInt();
+                } else if (part.startsWith(QByteArrayLiteral("fps="))) {
+                    fps = part.mid(4).trimmed().toInt();
+                }
+            }
+            LOG_INFO(QStringLiteral("ControlClient: host limits our video to %1x%2 at %3 fps")
+                         .arg(width)
+                         .arg(height)
+                         .arg(fps));
+            emit videoLimitRequested(width > 0 && height > 0 ? QSize(width, height) : QSize(), qMax(0, fps));
         } else if (line.startsWith(QByteArrayLiteral("STATE:"))) {
             // Examples:
             // STATE:MEDIA;ip=1.2.3.4;mic=1;cam=0
             // STATE:SCREEN;ip=1.2.3.4;on=1
+            // STATE:LEFT;ip=1.2.3.4
             const QByteArray payload = line.mid(6);
             const QList<QByteArray> fields = payload.split(';');
             if (fields.isEmpty())
@@ -185,6 +243,10 @@ void ControlClient::onReadyRead()
                 if (!ip.isEmpty()) {
                     emit screenShareStateUpdated(ip, sharing);
                 }
+            } else if (kind == QByteArrayLiteral("LEFT")) {
+                if (!ip.isEmpty()) {
+                    emit participantLeft(ip);
+                }
             }
         }
     }
@@ -261,6 +323,19 @@ void ControlClient::sendScreenShareState(bool sharing)
     }
 }
 
+void ControlClient::sendVideoSubscriptions(const QStringList &ips)
+{
+    if (!m_socket || m_socket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+
+    const QByteArray line = QByteArrayLiteral("SUBSCRIBE:ips=") + ips.join(QLatin1Char(',')).toUtf8() + '\n';
+    const qint64 written = m_socket->write(line);
+    if (written < 0) {
+        LOG_WARN(QStringLiteral("ControlClient: failed to send video subscriptions - %1").arg(m_socket->errorString()));
+    }
+}
+
 void ControlClient::onPingTimer()
 {
     if (!m_socket || m_socket->state() != QAbstractSocket::ConnectedState) {
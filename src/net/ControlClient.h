@@ -4,6 +4,8 @@
 #include <QObject>
 #include <QTcpSocket>
 #include <QElapsedTimer>
+#include <QSize>
+#include <QStringList>
 
 class QHostAddress;
 class QTimer;
@@ -22,6 +24,11 @@ public:
     void sendChatMessage(const QString &message);
     void sendMediaState(bool micMuted, bool cameraEnabled);
     void sendScreenShareState(bool sharing);
+    // Guests whose video the host should relay to us; an empty list
+    // means all of them.
+    void sendVideoSubscriptions(const QStringList &ips);
+    // Audio codecs advertised in the JOIN line, most preferred first.
+    void setAudioCodecs(const QStringList &codecs);
 
 signals:
     void joined();
@@ -30,7 +37,15 @@ signals:
     void chatReceived(const QString &message);
     void mediaStateUpdated(const QString &ip, bool micMuted, bool cameraEnabled);
     void screenShareStateUpdated(const QString &ip, bool sharing);
+    // Another participant left the meeting.
+    void participantLeft(const QString &ip);
     void pingRoundTrip(qint64 ms);
+    // Emitted when the host picked an audio codec for this session. Hosts
+    // that predate codec negotiation never send it.
+    void audioCodecNegotiated(const QString &codec, int bitrate);
+    // The host asked for no more than this picture size and frame rate
+    // of our video; an invalid size or 0 fps means no limit.
+    void videoLimitRequested(const QSize &maxSize, int maxFps);
 
 private slots:
     void onConnected();
@@ -47,6 +62,7 @@ private:
     QElapsedTimer m_elapsed;
     qint64 m_lastPongMs;
     QString m_roomId;
+    QStringList m_audioCodecs;
 };
 
 #endif // CONTROLCLIENT_H
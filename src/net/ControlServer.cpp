@@ -3,6 +3,11 @@
 #include <QHostAddress>
 #include "common/Logger.h"
 
+namespace {
+// Fallback codec understood by every client, including legacy ones.
+const char *const kDefaultAudioCodec = "pcm16";
+} // namespace
+
 ControlServer::ControlServer(QObject *parent)
     : QObject(parent)
     , m_server(new QTcpServer(this))
@@ -10,6 +15,8 @@ ControlServer::ControlServer(QObject *parent)
     , m_elapsed()
     , m_lastPongMs(0)
     , m_roomId(QString::fromUtf8(Config::DEFAULT_ROOM_ID))
+    , m_audioCodecs{QString::fromUtf8(kDefaultAudioCodec)}
+    , m_audioBitrate(Config::AUDIO_CODEC_BITRATE)
 {
     connect(m_server, &QTcpServer::newConnection,
             this, &ControlServer::onNewConnection);
@@ -44,6 +51,19 @@ QString ControlServer::defaultRoomId() const
     return QString::fromUtf8(Config::DEFAULT_ROOM_ID);
 }
 
+void ControlServer::setAudioCodecs(const QStringList &codecs)
+{
+    m_audioCodecs = codecs;
+    if (m_audioCodecs.isEmpty()) {
+        m_audioCodecs << QString::fromUtf8(kDefaultAudioCodec);
+    }
+}
+
+void ControlServer::setAudioBitrate(int bitrate)
+{
+    m_audioBitrate = bitrate > 0 ? bitrate : Config::AUDIO_CODEC_BITRATE;
+}
+
 bool ControlServer::startServer(quint16 port)
 {
     if (m_server->isListening()) {
@@ -160,6 +180,42 @@ void ControlServer::broadcastScreenShareState(const QString &ip, bool sharing, c
     }
 }
 
+void ControlServer::sendVideoLimit(const QString &ip, const QSize &maxSize, int maxFps)
+{
+    const QByteArray line = QByteArrayLiteral("VIDEO:w=") + QByteArray::number(maxSize.isValid() ? maxSize.width() : 0)
+                            + QByteArrayLiteral(";h=") + QByteArray::number(maxSize.isValid() ? maxSize.height() : 0)
+                            + QByteArrayLiteral(";fps=") + QByteArray::number(qMax(0, maxFps))
+                            + '\n';
+
+    for (QTcpSocket *socket : std::as_const(m_clients)) {
+        if (!socket || socket->state() != QAbstractSocket::ConnectedState
+            || socket->peerAddress().toString() != ip) {
+            continue;
+        }
+        socket->write(line);
+    }
+}
+
+void ControlServer::broadcastParticipantLeft(const QString &ip, const QString &roomId)
+{
+    const QString targetRoom = normalizedRoomId(roomId.isEmpty() ? m_roomId : roomId);
+    const QList<QTcpSocket *> roomClients = clientsForRoom(targetRoom);
+    if (roomClients.isEmpty()) {
+        return;
+    }
+
+    const QByteArray line = QByteArrayLiteral("STATE:LEFT;room=") + targetRoom.toUtf8()
+                            + QByteArrayLiteral(";ip=") + ip.toUtf8()
+                            + '\n';
+
+    for (QTcpSocket *socket : roomClients) {
+        if (!socket || socket->state() != QAbstractSocket::ConnectedState) {
+            continue;
+        }
+        socket->write(line);
+    }
+}
+
 QString ControlServer::normalizedRoomId(const QString &roomId) const
 {
     if (!roomId.trimmed().isEmpty()) {
@@ -209,6 +265,7 @@ void ControlServer::onNewConnection()
             LOG_INFO(QStringLiteral("ControlServer: client disconnected from %1 (room %2)").arg(ip, roomId));
             m_clients.removeAll(socket);
             removeClientFromRoom(socket);
+            broadcastParticipantLeft(ip, roomId);
             emit clientLeft(ip, roomId);
             socket->deleteLater();
         });
@@ -238,11 +295,20 @@ void ControlServer::onReadyRead()
                 const QString previousRoom = m_clientRooms.value(socket);
                 const bool alreadyJoined = m_clientRooms.contains(socket);
                 QString requestedRoom = previousRoom;
+                QStringList clientCodecs;
+                // Clients that do not say run at the original 48 kHz.
+                int clientRate = 48000;
+                bool rateGiven = false;
                 if (line.contains(';')) {
                     const QList<QByteArray> fields = line.split(';');
                     for (const QByteArray &field : fields) {
                         if (field.startsWith(QByteArrayLiteral("room="))) {
                             requestedRoom = QString::fromUtf8(field.mid(5));
+                        } else if (field.startsWith(QByteArrayLiteral("codecs="))) {
+                            clientCodecs = QString::fromUtf8(field.mid(7)).split(',', Qt::SkipEmptyParts);
+                        } else if (field.startsWith(QByteArrayLiteral("rate="))) {
+                            clientRate = field.mid(5).toInt();
+                            rateGiven = true;
                         }
                     }
                 }
@@ -254,8 +320,46 @@ void ControlServer::onReadyRead()
                 }
 
                 socket->write("OK\n");
+
+                // Current clients follow their JOIN line with a bare legacy
+                // JOIN; only a first JOIN without a rate means a 48 kHz client.
+                if ((rateGiven || !alreadyJoined) && clientRate != Config::AUDIO_SAMPLE_RATE) {
+                    LOG_WARN(QStringLiteral("ControlServer: %1 streams audio at %2 Hz but the meeting uses %3 Hz; "
+                                            "its audio will play at the wrong speed")
+                                 .arg(clientIp)
+                                 .arg(clientRate)
+                                 .arg(Config::AUDIO_SAMPLE_RATE));
+                }
+
+                // Codec negotiation: pick the host's most preferred codec the
+                // client also supports. Legacy clients send no codec list and
+                // never receive an AUDIO line, so they stay on raw PCM.
+                QString negotiatedCodec;
+                if (!clientCodecs.isEmpty()) {
+                    negotiatedCodec = QString::fromUtf8(kDefaultAudioCodec);
+                    for (const QString &codec : std::as_const(m_audioCodecs)) {
+                        if (clientCodecs.contains(codec, Qt::CaseInsensitive)) {
+                            negotiatedCodec = codec;
+                            break;
+                        }
+                    }
+                    const QByteArray audioLine = QByteArrayLiteral("AUDIO:codec=") + negotiatedCodec.toUtf8()
+                                                 + QByteArrayLiteral(";bitrate=")
+                                                 + QByteArray::number(m_audioBitrate)
+                                                 + QByteArrayLiteral(";rate=")
+                                                 + QByteArray::number(Config::AUDIO_SAMPLE_RATE) + '\n';
+                    socket->write(audioLine);
+                }
                 socket->flush();
 
+                if (!negotiatedCodec.isEmpty()) {
+                    LOG_INFO(QStringLiteral("ControlServer: audio codec %1 (%2 bit/s) negotiated with %3")
+                                 .arg(negotiatedCodec)
+                                 .arg(m_audioBitrate)
+                                 .arg(clientIp));
+                    emit audioCodecNegotiated(clientIp, roomId, negotiatedCodec, m_audioBitrate);
+                }
+
                 if (!alreadyJoined || previousRoom != roomId) {
                     LOG_INFO(QStringLiteral("ControlServer: JOIN confirmed for %1 in room %2")
                                  .arg(clientIp, roomId));
@@ -312,6 +416,16 @@ void ControlServer::onReadyRead()
 
                 emit mediaStateChanged(clientIp, roomId, micMuted, cameraEnabled);
                 broadcastMediaState(clientIp, micMuted, cameraEnabled, roomId);
+            } else if (line.startsWith(QByteArrayLiteral("SUBSCRIBE:"))) {
+                // Format: SUBSCRIBE:ips=1.2.3.4,5.6.7.8 (empty = everyone)
+                QStringList sources;
+                const QList<QByteArray> parts = line.mid(10).split(';');
+                for (const QByteArray &part : parts) {
+                    if (part.startsWith(QByteArrayLiteral("ips="))) {
+                        sources = QString::fromUtf8(part.mid(4)).split(',', Qt::SkipEmptyParts);
+                    }
+                }
+                emit videoSubscriptionsChanged(clientIp, m_clientRooms.value(socket, this->roomId()), sources);
             } else if (line.startsWith(QByteArrayLiteral("SCREEN:"))) {
                 // Format: SCREEN:on=0/1
                 bool sharing = false;
@@ -7,6 +7,8 @@
 #include <QElapsedTimer>
 #include <QTimer>
 #include <QHash>
+#include <QSize>
+#include <QStringList>
 
 #include "common/Config.h"
 
@@ -25,13 +27,31 @@ public:
     void sendChatToAll(const QString &message, const QString &roomId = QString());
     void broadcastMediaState(const QString &ip, bool micMuted, bool cameraEnabled, const QString &roomId = QString());
     void broadcastScreenShareState(const QString &ip, bool sharing, const QString &roomId = QString());
+    // Tells the rest of the room that `ip` left, so guests can drop the
+    // video the host was relaying from it.
+    void broadcastParticipantLeft(const QString &ip, const QString &roomId = QString());
+    // Audio codecs the host can mix, most preferred first, and the bitrate
+    // offered to clients when a compressed codec is negotiated.
+    void setAudioCodecs(const QStringList &codecs);
+    void setAudioBitrate(int bitrate);
+    // Tells the client at `ip` the largest picture and frame rate the
+    // host will display of its video. An invalid size and 0 fps lift
+    // the limit. Clients that predate the message ignore it.
+    void sendVideoLimit(const QString &ip, const QSize &maxSize, int maxFps);
 
 signals:
     void clientJoined(const QString &ip, const QString &roomId);
+    // Emitted before clientJoined when the client advertised audio codecs
+    // in its JOIN line. Clients that never emit this speak the legacy
+    // raw-PCM packet format.
+    void audioCodecNegotiated(const QString &ip, const QString &roomId, const QString &codec, int bitrate);
     void clientLeft(const QString &ip, const QString &roomId);
     void chatReceived(const QString &ip, const QString &roomId, const QString &message);
     void mediaStateChanged(const QString &ip, const QString &roomId, bool micMuted, bool cameraEnabled);
     void screenShareStateChanged(const QString &ip, const QString &roomId, bool sharing);
+    // The client wants the video of these guests relayed to it; an empty
+    // list means every guest.
+    void videoSubscriptionsChanged(const QString &ip, const QString &roomId, const QStringList &sources);
 
 private slots:
     void onNewConnection();
@@ -50,6 +70,8 @@ private:
     QElapsedTimer m_elapsed;
     qint64 m_lastPongMs;
     QString m_roomId;
+    QStringList m_audioCodecs;
+    int m_audioBitrate;
 };
 
 #endif // CONTROLSERVER_H
@@ -27,7 +27,6 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QTextStream>
-#include <QDataStream>
 #include <QStringConverter>
 #include <QFile>
 
@@ -69,8 +68,8 @@ MainWindow::MainWindow(QWidget *parent)
     , screenShareHideTimer(nullptr)
     , screenFitCheckBox(nullptr)
     , diagTimer(nullptr)
-    , hostVideoRecvSocket(nullptr)
-    , hostAudioRecvSocket(nullptr)
+    , hostVideoReceiver(nullptr)
+    , hostAudioMixer(nullptr)
     , isDraggingPreview(false)
     , previewDragStartPos()
     , previewStartPos()
@@ -84,8 +83,7 @@ MainWindow::MainWindow(QWidget *parent)
     , cameraEnabled(true)
     , connectedClientCount(0)
     , recordingAudio(false)
-    , audioRecordFile(nullptr)
-    , audioRecordDataSize(0)
+    , audioRecorder(nullptr)
     , recordingScreen(false)
     , screenRecordAsPng(false)
     , guestReconnectTimer(nullptr)
@@ -858,7 +856,7 @@ QString MainWindow::resolvedRoomIdFromInput() const
 
 void MainWindow::startAudioRecording()
 {
-    if (meetingRole != MeetingRole::Host || meetingState != MeetingState::InMeeting) {
+    if (meetingRole != MeetingRole::Host || meetingState != MeetingState::InMeeting || !hostAudioMixer) {
         if (btnRecordAudio) {
             btnRecordAudio->setChecked(false);
         }
@@ -872,27 +870,24 @@ void MainWindow::startAudioRecording()
         dir.mkpath(QStringLiteral("."));
     }
     const QString fileName =
-        QStringLiteral("meeting_audio_%1.wav")
-            .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd_HHmmss")));
+        QStringLiteral("meeting_audio_%1.%2")
+            .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd_HHmmss")))
+            .arg(MeetingRecorder::fileExtension());
     audioRecordPath = dir.filePath(fileName);
 
-    audioRecordFile = new QFile(audioRecordPath, this);
-    if (!audioRecordFile->open(QIODevice::WriteOnly)) {
-        appendLogMessage(QStringLiteral("无法开始录音，文件打开失败：%1").arg(audioRecordFile->errorString()));
-        audioRecordFile->deleteLater();
-        audioRecordFile = nullptr;
+    // 录音在独立的写线程中编码和写盘，混音线程只把每帧放入无锁队列。
+    audioRecorder = new MeetingRecorder;
+    if (!audioRecorder->start(audioRecordPath)) {
+        appendLogMessage(QStringLiteral("无法开始录音，文件打开失败：%1").arg(audioRecordPath));
+        delete audioRecorder;
+        audioRecorder = nullptr;
         if (btnRecordAudio) {
             btnRecordAudio->setChecked(false);
         }
         return;
     }
+    hostAudioMixer->setRecorder(audioRecorder);
 
-    audioRecordDataSize = 0;
-    // Reserve WAV header (44 bytes)
-    QByteArray header;
-    header.resize(44);
-    header.fill(0);
-    audioRecordFile->write(header);
     recordingAudio = true;
     statusBar()->showMessage(QStringLiteral("Audio recording started"), 3000);
     appendLogMessage(QStringLiteral("开始会议录音：%1").arg(audioRecordPath));
@@ -900,35 +895,19 @@ void MainWindow::startAudioRecording()
 
 void MainWindow::stopAudioRecording()
 {
-    if (!recordingAudio || !audioRecordFile) {
+    if (!recordingAudio || !audioRecorder) {
         return;
     }
 
-    // Finalize WAV header
-    const qint64 dataSize = audioRecordDataSize;
-    const qint64 fileSize = dataSize + 44 - 8; // chunk size excludes RIFF + size field
-    audioRecordFile->seek(0);
-
-    QDataStream out(audioRecordFile);
-    out.setByteOrder(QDataStream::LittleEndian);
-    out.writeRawData("RIFF", 4);
-    out << quint32(fileSize);
-    out.writeRawData("WAVE", 4);
-    out.writeRawData("fmt ", 4);
-    out << quint32(16);            // PCM header size
-    out << quint16(1);             // audio format PCM
-    out << quint16(1);             // channels
-    out << quint32(48000);         // sample rate
-    out << quint32(48000 * 2);     // byte rate (sampleRate * channels * bytesPerSample)
-    out << quint16(2);             // block align
-    out << quint16(16);            // bits per sample
-    out.writeRawData("data", 4);
-    out << quint32(dataSize);
-
-    audioRecordFile->flush();
-    audioRecordFile->close();
-    audioRecordFile->deleteLater();
-    audioRecordFile = nullptr;
+    // 先让混音线程停止送帧，再收尾文件。
+    if (hostAudioMixer) {
+        hostAudioMixer->setRecorder(nullptr);
+    }
+    audioRecorder->stop();
+    const qint64 fileSize = audioRecorder->fileSize();
+    const quint64 dropped = audioRecorder->droppedFrames();
+    delete audioRecorder;
+    audioRecorder = nullptr;
     recordingAudio = false;
 
     if (btnRecordAudio) {
@@ -936,7 +915,10 @@ void MainWindow::stopAudioRecording()
     }
 
     statusBar()->showMessage(QStringLiteral("Audio recording saved"), 3000);
-    appendLogMessage(QStringLiteral("录音已保存：%1").arg(audioRecordPath));
+    appendLogMessage(QStringLiteral("录音已保存：%1（%2 KB，丢帧 %3）")
+                         .arg(audioRecordPath)
+                         .arg(fileSize / 1024)
+                         .arg(static_cast<qulonglong>(dropped)));
 }
 
 void MainWindow::startScreenDumpRecording(bool asPng)
@@ -1078,18 +1060,21 @@ void MainWindow::exportChatLog()
     refreshParticipantListView();
     activeClientIps.clear();
 
-    // 清理主持人端的多路远端视频/音频接收资源
-    if (hostVideoRecvSocket) {
-        hostVideoRecvSocket->close();
-        hostVideoRecvSocket->deleteLater();
-        hostVideoRecvSocket = nullptr;
+    // 清理多路远端视频（主持人端及转发）/音频接收资源
+    if (hostVideoReceiver) {
+        hostVideoReceiver->stop();
+        delete hostVideoReceiver;
+        hostVideoReceiver = nullptr;
     }
     hostVideoLabels.clear();
 
-    if (hostAudioRecvSocket) {
-        hostAudioRecvSocket->close();
-        hostAudioRecvSocket->deleteLater();
-        hostAudioRecvSocket = nullptr;
+    if (hostAudioMixer) {
+        hostAudioMixer->stop();
+        delete hostAudioMixer;
+        hostAudioMixer = nullptr;
+    }
+    if (audioNet) {
+        audioNet->resetCodec();
     }
 
       if (ui->remoteVideoContainer) {
@@ -1108,6 +1093,9 @@ void MainWindow::exportChatLog()
       hostVideoMicIconLabels.clear();
       hostVideoCameraIconLabels.clear();
       activeSpeakerIp.clear();
+      maximizedVideoIp.clear();
+      requestedVideoLimits.clear();
+      guestVideoSubscriptions.clear();
 
     if (screenShare && screenShare->isSending()) {
         screenShare->stopSender();
@@ -1174,15 +1162,27 @@ void MainWindow::startClientMediaTransports()
                               QStringLiteral("Failed to create video network channel (port may be in use)."));
     }
 
+    // 其他客户端的视频经主持人转发，到达独立端口；只接受来自主持人的转发包
+    initHostVideoReceiver(Config::VIDEO_PORT_FORWARD);
+    if (hostVideoReceiver) {
+        hostVideoReceiver->addParticipant(currentRemoteIp);
+    }
+
     updateMeetingStatusLabel();
     updateControlsForMeetingState();
 }
 
-// Host-side: lazily create and bind the UDP socket used to receive
-// video frames from all connected participants.
+// Host-side: lazily start the video receiver, which demultiplexes and
+// decodes every participant's video off the GUI thread.
 static constexpr int kHostVideoThumbWidth  = 160;
 static constexpr int kHostVideoThumbHeight = 120;
 
+// Video limits a host asks of guests shown as tiles, smallest first.
+// A tile gets the first step that covers it in device pixels; larger
+// tiles, the active speaker and a maximized tile get no limit. Steps
+// keep a resizing window from reopening the guests' encoders each frame.
+static const QSize kTileVideoLimitSteps[] = {QSize(320, 180), QSize(480, 270), QSize(640, 360)};
+
 QWidget *MainWindow::createParticipantVideoTile(const QString &displayName,
                                                 QLabel **outVideoLabel,
                                                 QLabel **outMicIconLabel,
@@ -1254,11 +1254,13 @@ void MainWindow::rebuildRemoteParticipantGrid()
     }
 
     const QList<QString> keys = hostVideoLabels.keys();
-    const int count = keys.size();
-    if (count == 0) {
+    if (keys.isEmpty()) {
         remoteParticipantsContainer->hide();
         return;
     }
+    // 双击放大的画面单独显示，其余画面暂时隐藏
+    const bool maximized = !maximizedVideoIp.isEmpty() && hostVideoLabels.contains(maximizedVideoIp);
+    const int count = maximized ? 1 : keys.size();
 
     remoteParticipantsContainer->show();
 
@@ -1285,6 +1287,11 @@ void MainWindow::rebuildRemoteParticipantGrid()
         if (!tile) {
             continue;
         }
+        if (maximized && ip != maximizedVideoIp) {
+            tile->hide();
+            continue;
+        }
+        tile->show();
 
         // 根据当前发言者设置高亮边框
         if (!activeSpeakerIp.isEmpty() && ip == activeSpeakerIp) {
@@ -1304,52 +1311,113 @@ void MainWindow::rebuildRemoteParticipantGrid()
             ++row;
         }
     }
+
+    updateParticipantVideoLimits();
 }
 
-void MainWindow::initHostVideoReceiver()
+// Drops a departed participant's video: its stream in the receiver and
+// its tile. On a guest these are the videos the host relays.
+void MainWindow::removeParticipantVideo(const QString &ip)
 {
-    if (hostVideoRecvSocket) {
-        return;
+    if (hostVideoReceiver) {
+        hostVideoReceiver->removeParticipant(ip);
+    }
+    requestedVideoLimits.remove(ip);
+    if (guestVideoSubscriptions.remove(ip) > 0) {
+        updateParticipantVideoLimits();
+    }
+    if (maximizedVideoIp == ip) {
+        maximizedVideoIp.clear();
+        if (meetingRole != MeetingRole::Host && client) {
+            client->sendVideoSubscriptions(QStringList());
+        }
+    }
+    if (QLabel *label = hostVideoLabels.take(ip)) {
+        if (QWidget *tile = label->parentWidget()) {
+            tile->deleteLater();
+        }
+        hostVideoMicIconLabels.remove(ip);
+        hostVideoCameraIconLabels.remove(ip);
+        rebuildRemoteParticipantGrid();
     }
+}
 
-    hostVideoRecvSocket = new QUdpSocket(this);
-    if (!hostVideoRecvSocket->bind(QHostAddress::AnyIPv4, Config::VIDEO_PORT_SEND)) {
-        appendLogMessage(QStringLiteral("主持人端视频接收端口绑定失败，无法接收远端视频"));
-        hostVideoRecvSocket->deleteLater();
-        hostVideoRecvSocket = nullptr;
+// Host-side: ask every guest for no more video than its tile displays,
+// except the active speaker and a tile maximized here or on a guest.
+// Relayed video follows the same limit.
+void MainWindow::updateParticipantVideoLimits()
+{
+    if (!server || meetingRole != MeetingRole::Host) {
         return;
     }
 
-    connect(hostVideoRecvSocket, &QUdpSocket::readyRead, this, [this]() {
-        while (hostVideoRecvSocket && hostVideoRecvSocket->hasPendingDatagrams()) {
-            QByteArray datagram;
-            datagram.resize(int(hostVideoRecvSocket->pendingDatagramSize()));
+    for (auto it = hostVideoLabels.constBegin(); it != hostVideoLabels.constEnd(); ++it) {
+        const QString &ip = it.key();
+        QLabel *label = it.value();
+        if (!label || !activeClientIps.contains(ip)) {
+            continue;
+        }
 
-            QHostAddress senderAddr;
-            quint16 senderPort = 0;
-            const qint64 read =
-                hostVideoRecvSocket->readDatagram(datagram.data(), datagram.size(), &senderAddr, &senderPort);
-            if (read <= 0) {
-                appendLogMessage(QStringLiteral("读取远端视频数据失败：%1")
-                                     .arg(hostVideoRecvSocket->errorString()));
-                continue;
+        // 某个客户端放大了该参会者的画面（只订阅这一路）时同样不限制
+        bool maximizedOnGuest = false;
+        for (auto sub = guestVideoSubscriptions.constBegin(); sub != guestVideoSubscriptions.constEnd(); ++sub) {
+            if (sub.value().size() == 1 && sub.value().constFirst() == ip) {
+                maximizedOnGuest = true;
+                break;
             }
+        }
 
-            if (read < datagram.size()) {
-                datagram.resize(int(read));
+        QSize limit;
+        if (ip != activeSpeakerIp && ip != maximizedVideoIp && !maximizedOnGuest) {
+            const QSize needed = label->size() * label->devicePixelRatioF();
+            for (const QSize &step : kTileVideoLimitSteps) {
+                if (step.width() >= needed.width() && step.height() >= needed.height()) {
+                    limit = step;
+                    break;
+                }
             }
+        }
 
-            if (datagram.isEmpty()) {
-                continue;
-            }
+        const auto known = requestedVideoLimits.constFind(ip);
+        if (known != requestedVideoLimits.constEnd() && *known == limit) {
+            continue;
+        }
+        requestedVideoLimits.insert(ip, limit);
+        server->sendVideoLimit(ip, limit, limit.isValid() ? Config::VIDEO_TILE_MAX_FPS : 0);
+    }
+}
+
+void MainWindow::initHostVideoReceiver(quint16 listenPort, quint16 forwardPort)
+{
+    if (hostVideoReceiver) {
+        return;
+    }
+
+    // 接收与解码在独立线程/线程池中完成，界面线程只负责贴图。
+    // 主持人端同时把每个客户端的视频包转发给其他客户端；客户端用同一个接收器显示转发来的视频。
+    hostVideoReceiver = new HostVideoReceiver(this);
+    if (!hostVideoReceiver->start(listenPort, forwardPort)) {
+        appendLogMessage(QStringLiteral("视频接收端口 %1 绑定失败，无法接收远端视频").arg(listenPort));
+        delete hostVideoReceiver;
+        hostVideoReceiver = nullptr;
+        return;
+    }
 
-            const QString senderIp = senderAddr.toString();
+    connect(hostVideoReceiver, &HostVideoReceiver::frameReady, this, [this](const QString &senderIp) {
+            if (!hostVideoReceiver || !ui->remoteVideoContainer) {
+                return;
+            }
 
-            if (!ui->remoteVideoContainer) {
-                continue;
+            QImage image;
+            if (!hostVideoReceiver->takeFrame(senderIp, image)) {
+                return;
             }
 
             QLabel *label = hostVideoLabels.value(senderIp, nullptr);
+            // 已离开的客户端的残留画面不再新建窗口
+            if (!label && meetingRole == MeetingRole::Host && !activeClientIps.contains(senderIp)) {
+                return;
+            }
               if (!label) {
                   if (!remoteParticipantsContainer || !remoteParticipantsLayout) {
                       if (QWidget *remoteContainer = ui->remoteVideoContainer) {
@@ -1383,6 +1451,11 @@ void MainWindow::initHostVideoReceiver()
                                                              &cameraIcon);
                   label = videoLabel;
                   hostVideoLabels.insert(senderIp, label);
+                  if (tile) {
+                      // 双击画面放大/还原
+                      tile->setProperty("participantIp", senderIp);
+                      tile->installEventFilter(this);
+                  }
                   if (!senderIp.isEmpty()) {
                       if (micIcon) {
                           hostVideoMicIconLabels.insert(senderIp, micIcon);
@@ -1398,160 +1471,119 @@ void MainWindow::initHostVideoReceiver()
                   }
               }
 
-            QImage image;
-            if (!image.loadFromData(datagram, "JPG")) {
-                appendLogMessage(QStringLiteral("解码远端 JPEG 视频帧失败（大小=%1）").arg(datagram.size()));
-                continue;
+            if (!label) {
+                return;
             }
 
-            if (!image.isNull()) {
-                videoFramesThisSecond++;
-                label->setPixmap(QPixmap::fromImage(image).scaled(label->size(),
-                                                                  Qt::KeepAspectRatio,
-                                                                  Qt::SmoothTransformation));
-                label->setToolTip(QStringLiteral("From: %1").arg(senderIp));
-            }
-        }
+            // 解码线程已按标签尺寸缩放，这里直接贴图，并把最新尺寸告知解码线程。
+            const qreal dpr = label->devicePixelRatioF();
+            image.setDevicePixelRatio(dpr);
+            videoFramesThisSecond++;
+            label->setPixmap(QPixmap::fromImage(std::move(image)));
+            label->setToolTip(QStringLiteral("From: %1").arg(senderIp));
+            hostVideoReceiver->setTileSize(senderIp, label->size() * dpr);
+            updateParticipantVideoLimits();
     });
+
+    connect(hostVideoReceiver,
+            &HostVideoReceiver::streamStatsUpdated,
+            this,
+            [this](const QList<HostVideoReceiver::StreamStats> &stats) {
+                for (const HostVideoReceiver::StreamStats &entry : stats) {
+                    if (entry.dropped == 0 && entry.lost == 0 && entry.decodeErrors == 0) {
+                        continue;
+                    }
+                    appendLogMessage(QStringLiteral("视频输入 %1：解码 %2 帧，丢弃 %3，丢失 %4，解码失败 %5，平均解码 %6 ms，最大 %7 ms")
+                                         .arg(entry.id)
+                                         .arg(static_cast<qulonglong>(entry.frames))
+                                         .arg(static_cast<qulonglong>(entry.dropped))
+                                         .arg(static_cast<qulonglong>(entry.lost))
+                                         .arg(static_cast<qulonglong>(entry.decodeErrors))
+                                         .arg(entry.avgDecodeMs, 0, 'f', 1)
+                                         .arg(entry.maxDecodeMs, 0, 'f', 1));
+                }
+            });
 }
 
-// Host-side: lazily create and bind the UDP socket used to receive
-// audio frames from all connected participants and perform a simple
-// mixing before sending to AudioEngine for playback.
+// Host-side: lazily start the conference mixer, which receives audio
+// from all connected participants on its own thread, mixes one frame per
+// 20 ms tick, broadcasts the result and plays the host's own mix. The GUI
+// only records the mix and updates the active speaker.
   void MainWindow::initHostAudioMixer()
   {
-    if (hostAudioRecvSocket) {
+    if (hostAudioMixer) {
         return;
     }
 
-    hostAudioRecvSocket = new QUdpSocket(this);
-    if (!hostAudioRecvSocket->bind(QHostAddress::AnyIPv4, Config::AUDIO_PORT_SEND)) {
+    hostAudioMixer = new AudioMixer(this);
+    // 混音结果由混音线程直接送去播放，不经过 GUI 线程。
+    if (!hostAudioMixer->start(Config::AUDIO_PORT_SEND, Config::AUDIO_PORT_RECV, audio)) {
         appendLogMessage(QStringLiteral("主持人端音频接收端口绑定失败，无法接收远端音频"));
-        hostAudioRecvSocket->deleteLater();
-        hostAudioRecvSocket = nullptr;
+        delete hostAudioMixer;
+        hostAudioMixer = nullptr;
         return;
     }
 
-    connect(hostAudioRecvSocket, &QUdpSocket::readyRead, this, [this]() {
-        if (!audio) {
-            // 没有音频引擎就无法播放，直接丢弃。
-            while (hostAudioRecvSocket && hostAudioRecvSocket->hasPendingDatagrams()) {
-                QByteArray tmp;
-                tmp.resize(int(hostAudioRecvSocket->pendingDatagramSize()));
-                hostAudioRecvSocket->readDatagram(tmp.data(), tmp.size());
-            }
-            return;
-        }
-
-        // 一次 readyRead 内将当前所有待处理的数据包进行简单叠加混音。
-          QVector<QByteArray> packets;
-          QHash<QString, double> levels;
-        qint64 maxSize = 0;
-
-        while (hostAudioRecvSocket && hostAudioRecvSocket->hasPendingDatagrams()) {
-              QByteArray datagram;
-              datagram.resize(int(hostAudioRecvSocket->pendingDatagramSize()));
-            QHostAddress senderAddr;
-            quint16 senderPort = 0;
-            const qint64 read =
-                hostAudioRecvSocket->readDatagram(datagram.data(), datagram.size(), &senderAddr, &senderPort);
-            if (read <= 0) {
-                appendLogMessage(QStringLiteral("读取远端音频数据失败：%1")
-                                     .arg(hostAudioRecvSocket->errorString()));
-                continue;
-            }
-            if (read < datagram.size()) {
-                datagram.resize(int(read));
-            }
-              if (datagram.isEmpty()) {
-                  continue;
-              }
-              audioPacketsThisSecond++;
-              packets.push_back(datagram);
-              if (datagram.size() > maxSize) {
-                  maxSize = datagram.size();
-              }
-
-              // 简单的说话人检测：计算每个 IP 的音频能量（平均绝对值）
-              if (!senderAddr.isNull()) {
-                  const QString senderIp = senderAddr.toString();
-                  const int sampleCount = datagram.size() / 2;
-                  if (sampleCount > 0) {
-                      const auto *samples =
-                          reinterpret_cast<const qint16 *>(datagram.constData());
-                      double sum = 0.0;
-                      for (int i = 0; i < sampleCount; ++i) {
-                          sum += std::abs(samples[i]);
-                      }
-                      const double level = sum / double(sampleCount);
-                      levels[senderIp] = qMax(levels.value(senderIp, 0.0), level);
-                  }
-              }
-          }
-
-        if (packets.isEmpty() || maxSize <= 0) {
-            return;
-        }
+    // 主持人本地麦克风作为混音器的一路输入：在音频线程上直接转交混音线程，避免界面卡顿影响音频。
+    if (audioNet) {
+        connect(audioNet,
+                &AudioTransport::localFrameCaptured,
+                hostAudioMixer,
+                &AudioMixer::pushLocalFrame,
+                Qt::DirectConnection);
+    }
 
-        // 混音：将所有 16bit 单声道 PCM 流简单求和并截断到 int16 范围。
-        QByteArray mixed;
-        mixed.resize(int(maxSize));
-        mixed.fill(0);
-
-        const int sampleCount = mixed.size() / 2;
-        auto *mixedSamples = reinterpret_cast<qint16 *>(mixed.data());
-
-        for (const QByteArray &packet : packets) {
-            const int count = qMin(sampleCount, packet.size() / 2);
-            const auto *srcSamples = reinterpret_cast<const qint16 *>(packet.constData());
-            for (int i = 0; i < count; ++i) {
-                int sum = int(mixedSamples[i]) + int(srcSamples[i]);
-                if (sum > 32767) {
-                    sum = 32767;
-                } else if (sum < -32768) {
-                    sum = -32768;
+    connect(hostAudioMixer,
+            &AudioMixer::frameMixed,
+            this,
+            [this](const QByteArray &, const QHash<QString, double> &levels, int packetsReceived) {
+                audioPacketsThisSecond += packetsReceived;
+
+                // 选择当前能量最大的一个远端作为简单的“当前发言者”（电平单位为 dBov，来自发送端包头）
+                QString newActiveSpeaker;
+                double maxLevel = -127.0;
+                const double threshold = -35.0; // 简单阈值，避免环境噪声触发
+                bool haveRemoteLevels = false;
+                for (auto it = levels.constBegin(); it != levels.constEnd(); ++it) {
+                    if (it.key() == AudioMixer::localSourceId()) {
+                        continue;
+                    }
+                    haveRemoteLevels = true;
+                    if (it.value() > maxLevel) {
+                        maxLevel = it.value();
+                        newActiveSpeaker = it.key();
+                    }
                 }
-                mixedSamples[i] = qint16(sum);
-            }
-        }
-
-          audio->playAudio(mixed);
-          if (recordingAudio && audioRecordFile && audioRecordFile->isOpen()) {
-              audioRecordFile->write(mixed);
-              audioRecordDataSize += mixed.size();
-          }
-
-          // 选择当前能量最大的一个作为简单的“当前发言者”
-          QString newActiveSpeaker;
-          double maxLevel = 0.0;
-          const double threshold = 500.0; // 简单阈值，避免环境噪声触发
-          for (auto it = levels.constBegin(); it != levels.constEnd(); ++it) {
-              if (it.value() > maxLevel) {
-                  maxLevel = it.value();
-                  newActiveSpeaker = it.key();
-              }
-          }
-          if (!newActiveSpeaker.isEmpty() && maxLevel > threshold) {
-              if (newActiveSpeaker != activeSpeakerIp) {
-                  activeSpeakerIp = newActiveSpeaker;
-                  rebuildRemoteParticipantGrid();
-              }
-          } else if (!levels.isEmpty() && maxLevel <= threshold) {
-              // 没有明显发言者时清除高亮
-              if (!activeSpeakerIp.isEmpty()) {
-                  activeSpeakerIp.clear();
-                  rebuildRemoteParticipantGrid();
-              }
-          }
+                if (!newActiveSpeaker.isEmpty() && maxLevel > threshold) {
+                    if (newActiveSpeaker != activeSpeakerIp) {
+                        activeSpeakerIp = newActiveSpeaker;
+                        rebuildRemoteParticipantGrid();
+                    }
+                } else if (haveRemoteLevels && maxLevel <= threshold) {
+                    // 没有明显发言者时清除高亮
+                    if (!activeSpeakerIp.isEmpty()) {
+                        activeSpeakerIp.clear();
+                        rebuildRemoteParticipantGrid();
+                    }
+                }
+            });
 
-        // 将混音后的会议音频广播给所有已知的客户端（每个客户端在本地使用 AudioTransport 播放）。
-        for (const QString &ip : std::as_const(activeClientIps)) {
-            if (ip.isEmpty()) {
-                continue;
-            }
-            hostAudioRecvSocket->writeDatagram(mixed, QHostAddress(ip), Config::AUDIO_PORT_RECV);
-        }
-    });
+    connect(hostAudioMixer,
+            &AudioMixer::sourceStatsUpdated,
+            this,
+            [this](const QList<AudioMixer::SourceStats> &stats) {
+                for (const AudioMixer::SourceStats &entry : stats) {
+                    if (entry.underruns == 0 && entry.late == 0 && entry.lost == 0) {
+                        continue;
+                    }
+                    appendLogMessage(QStringLiteral("混音输入 %1：欠载 %2，迟到 %3，丢失 %4，缓冲 %5 帧")
+                                         .arg(entry.id)
+                                         .arg(static_cast<qulonglong>(entry.underruns))
+                                         .arg(static_cast<qulonglong>(entry.late))
+                                         .arg(static_cast<qulonglong>(entry.lost))
+                                         .arg(entry.buffered));
+                }
+            });
 }
 
   void MainWindow::updateControlsForMeetingState()
@@ -1878,6 +1910,18 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event)
         }
     }
 
+    if (event->type() == QEvent::MouseButtonDblClick
+        && watched->objectName() == QStringLiteral("remoteParticipantTile")) {
+        const QString ip = watched->property("participantIp").toString();
+        maximizedVideoIp = (maximizedVideoIp == ip) ? QString() : ip;
+        rebuildRemoteParticipantGrid();
+        // 客户端放大某一画面时，只请求主持人转发该参会者的视频
+        if (meetingRole != MeetingRole::Host && client) {
+            client->sendVideoSubscriptions(maximizedVideoIp.isEmpty() ? QStringList() : QStringList{maximizedVideoIp});
+        }
+        return true;
+    }
+
     if (watched == ui->videoContainer) {
         switch (event->type()) {
         case QEvent::MouseButtonPress: {
@@ -1968,6 +2012,25 @@ void MainWindow::on_btnCreateRoom_clicked()
     if (!server) {
         server = new ControlServer(this);
         server->setRoomId(currentRoomId);
+        server->setAudioCodecs(AudioCodec::supportedNames());
+        server->setAudioBitrate(Config::AUDIO_CODEC_BITRATE);
+
+        connect(server,
+                &ControlServer::audioCodecNegotiated,
+                this,
+                [this](const QString &ip, const QString &roomId, const QString &codec, int bitrate) {
+                    if (roomId != currentRoomId) {
+                        return;
+                    }
+                    AudioCodec::Type type = AudioCodec::Type::Pcm16;
+                    if (!AudioCodec::fromName(codec, type)) {
+                        return;
+                    }
+                    if (hostAudioMixer) {
+                        hostAudioMixer->setPeerCodec(ip, type, bitrate);
+                    }
+                    appendLogMessage(QStringLiteral("客户端 %1 音频编码协商为 %2（%3 bit/s）").arg(ip, codec).arg(bitrate));
+                });
 
         connect(server, &ControlServer::clientJoined, this, [this](const QString &ip, const QString &roomId) {
             if (roomId != currentRoomId) {
@@ -1985,17 +2048,24 @@ void MainWindow::on_btnCreateRoom_clicked()
                               QStringLiteral("%1 joined the meeting (room %2)").arg(displayName, roomId),
                               false);
 
-            if (audioNet && !audioNet->startSendOnly(ip, Config::AUDIO_PORT_RECV)) {
-                QMessageBox::critical(this,
-                                      QStringLiteral("Audio error"),
-                                      QStringLiteral("Failed to create audio network channel (port may be in use)."));
-                audioTransportActive = false;
-            } else if (audioNet) {
+            // 音频统一经由混音器转发：主持人麦克风只在本地采集后送入混音器。
+            if (hostAudioMixer) {
+                hostAudioMixer->addRecipient(ip);
+            }
+            // 其他客户端的视频由主持人原样转发，不在主持人端重新编码。
+            if (hostVideoReceiver) {
+                hostVideoReceiver->addParticipant(ip);
+                hostVideoReceiver->addRecipient(ip);
+            }
+            if (audioNet && !audioTransportActive) {
+                audioTransportActive = audioNet->startCaptureOnly();
                 audioNet->setMuted(audioMuted);
-                audioTransportActive = true;
             }
 
-            if (videoNet && !videoNet->startSendOnly(ip, Config::VIDEO_PORT_RECV)) {
+            // 视频每帧只编码一次并分发给所有参会者，新加入者会立即收到关键帧。
+            if (videoNet && videoTransportActive) {
+                videoNet->setDestinations(activeClientIps);
+            } else if (videoNet && !videoNet->startSendOnly(ip, Config::VIDEO_PORT_RECV)) {
                 QMessageBox::critical(this,
                                       QStringLiteral("Video error"),
                                       QStringLiteral("Failed to create video network channel (port may be in use)."));
@@ -2035,19 +2105,27 @@ void MainWindow::on_btnCreateRoom_clicked()
 
             removeParticipant(ip);
             activeClientIps.remove(ip);
+            if (hostAudioMixer) {
+                hostAudioMixer->removePeer(ip);
+            }
+            removeParticipantVideo(ip);
 
             appendChatMessage(QStringLiteral("System"),
                               QStringLiteral("%1 left the meeting (room %2)").arg(displayName, roomId),
                               false);
 
             // 停止当前音视频通道，保持会议继续处于“等待对端加入”状态
-            if (audioNet && audioTransportActive) {
+            if (audioNet && audioTransportActive && activeClientIps.isEmpty()) {
                 audioNet->stopTransport();
                 audioTransportActive = false;
             }
             if (videoNet && videoTransportActive) {
-                videoNet->stopTransport();
-                videoTransportActive = false;
+                if (activeClientIps.isEmpty()) {
+                    videoNet->stopTransport();
+                    videoTransportActive = false;
+                } else {
+                    videoNet->setDestinations(activeClientIps);
+                }
             }
 
             meetingState = MeetingState::WaitingPeer;
@@ -2064,6 +2142,18 @@ void MainWindow::on_btnCreateRoom_clicked()
             appendChatMessage(QStringLiteral("Remote"), msg, false);
         });
 
+        connect(server,
+                &ControlServer::videoSubscriptionsChanged,
+                this,
+                [this](const QString &ip, const QString &roomId, const QStringList &sources) {
+                    if (roomId != currentRoomId || !hostVideoReceiver) {
+                        return;
+                    }
+                    hostVideoReceiver->setSubscriptions(ip, sources);
+                    guestVideoSubscriptions.insert(ip, sources);
+                    updateParticipantVideoLimits();
+                });
+
         connect(server,
                 &ControlServer::mediaStateChanged,
                 this,
@@ -2100,7 +2190,7 @@ void MainWindow::on_btnCreateRoom_clicked()
         updateMeetingStatusLabel();
         updateControlsForMeetingState();
         appendLogMessage(QStringLiteral("会议服务器已启动，房间 %1，等待客户端连接").arg(currentRoomId));
-        initHostVideoReceiver();
+        initHostVideoReceiver(Config::VIDEO_PORT_SEND, Config::VIDEO_PORT_FORWARD);
         initHostAudioMixer();
     } else {
         QMessageBox::critical(this,
@@ -2161,6 +2251,32 @@ void MainWindow::on_btnJoinRoom_clicked()
     if (!client) {
         client = new ControlClient(this);
         client->setRoomId(currentRoomId);
+        client->setAudioCodecs(AudioCodec::supportedNames());
+
+        connect(client, &ControlClient::audioCodecNegotiated, this, [this](const QString &codec, int bitrate) {
+            AudioCodec::Type type = AudioCodec::Type::Pcm16;
+            if (!audioNet || !AudioCodec::fromName(codec, type)) {
+                return;
+            }
+            audioNet->setCodec(type, bitrate);
+            appendLogMessage(QStringLiteral("音频编码协商为 %1（%2 bit/s）").arg(codec).arg(bitrate));
+        });
+
+        connect(client, &ControlClient::videoLimitRequested, this, [this](const QSize &maxSize, int maxFps) {
+            if (!videoNet) {
+                return;
+            }
+            // 主持人只以小窗口显示本端视频时，降低编码分辨率与帧率
+            videoNet->setEncodeLimit(maxSize, maxFps);
+            if (maxSize.isValid()) {
+                appendLogMessage(QStringLiteral("主持人请求视频不超过 %1x%2，%3 fps")
+                                     .arg(maxSize.width())
+                                     .arg(maxSize.height())
+                                     .arg(maxFps));
+            } else {
+                appendLogMessage(QStringLiteral("主持人请求恢复完整分辨率视频"));
+            }
+        });
 
         connect(client, &ControlClient::errorOccurred, this, [this](const QString &msg) {
             QMessageBox::critical(this,
@@ -2227,6 +2343,10 @@ void MainWindow::on_btnJoinRoom_clicked()
                 [this](const QString &ip, bool micMuted, bool cameraEnabled) {
                     updateParticipantMediaStateByIp(ip, micMuted, cameraEnabled);
                 });
+        // 其他客户端离开时，移除主持人转发来的该客户端画面
+        connect(client, &ControlClient::participantLeft, this, [this](const QString &ip) {
+            removeParticipantVideo(ip);
+        });
         connect(client, &ControlClient::pingRoundTrip, this, [this](qint64 ms) {
             lastPingMs = ms;
             updateQualityPanel();
@@ -17,9 +17,13 @@
 #include "common/Logger.h"
 #include "net/ControlServer.h"
 #include "net/ControlClient.h"
+#include "media/HostVideoReceiver.h"
 #include "media/MediaEngine.h"
+#include "audio/AudioCodec.h"
 #include "audio/AudioEngine.h"
+#include "audio/AudioMixer.h"
 #include "audio/AudioTransport.h"
+#include "audio/MeetingRecorder.h"
 #include "media/MediaTransport.h"
 #include "media/ScreenShareTransport.h"
 
@@ -109,7 +113,7 @@ private:
     void updateMeetingStatusLabel();
     void appendChatMessage(const QString &sender, const QString &message, bool isLocal);
     void refreshParticipantListView();
-    void initHostVideoReceiver();
+    void initHostVideoReceiver(quint16 listenPort, quint16 forwardPort = 0);
     void initHostAudioMixer();
     void onScreenShareFrameReceived(const QImage &image);
     void updateScreenSharePixmap();
@@ -178,13 +182,14 @@ private:
     QPoint previewDragStartPos;
     QPoint previewStartPos;
 
-      // Host-side multi-remote video receiving
-      QUdpSocket *hostVideoRecvSocket;
+      // Multi-remote video receiving: guests' video on the host, the
+      // video the host forwards from other guests on a guest
+      HostVideoReceiver *hostVideoReceiver;
       QHash<QString, QLabel *> hostVideoLabels;
       QHash<QString, QLabel *> hostVideoMicIconLabels;
       QHash<QString, QLabel *> hostVideoCameraIconLabels;
     // Host-side multi-remote audio receiving & mixing
-    QUdpSocket *hostAudioRecvSocket;
+    AudioMixer *hostAudioMixer;
       QSet<QString> activeClientIps;
 
     MeetingRole meetingRole;
@@ -197,8 +202,7 @@ private:
     bool cameraEnabled;
     int connectedClientCount;
     bool recordingAudio;
-    QFile *audioRecordFile;
-    qint64 audioRecordDataSize;
+    MeetingRecorder *audioRecorder;
     QString audioRecordPath;
     bool recordingScreen;
     QString screenRecordDir;
@@ -214,6 +218,13 @@ private:
     QStringList participantOrder;
     QImage lastScreenShareFrame;
     QString activeSpeakerIp;
+    // Host-side: tile shown alone after a double-click, and the video
+    // limit last sent to each guest (invalid size: no limit).
+    QString maximizedVideoIp;
+    QHash<QString, QSize> requestedVideoLimits;
+    // Host-side: guest -> guests whose relayed video it subscribed to. A
+    // single entry means that guest maximized it.
+    QHash<QString, QStringList> guestVideoSubscriptions;
     QVector<ChatLogEntry> chatLog;
 
       // Guest 侧简单自动重连
@@ -223,6 +234,8 @@ private:
 
       // Layout helpers
     void rebuildRemoteParticipantGrid();
+    void updateParticipantVideoLimits();
+    void removeParticipantVideo(const QString &ip);
     QWidget *createParticipantVideoTile(const QString &displayName,
                                         QLabel **outVideoLabel,
                                         QLabel **outMicIconLabel,